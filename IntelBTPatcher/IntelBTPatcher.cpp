@@ -9,35 +9,96 @@
 #include "IntelBTPatcher.hpp"
 #include <Headers/kern_util.hpp>
 #include <IOKit/usb/IOUSBHost.h>
+#include <pexpert/pexpert.h>
 
 #define DRV_NAME "IntelBTPatcher"
 #define VENDOR_USB_INTEL 0x8087
 
+// Wireless Controller / RF / Bluetooth Programming Interface
+#define USB_CLASS_WIRELESS_CONTROLLER   0xE0
+#define USB_SUBCLASS_RF_CONTROLLER      0x01
+#define USB_PROTOCOL_BLUETOOTH          0x01
+
 // ---------- STATIC GLOBALS ----------
 CIntelBTPatcher *CIntelBTPatcher::callbackIBTPatcher = nullptr;
-void *CIntelBTPatcher::_hookPipeInstance = nullptr;
-CIntelBTPatcher::AsyncOwnerData *CIntelBTPatcher::_interruptPipeAsyncOwner = nullptr;
+CIntelBTPatcher::HookedPipe CIntelBTPatcher::_hookedPipes[HOOKED_PIPES_MAX] {};
+volatile uint64_t CIntelBTPatcher::_hookedPipeFilter = 0;
+IOSimpleLock *CIntelBTPatcher::_hookedPipeLock = nullptr;
 bool CIntelBTPatcher::_randomAddressInit = false;
+bool CIntelBTPatcher::_telemetryEnabled = false;
+thread_call_t CIntelBTPatcher::_telemetryCall = nullptr;
 
 // ---------- FAKE PHY EVENT ----------
-static uint8_t fakePhyUpdateCompleteEvent[8] = {
+static const uint8_t fakePhyUpdateCompleteEvent[8] = {
     0x3E, 0x06, 0x0C, 0x00, 0x00, 0x00, 0x02, 0x02   // LE PHY Update Complete (2 Mbps)
 };
 
 #define HCI_EVT_LE_META                     0x3E
+#define HCI_EVT_LE_META_CONN_COMPLETE       0x01
 #define HCI_EVT_LE_META_READ_REMOTE_FEATURES_COMPLETE 0x04
+#define HCI_EVT_LE_META_ENHANCED_CONN_COMPLETE 0x0A
 #define HCI_OP_LE_READ_REMOTE_FEATURES      0x2016
 
+// Only the start of an event is copied out of the buffer: event code,
+// length, LE subevent, status and connection handle. The whole event
+// fits on the stack for the few that telemetry reads further into.
+#define HCI_EVT_PEEK_LEN                    6
+#define HCI_EVT_MAX_LEN                     (2 + 255)
+
+// ---------- TELEMETRY EVENTS ----------
+#define HCI_EVT_DISCONN_COMPLETE            0x05
+#define HCI_EVT_HARDWARE_ERROR              0x10
+#define HCI_EVT_FLUSH_OCCURRED              0x11
+#define HCI_EVT_NUM_COMP_PKTS               0x13
+#define HCI_EVT_DATA_BUFFER_OVERFLOW        0x1A
+#define HCI_EVT_QOS_VIOLATION               0x1E
+#define HCI_EVT_VENDOR                      0xFF
+
+#define HCI_ERR_CONN_TIMEOUT                0x08
+#define HCI_ERR_LMP_RESPONSE_TIMEOUT        0x22
+
+// Intel diagnostics event: vendor event starting with 87 80 03, then
+// type, length, value TLVs. The one of type 0x01 carries the event type,
+// the others are the exception's dump and are only bounds checked.
+static const uint8_t intelDiagnosticsHdr[3] = { 0x87, 0x80, 0x03 };
+#define INTEL_DIAG_TLV_TYPE_ID              0x01
+#define INTEL_DIAG_SYSTEM_EXCEPTION         0x00
+#define INTEL_DIAG_FATAL_EXCEPTION          0x01
+#define INTEL_DIAG_DEBUG_EXCEPTION          0x02
+#define INTEL_DIAG_TEST_EXCEPTION           0xDE
+#define INTEL_DIAG_EXCEPTION_TYPES          4
+
+// Published every this many events, and right away on a fault.
+#define TELEMETRY_PUBLISH_EVENTS            1024
+
+// Connection table slots that are free, or were left by a disconnection
+// and still continue a probe.
+#define HCI_CONN_FREE                       0xFFFF
+#define HCI_CONN_REMOVED                    0xFFFE
+#define HCI_CONN_HANDLE_MASK                0x0FFF
+
 //===================================================================
 //  INIT / DEINIT
 //===================================================================
 bool CIntelBTPatcher::init() {
+    uint32_t telemetry = 0;
+
     callbackIBTPatcher = this;
+    if (PE_parse_boot_argn("ibttelemetry", &telemetry, sizeof(telemetry)) && telemetry) {
+        _telemetryCall = thread_call_allocate(telemetryPublish, nullptr);
+        _telemetryEnabled = _telemetryCall != nullptr;
+    }
     return true;
 }
 
+// The routes stay installed, so a completion in flight may still count
+// into its slot and a pipe freed later still unhooks itself and drops
+// its device. The slots, their lock and the telemetry call are left to
+// them, only publishing stops.
 void CIntelBTPatcher::deinit() {
-    if (_interruptPipeAsyncOwner) { delete _interruptPipeAsyncOwner; }
+    _telemetryEnabled = false;
+    if (_telemetryCall)
+        thread_call_cancel_wait(_telemetryCall);
     callbackIBTPatcher = nullptr;
 }
 
@@ -82,6 +143,117 @@ void CIntelBTPatcher::processKext(KernelPatcher &patcher, size_t index, mach_vm_
         SYSLOG(DRV_NAME, "routed initPipe for fake PHY");
     else
         patcher.clearError();
+
+    // ---- FAKE PHY: pipe teardown ----
+    KernelPatcher::RouteRequest pipeFreeRequest {
+        "__ZN13IOUSBHostPipe4freeEv",
+        newPipeFree,
+        oldPipeFree
+    };
+    patcher.routeMultiple(index, &pipeFreeRequest, 1, address, size);
+    if (patcher.getError() == KernelPatcher::Error::NoError)
+        SYSLOG(DRV_NAME, "routed pipe free for fake PHY");
+    else
+        patcher.clearError();
+}
+
+//===================================================================
+//  HOOKED PIPES
+//===================================================================
+// Pipes are at least 16 byte aligned, the multiply spreads the rest of
+// the address over the high bits: the top six pick the filter bit, the
+// ones below the first slot to look at.
+static inline uint64_t pipeHash(const void *pipe) {
+    return ((uintptr_t)pipe >> 4) * 0x9E3779B97F4A7C15ULL;
+}
+
+static inline uint64_t pipeFilterBit(const void *pipe) {
+    return 1ULL << (pipeHash(pipe) >> 58);
+}
+
+// Every slot is looked at, so a cleared one never ends a probe and
+// removal needs no tombstones.
+CIntelBTPatcher::AsyncOwnerData *CIntelBTPatcher::hookedPipe(void *pipe) {
+    if (__builtin_expect(!(_hookedPipeFilter & pipeFilterBit(pipe)), 1))
+        return nullptr;
+
+    uint64_t first = pipeHash(pipe) >> 32;
+    for (int i = 0; i < HOOKED_PIPES_MAX; i++) {
+        HookedPipe *slot = &_hookedPipes[(first + i) & (HOOKED_PIPES_MAX - 1)];
+        if (slot->pipe == pipe)
+            return &slot->owner;
+    }
+    return nullptr;
+}
+
+// There is no start routine every path goes through first, so the first
+// caller installs the lock.
+static IOSimpleLock *hookedPipeLock(IOSimpleLock **lock) {
+    if (!*lock) {
+        IOSimpleLock *newLock = IOSimpleLockAlloc();
+        if (newLock && !OSCompareAndSwapPtr(nullptr, newLock, (void * volatile *)lock))
+            IOSimpleLockFree(newLock);
+    }
+    return *lock;
+}
+
+// With telemetry on, the slot holds a reference to the pipe's device
+// for telemetryPublish().
+bool CIntelBTPatcher::hookPipe(void *pipe, IOUSBHostDevice *device) {
+    IOSimpleLock *lock = hookedPipeLock(&_hookedPipeLock);
+    HookedPipe *slot = nullptr;
+    uint64_t first = pipeHash(pipe) >> 32;
+
+    if (!lock)
+        return false;
+    IOSimpleLockLock(lock);
+    for (int i = 0; i < HOOKED_PIPES_MAX; i++) {
+        HookedPipe *candidate = &_hookedPipes[(first + i) & (HOOKED_PIPES_MAX - 1)];
+        if (candidate->pipe == pipe) {
+            slot = candidate;
+            break;
+        }
+        if (!slot && !candidate->pipe)
+            slot = candidate;
+    }
+    if (slot && slot->pipe != pipe) {
+        memset(&slot->owner, 0, sizeof(slot->owner));
+        connectionsReset(&slot->owner);
+        if (_telemetryEnabled && device) {
+            device->retain();
+            slot->device = device;
+        }
+        OSMemoryBarrier();
+        slot->pipe = pipe;
+        _hookedPipeFilter |= pipeFilterBit(pipe);
+    }
+    IOSimpleLockUnlock(lock);
+    return slot != nullptr;
+}
+
+// The filter keeps the bit of a pipe that shares it with one still
+// hooked, so it is rebuilt from what is left.
+void CIntelBTPatcher::unhookPipe(void *pipe) {
+    IOSimpleLock *lock = _hookedPipeLock;
+    IOUSBHostDevice *device = nullptr;
+    uint64_t filter = 0;
+
+    if (!hookedPipe(pipe) || !lock)
+        return;
+    IOSimpleLockLock(lock);
+    for (int i = 0; i < HOOKED_PIPES_MAX; i++) {
+        if (_hookedPipes[i].pipe == pipe) {
+            _hookedPipes[i].pipe = nullptr;
+            device = _hookedPipes[i].device;
+            _hookedPipes[i].device = nullptr;
+        } else if (_hookedPipes[i].pipe) {
+            filter |= pipeFilterBit(_hookedPipes[i].pipe);
+        }
+    }
+    _hookedPipeFilter = filter;
+    IOSimpleLockUnlock(lock);
+    // Not under the spinlock, the last reference frees the device
+    OSSafeReleaseNULL(device);
 }
 
 //===================================================================
@@ -104,6 +276,16 @@ IOReturn CIntelBTPatcher::wrapHostDeviceRequest(void *that, IOService *provider,
 //===================================================================
 //  FAKE PHY: initPipe
 //===================================================================
+// Intel hubs (8087:0024, 8087:8000, ...) have interrupt pipes too, their
+// status bytes are no HCI events and must not take a slot.
+bool CIntelBTPatcher::isBluetoothInterface(IOUSBHostInterface *interface) {
+    const StandardUSB::InterfaceDescriptor *desc = interface ? interface->getInterfaceDescriptor() : nullptr;
+
+    return desc && desc->bInterfaceClass == USB_CLASS_WIRELESS_CONTROLLER &&
+           desc->bInterfaceSubClass == USB_SUBCLASS_RF_CONTROLLER &&
+           desc->bInterfaceProtocol == USB_PROTOCOL_BLUETOOTH;
+}
+
 int CIntelBTPatcher::newInitPipe(void *that,
                                  StandardUSB::EndpointDescriptor const *descriptor,
                                  StandardUSB::SuperSpeedEndpointCompanionDescriptor const *superDescriptor,
@@ -115,11 +297,12 @@ int CIntelBTPatcher::newInitPipe(void *that,
     int ret = FunctionCast(newInitPipe, callbackIBTPatcher->oldInitPipe)(
         that, descriptor, superDescriptor, controller, device, interface, a7, a8);
 
-    if (device && device->getDeviceDescriptor()->idVendor == VENDOR_USB_INTEL) {
+    if (device && device->getDeviceDescriptor()->idVendor == VENDOR_USB_INTEL && isBluetoothInterface(interface)) {
         if (StandardUSB::getEndpointType(descriptor) == kIOUSBEndpointTypeInterrupt) {
-            _hookPipeInstance = that;
-            if (!_interruptPipeAsyncOwner)
-                _interruptPipeAsyncOwner = new AsyncOwnerData;
+            if (!hookPipe(that, device)) {
+                SYSLOG(DRV_NAME, "[PATCH] No slot left for Intel BT interrupt pipe, not hooked");
+                return ret;
+            }
             _randomAddressInit = false;
             SYSLOG(DRV_NAME, "[PATCH] Hooked Intel BT interrupt pipe – ready for fake PHY");
         }
@@ -135,57 +318,330 @@ IOReturn CIntelBTPatcher::newAsyncIO(void *that,
                                      uint32_t bytesTransferred,
                                      IOUSBHostCompletion* completion,
                                      uint32_t completionTimeoutMs) {
-    if (that == _hookPipeInstance && completion) {
-        _interruptPipeAsyncOwner->action   = completion->action;
-        _interruptPipeAsyncOwner->owner    = completion->owner;
-        _interruptPipeAsyncOwner->dataBuffer = dataBuffer;
+    AsyncOwnerData *asyncOwner = hookedPipe(that);
+
+    if (asyncOwner && completion) {
+        asyncOwner->action   = completion->action;
+        asyncOwner->owner    = completion->owner;
+        asyncOwner->dataBuffer = dataBuffer;
 
         completion->action = asyncIOCompletion;
-        completion->owner  = _interruptPipeAsyncOwner;
+        completion->owner  = asyncOwner;
     }
     return FunctionCast(newAsyncIO, callbackIBTPatcher->oldAsyncIO)(
         that, dataBuffer, bytesTransferred, completion, completionTimeoutMs);
 }
 
+//===================================================================
+//  FAKE PHY: pipe teardown
+//===================================================================
+void CIntelBTPatcher::newPipeFree(void *that) {
+    unhookPipe(that);
+    FunctionCast(newPipeFree, callbackIBTPatcher->oldPipeFree)(that);
+}
+
+//===================================================================
+//  FAKE PHY: connections
+//===================================================================
+void CIntelBTPatcher::connectionsReset(AsyncOwnerData *asyncOwner) {
+    for (int i = 0; i < HCI_CONN_SLOTS; i++)
+        asyncOwner->connections[i].handle = HCI_CONN_FREE;
+}
+
+// Handles are handed out from a small range, so starting at the low bits
+// of the handle almost always finds it in the first slot. A connection
+// made before the pipe was hooked is added on its first event.
+CIntelBTPatcher::ConnectionState *CIntelBTPatcher::connectionFind(AsyncOwnerData *asyncOwner, uint16_t handle, bool create) {
+    ConnectionState *free = nullptr;
+
+    for (int i = 0; i < HCI_CONN_SLOTS; i++) {
+        ConnectionState *conn = &asyncOwner->connections[(handle + i) & (HCI_CONN_SLOTS - 1)];
+        if (conn->handle == handle)
+            return conn;
+        if (!free && (conn->handle == HCI_CONN_FREE || conn->handle == HCI_CONN_REMOVED))
+            free = conn;
+        if (conn->handle == HCI_CONN_FREE)
+            break;
+    }
+    if (!create || !free) {
+        if (create)
+            SYSLOG(DRV_NAME, "[PATCH] No slot left for connection 0x%03X", handle);
+        return nullptr;
+    }
+    free->handle = handle;
+    free->skipExtraReadRemoteFeaturesComplete = true;
+    return free;
+}
+
+void CIntelBTPatcher::connectionRemove(AsyncOwnerData *asyncOwner, uint16_t handle) {
+    ConnectionState *conn = connectionFind(asyncOwner, handle, false);
+    if (!conn)
+        return;
+    // The next slot being free means no probe goes past this one
+    if (asyncOwner->connections[(conn - asyncOwner->connections + 1) & (HCI_CONN_SLOTS - 1)].handle == HCI_CONN_FREE)
+        conn->handle = HCI_CONN_FREE;
+    else
+        conn->handle = HCI_CONN_REMOVED;
+}
+
 //===================================================================
 //  FAKE PHY: completion handler
 //===================================================================
 void CIntelBTPatcher::asyncIOCompletion(void* owner, void* parameter, IOReturn status, uint32_t bytesTransferred) {
     AsyncOwnerData *asyncOwner = static_cast<AsyncOwnerData *>(owner);
     IOMemoryDescriptor* dataBuffer = asyncOwner->dataBuffer;
-    static bool skipExtraReadRemoteFeaturesComplete = true;
-
-    if (dataBuffer && bytesTransferred > 0) {
-        void *buf = IOMalloc(bytesTransferred);
-        if (buf) {
-            dataBuffer->readBytes(0, buf, bytesTransferred);
-            HciEventHdr *hdr = static_cast<HciEventHdr *>(buf);
-
-            if (hdr->evt == HCI_EVT_LE_META &&
-                hdr->len >= 3 &&
-                hdr->data[0] == HCI_EVT_LE_META_READ_REMOTE_FEATURES_COMPLETE) {
-
-                if (skipExtraReadRemoteFeaturesComplete) {
-                    skipExtraReadRemoteFeaturesComplete = false;
-                } else {
-                    // ---- INJECT FAKE LE PHY UPDATE COMPLETE ----
-                    fakePhyUpdateCompleteEvent[4] = hdr->data[2]; // low byte handle
-                    fakePhyUpdateCompleteEvent[5] = hdr->data[3]; // high byte handle
-                    dataBuffer->writeBytes(0, fakePhyUpdateCompleteEvent, sizeof(fakePhyUpdateCompleteEvent));
-
-                    skipExtraReadRemoteFeaturesComplete = true;
-                    SYSLOG(DRV_NAME, "[PATCH] Injected fake LE PHY Update Complete (handle 0x%02X%02X)",
-                           hdr->data[3], hdr->data[2]);
-                }
+
+    if (dataBuffer && bytesTransferred >= sizeof(HciEventHdr)) {
+        uint8_t buf[HCI_EVT_MAX_LEN];
+#if DEBUG
+        uint64_t start = _telemetryEnabled ? mach_absolute_time() : 0;
+#endif
+        uint32_t peeked = min(bytesTransferred, (uint32_t)HCI_EVT_PEEK_LEN);
+        HciEventHdr *hdr = reinterpret_cast<HciEventHdr *>(buf);
+
+        dataBuffer->readBytes(0, buf, peeked);
+
+        if (_telemetryEnabled) {
+            uint32_t want = min(min(bytesTransferred, (uint32_t)sizeof(buf)), telemetryPeekLength(hdr));
+            if (want > peeked) {
+                dataBuffer->readBytes(peeked, buf + peeked, want - peeked);
+                peeked = want;
+            }
+            telemetryEvent(&asyncOwner->telemetry, hdr, bytesTransferred);
+        }
+
+        // data[3] is the last byte used, the handle's high byte
+        if (hdr->evt == HCI_EVT_LE_META &&
+            hdr->len >= 4 && peeked >= HCI_EVT_PEEK_LEN) {
+            uint16_t handle = (hdr->data[2] | hdr->data[3] << 8) & HCI_CONN_HANDLE_MASK;
+            ConnectionState *conn;
+
+            switch (hdr->data[0]) {
+                case HCI_EVT_LE_META_CONN_COMPLETE:
+                case HCI_EVT_LE_META_ENHANCED_CONN_COMPLETE:
+                    // A handle reused after a lost disconnection starts over
+                    if (!hdr->data[1] && (conn = connectionFind(asyncOwner, handle, true)))
+                        conn->skipExtraReadRemoteFeaturesComplete = true;
+                    break;
+                case HCI_EVT_LE_META_READ_REMOTE_FEATURES_COMPLETE:
+                    conn = connectionFind(asyncOwner, handle, true);
+                    if (!conn)
+                        break;
+                    if (conn->skipExtraReadRemoteFeaturesComplete) {
+                        conn->skipExtraReadRemoteFeaturesComplete = false;
+                    } else {
+                        // ---- INJECT FAKE LE PHY UPDATE COMPLETE ----
+                        uint8_t event[sizeof(fakePhyUpdateCompleteEvent)];
+                        memcpy(event, fakePhyUpdateCompleteEvent, sizeof(event));
+                        event[4] = hdr->data[2]; // low byte handle
+                        event[5] = hdr->data[3]; // high byte handle
+                        dataBuffer->writeBytes(0, event, sizeof(event));
+
+                        conn->skipExtraReadRemoteFeaturesComplete = true;
+                        SYSLOG(DRV_NAME, "[PATCH] Injected fake LE PHY Update Complete (handle 0x%02X%02X)",
+                               hdr->data[3], hdr->data[2]);
+                    }
+                    break;
             }
-            IOFree(buf, bytesTransferred);
+        } else if (hdr->evt == HCI_EVT_DISCONN_COMPLETE &&
+                   hdr->len >= 4 && peeked >= sizeof(*hdr) + 3 && !hdr->data[0]) {
+            // status, then the handle
+            connectionRemove(asyncOwner, (hdr->data[1] | hdr->data[2] << 8) & HCI_CONN_HANDLE_MASK);
         }
+
+#if DEBUG
+        if (_telemetryEnabled)
+            telemetryInspectTime(&asyncOwner->telemetry, start);
+#endif
     }
 
     if (asyncOwner->action)
         asyncOwner->action(asyncOwner->owner, parameter, status, bytesTransferred);
 }
 
+//===================================================================
+//  TELEMETRY
+//===================================================================
+// Runs in the completion of the interrupt pipe, which has one read in
+// flight at a time, so the counters of the pipe need no lock. Publishing
+// allocates and is left to a thread call.
+// How much of an event telemetryEvent() reads, at most the whole event.
+uint32_t CIntelBTPatcher::telemetryPeekLength(const HciEventHdr *hdr) {
+    switch (hdr->evt) {
+        case HCI_EVT_NUM_COMP_PKTS:
+            return sizeof(*hdr) + hdr->len;
+        case HCI_EVT_DISCONN_COMPLETE:
+            return sizeof(*hdr) + 4;
+        case HCI_EVT_HARDWARE_ERROR:
+            return sizeof(*hdr) + 1;
+        case HCI_EVT_VENDOR:
+            // Rare once the firmware runs, diagnostics are walked whole
+            return sizeof(*hdr) + hdr->len;
+        default:
+            return HCI_EVT_PEEK_LEN;
+    }
+}
+
+#if DEBUG
+// Cost of looking at one event in the completion, so the overhead the
+// hook adds at the stack's real event rate shows up in the telemetry.
+// Release builds keep the clock reads out of the hook, ibt_bench
+// measures it on the host instead.
+void CIntelBTPatcher::telemetryInspectTime(TelemetryStats *stats, uint64_t start) {
+    uint64_t ns;
+
+    absolutetime_to_nanoseconds(mach_absolute_time() - start, &ns);
+    stats->inspected++;
+    stats->inspectNs += ns;
+    if (ns > stats->inspectNsMax)
+        stats->inspectNsMax = ns;
+}
+#endif
+
+// The TLVs follow the 87 80 03 header up to the end of the event. One
+// running past it makes the whole event malformed.
+void CIntelBTPatcher::telemetryDiagnostics(TelemetryStats *stats, const HciEventHdr *hdr) {
+    int type = -1;
+
+    stats->diagnostics++;
+    for (uint32_t off = sizeof(intelDiagnosticsHdr); off < hdr->len; off += 2 + hdr->data[off + 1]) {
+        if (off + 2 > hdr->len || off + 2 + hdr->data[off + 1] > hdr->len) {
+            stats->diagnosticsMalformed++;
+            return;
+        }
+        if (hdr->data[off] == INTEL_DIAG_TLV_TYPE_ID && hdr->data[off + 1] && type < 0)
+            type = hdr->data[off + 2];
+    }
+    switch (type) {
+        case INTEL_DIAG_SYSTEM_EXCEPTION:
+        case INTEL_DIAG_FATAL_EXCEPTION:
+        case INTEL_DIAG_DEBUG_EXCEPTION:
+            stats->exceptions[type]++;
+            break;
+        case INTEL_DIAG_TEST_EXCEPTION:
+            stats->exceptions[3]++;
+            break;
+    }
+}
+
+void CIntelBTPatcher::telemetryEvent(TelemetryStats *stats, const HciEventHdr *hdr, uint32_t length) {
+    bool fault = false;
+
+    if (length < sizeof(*hdr) || length < sizeof(*hdr) + hdr->len)
+        return;
+    stats->events++;
+
+    switch (hdr->evt) {
+        case HCI_EVT_NUM_COMP_PKTS:
+            // num_handles, then handle and count for each
+            for (int i = 0; hdr->len >= 1 + (i + 1) * 4 && i < hdr->data[0]; i++)
+                stats->completedPackets += hdr->data[3 + i * 4] | hdr->data[4 + i * 4] << 8;
+            break;
+        case HCI_EVT_DISCONN_COMPLETE:
+            if (hdr->len < 4 || hdr->data[0])
+                break;
+            stats->disconnects++;
+            if (hdr->data[3] == HCI_ERR_CONN_TIMEOUT)
+                stats->supervisionTimeouts++;
+            else if (hdr->data[3] == HCI_ERR_LMP_RESPONSE_TIMEOUT)
+                stats->lmpTimeouts++;
+            break;
+        case HCI_EVT_FLUSH_OCCURRED:
+            stats->flushOccurred++;
+            break;
+        case HCI_EVT_DATA_BUFFER_OVERFLOW:
+            stats->bufferOverflows++;
+            break;
+        case HCI_EVT_QOS_VIOLATION:
+            stats->qosViolations++;
+            break;
+        case HCI_EVT_HARDWARE_ERROR:
+            stats->hardwareErrors++;
+            stats->lastHardwareError = hdr->len ? hdr->data[0] : 0;
+            fault = true;
+            break;
+        case HCI_EVT_VENDOR:
+            if (hdr->len < sizeof(intelDiagnosticsHdr) ||
+                memcmp(hdr->data, intelDiagnosticsHdr, sizeof(intelDiagnosticsHdr)))
+                break;
+            telemetryDiagnostics(stats, hdr);
+            fault = true;
+            break;
+    }
+
+    if (fault || stats->events % TELEMETRY_PUBLISH_EVENTS == 0)
+        thread_call_enter(_telemetryCall);
+}
+
+static void setTelemetryNumber(OSDictionary *dict, const char *key, uint64_t value) {
+    OSNumber *num = OSNumber::withNumber(value, 64);
+    if (num) {
+        dict->setObject(key, num);
+        num->release();
+    }
+}
+
+void CIntelBTPatcher::telemetrySet(IOUSBHostDevice *device, const TelemetryStats *stats) {
+    static const char *exceptionNames[INTEL_DIAG_EXCEPTION_TYPES] = { "system", "fatal", "debug", "test" };
+    OSDictionary *dict, *exceptions;
+
+    dict = OSDictionary::withCapacity(15);
+    exceptions = OSDictionary::withCapacity(INTEL_DIAG_EXCEPTION_TYPES);
+    if (!dict || !exceptions) {
+        OSSafeReleaseNULL(dict);
+        OSSafeReleaseNULL(exceptions);
+        return;
+    }
+    setTelemetryNumber(dict, "events", stats->events);
+    setTelemetryNumber(dict, "completed_packets", stats->completedPackets);
+    setTelemetryNumber(dict, "disconnects", stats->disconnects);
+    setTelemetryNumber(dict, "supervision_timeouts", stats->supervisionTimeouts);
+    setTelemetryNumber(dict, "lmp_timeouts", stats->lmpTimeouts);
+    setTelemetryNumber(dict, "flush_occurred", stats->flushOccurred);
+    setTelemetryNumber(dict, "buffer_overflows", stats->bufferOverflows);
+    setTelemetryNumber(dict, "qos_violations", stats->qosViolations);
+    setTelemetryNumber(dict, "hardware_errors", stats->hardwareErrors);
+    setTelemetryNumber(dict, "last_hardware_error", stats->lastHardwareError);
+    setTelemetryNumber(dict, "diagnostics", stats->diagnostics);
+    setTelemetryNumber(dict, "diagnostics_malformed", stats->diagnosticsMalformed);
+#if DEBUG
+    setTelemetryNumber(dict, "inspect_ns_mean", stats->inspected ? stats->inspectNs / stats->inspected : 0);
+    setTelemetryNumber(dict, "inspect_ns_max", stats->inspectNsMax);
+#endif
+    for (int i = 0; i < INTEL_DIAG_EXCEPTION_TYPES; i++)
+        setTelemetryNumber(exceptions, exceptionNames[i], stats->exceptions[i]);
+    dict->setObject("exceptions", exceptions);
+    exceptions->release();
+    device->setProperty("ibt_telemetry", dict);
+    dict->release();
+}
+
+// Each hooked pipe to its own device. The counters are copied and the
+// device retained under the lock, so an unhook running alongside can
+// neither reuse the slot nor free the device under the publish.
+void CIntelBTPatcher::telemetryPublish(thread_call_param_t param0, thread_call_param_t param1) {
+    IOSimpleLock *lock = _hookedPipeLock;
+
+    if (!lock)
+        return;
+    for (int i = 0; i < HOOKED_PIPES_MAX; i++) {
+        TelemetryStats stats;
+        IOUSBHostDevice *device;
+
+        IOSimpleLockLock(lock);
+        device = _hookedPipes[i].pipe ? _hookedPipes[i].device : nullptr;
+        if (device) {
+            device->retain();
+            stats = _hookedPipes[i].owner.telemetry;
+        }
+        IOSimpleLockUnlock(lock);
+        if (!device)
+            continue;
+        telemetrySet(device, &stats);
+        device->release();
+    }
+}
+
 //===================================================================
 //  PLUGIN ENTRY
 //===================================================================
@@ -14,41 +14,123 @@
 #include <IOKit/IOService.h>
 #include <IOKit/usb/IOUSBHostPipe.h>
 #include <IOKit/usb/StandardUSB.h>
+#include <kern/thread_call.h>
+
+// Intel controllers hooked at once, a power of two
+#define HOOKED_PIPES_MAX 4
+
+// LE connections tracked per controller, a power of two
+#define HCI_CONN_SLOTS 64
 
 class CIntelBTPatcher {
 public:
     bool init();
     void deinit();
 
-private:
-    static CIntelBTPatcher *callbackIBTPatcher;
-
     void processKext(KernelPatcher &patcher, size_t index, mach_vm_address_t address, size_t size);
 
+    // Protected for the host benchmarks, see host/tools/ibt_bench.cpp
+protected:
+    static CIntelBTPatcher *callbackIBTPatcher;
+
     // ---------- ORIGINAL ROUTES ----------
     mach_vm_address_t oldHostDeviceRequest {};
     mach_vm_address_t oldAsyncIO {};
     mach_vm_address_t oldInitPipe {};
+    mach_vm_address_t oldPipeFree {};
 
     // ---------- FAKE PHY FIX (PR #446) ----------
+    // Fake PHY state of one LE connection, kept from its LE Connection
+    // Complete to its Disconnection Complete.
+    struct ConnectionState {
+        uint16_t handle;
+        bool skipExtraReadRemoteFeaturesComplete;
+    };
+
+    // ---------- TELEMETRY (ibttelemetry=1) ----------
+    // Counted per hooked pipe from the events the stack receives,
+    // published as "ibt_telemetry" on the pipe's device. Debug builds
+    // also time the completion, ibt_bench measures it on the host.
+    struct TelemetryStats {
+        uint64_t events;
+        uint64_t completedPackets;
+        uint64_t disconnects;
+        uint64_t supervisionTimeouts;
+        uint64_t lmpTimeouts;
+        uint64_t flushOccurred;
+        uint64_t bufferOverflows;
+        uint64_t qosViolations;
+        uint64_t hardwareErrors;
+        uint64_t diagnostics;
+        uint64_t diagnosticsMalformed;
+        uint64_t exceptions[4];
+#if DEBUG
+        uint64_t inspected;
+        uint64_t inspectNs;
+        uint64_t inspectNsMax;
+#endif
+        uint8_t lastHardwareError;
+    };
+
+    // The connections sit in a table probed from their handle. Only the
+    // completion of the pipe reads and writes it and the counters, and
+    // the pipe has one read in flight at a time, so they need no lock.
     struct AsyncOwnerData {
         void* owner;
-        IOUSBHostCompletion* action;
+        IOUSBHostCompletionAction action;
         IOMemoryDescriptor* dataBuffer;
+        ConnectionState connections[HCI_CONN_SLOTS];
+        TelemetryStats telemetry;
+    };
+
+    // ---------- HOOKED PIPES ----------
+    // The interrupt pipes of every Intel controller, found by pointer
+    // hash. A slot is filled before its pipe is published and the pipe
+    // cleared before the slot is reused, so newAsyncIO() reads the table
+    // without a lock. _hookedPipeFilter has one bit per hooked pipe and
+    // turns the pipes of every other USB device away on a single test.
+    // device is held for telemetry and only touched under the lock.
+    struct HookedPipe {
+        void * volatile pipe;
+        IOUSBHostDevice *device;
+        AsyncOwnerData owner;
     };
 
-    static void* _hookPipeInstance;
-    static AsyncOwnerData* _interruptPipeAsyncOwner;
+    static HookedPipe _hookedPipes[HOOKED_PIPES_MAX];
+    static volatile uint64_t _hookedPipeFilter;
+    static IOSimpleLock* _hookedPipeLock;
     static bool _randomAddressInit;
 
+    static AsyncOwnerData* hookedPipe(void *pipe);
+    static bool hookPipe(void *pipe, IOUSBHostDevice *device);
+    static void unhookPipe(void *pipe);
+
+    static bool isBluetoothInterface(IOUSBHostInterface *interface);
     static IOReturn newAsyncIO(void *that, IOMemoryDescriptor* dataBuffer, uint32_t bytesTransferred,
                                IOUSBHostCompletion* completion, uint32_t completionTimeoutMs);
     static int newInitPipe(void *that, StandardUSB::EndpointDescriptor const *descriptor,
                            StandardUSB::SuperSpeedEndpointCompanionDescriptor const *superDescriptor,
                            AppleUSBHostController *controller, IOUSBHostDevice *device,
                            IOUSBHostInterface *interface, unsigned char a7, unsigned short a8);
+    static void newPipeFree(void *that);
+    static void connectionsReset(AsyncOwnerData *asyncOwner);
+    static ConnectionState* connectionFind(AsyncOwnerData *asyncOwner, uint16_t handle, bool create);
+    static void connectionRemove(AsyncOwnerData *asyncOwner, uint16_t handle);
     static void asyncIOCompletion(void* owner, void* parameter, IOReturn status, uint32_t bytesTransferred);
 
+    // ---------- TELEMETRY ----------
+    static bool _telemetryEnabled;
+    static thread_call_t _telemetryCall;
+
+    static uint32_t telemetryPeekLength(const HciEventHdr *hdr);
+    static void telemetryEvent(TelemetryStats *stats, const HciEventHdr *hdr, uint32_t length);
+    static void telemetryDiagnostics(TelemetryStats *stats, const HciEventHdr *hdr);
+#if DEBUG
+    static void telemetryInspectTime(TelemetryStats *stats, uint64_t start);
+#endif
+    static void telemetrySet(IOUSBHostDevice *device, const TelemetryStats *stats);
+    static void telemetryPublish(thread_call_param_t param0, thread_call_param_t param1);
+
     // ---------- ORIGINAL FUNCTIONS ----------
     static IOReturn wrapHostDeviceRequest(void *that, IOService *provider,
                                           IOUSBHostIORequest *request,
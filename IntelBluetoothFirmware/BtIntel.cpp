@@ -14,30 +14,50 @@
 #include "BtIntel.h"
 #include "Log.h"
 
+#include <libkern/c++/OSBoolean.h>
+#include <libkern/c++/OSData.h>
+#include <libkern/c++/OSDictionary.h>
+#include <libkern/c++/OSNumber.h>
+#include <libkern/c++/OSString.h>
+
 #define super OSObject
 OSDefineMetaClassAndAbstractStructors(BtIntel, OSObject)
 
+/* Common to every transport: the USB one of the kext (initWithDevice)
+ * and the host ones. location keys the resume cache and recovery stats,
+ * 0 for a controller that is not on a USB port. latency is the SKU table
+ * learned timeouts start from, NULL when latencies on the transport say
+ * nothing about the hardware.
+ */
 bool BtIntel::
-initWithDevice(IOService *client, IOUSBHostDevice *dev)
+initWithTransport(HCITransport *transport, uint32_t location, IntelSkuLatency *latency)
 {
-    XYLog("%s\n", __PRETTY_FUNCTION__);
     if (!super::init()) {
         return false;
     }
+    m_timeline.reset();
+    m_deadline.arm(0, &m_timeline);
+    m_pLatency = latency;
+    for (int i = 0; i < kRoundTripPathCount; i++)
+        intelPathReset(&m_roundTrip[i]);
+    memset(&m_route, 0, sizeof(m_route));
+    m_lateOpcode = 0;
+    m_lateBulkOpcode = 0;
+    m_bootloader = false;
+    m_location = location;
+    memset(&m_cached, 0, sizeof(m_cached));
+    memset(&m_current, 0, sizeof(m_current));
+    m_survived = false;
+    m_identityKnown = false;
+    m_variant = NULL;
+    m_fault = kRecoveryCauseCount;
+    if (m_location && IntelResumeCache::copy(m_location, &m_cached))
+        XYLog("Resuming %s at 0x%08x\n", m_cached.fwName, m_location);
     
-    m_pUSBDeviceController = new USBDeviceController();
-    if (!m_pUSBDeviceController->init(client, dev)) {
-        return false;
-    }
-    if (!m_pUSBDeviceController->initConfiguration()) {
-        return false;
-    }
-    if (!m_pUSBDeviceController->findInterface()) {
-        return false;
-    }
-    if (!m_pUSBDeviceController->findPipes()) {
-        return false;
-    }
+    m_pTransport = transport;
+    m_pTransport->retain();
+    m_pTrace = m_pTransport->getTrace();
+    m_pTransport->setDeadline(&m_deadline);
     return true;
 }
 
@@ -45,63 +65,602 @@ void BtIntel::
 free()
 {
     XYLog("%s\n", __PRETTY_FUNCTION__);
-    OSSafeReleaseNULL(m_pUSBDeviceController);
+    IntelResumeCache::put(&m_cached);
+    IntelResumeCache::put(&m_current);
+    OSSafeReleaseNULL(m_pTransport);
     super::free();
 }
 
+void BtIntel::
+noteFault(IntelRecoveryCause cause)
+{
+    if (m_fault == kRecoveryCauseCount) {
+        XYLog("Controller fault: %s\n", IntelRecovery::causeName(cause));
+        m_fault = cause;
+    }
+}
+
+/* The controller reports internal faults with a Hardware Error event in
+ * place of whatever was expected.
+ */
+bool BtIntel::
+hardwareError(const void *event, uint32_t size)
+{
+    const HciEventHdr *hdr = (const HciEventHdr *)event;
+    
+    if (!event || size < sizeof(*hdr) || hdr->evt != HCI_EV_HARDWARE_ERROR)
+        return false;
+    XYLog("Hardware error 0x%02x\n", size > sizeof(*hdr) ? ((const uint8_t *)event)[sizeof(*hdr)] : 0);
+    noteFault(kRecoveryHardwareError);
+    return true;
+}
+
+/* Idempotent commands wait for the learned timeout of their opcode and
+ * are sent once more with the full timeout if that expires, instead of
+ * always waiting seconds for an event that was dropped.
+ */
+int BtIntel::
+commandTimeout(uint16_t opcode, int timeout)
+{
+    if (!intelLatencyIdempotent(opcode))
+        return timeout;
+    return intelLatencyCommandTimeout(m_pLatency, opcode, timeout);
+}
+
+uint64_t BtIntel::
+commandLatency(uint16_t opcode, uint64_t start)
+{
+    uint64_t ns;
+    
+    absolutetime_to_nanoseconds(mach_absolute_time() - start, &ns);
+    intelLatencyRecord(m_pLatency, opcode, ns / 1000);
+    return ns / 1000;
+}
+
+/* The Command Complete or Command Status of opcode */
+static bool
+isCommandEvent(const uint8_t *event, uint32_t size, uint16_t opcode)
+{
+    if (size >= 5 && event[0] == HCI_EV_CMD_COMPLETE)
+        return (event[3] | event[4] << 8) == opcode;
+    if (size >= 6 && event[0] == HCI_EV_CMD_STATUS)
+        return (event[4] | event[5] << 8) == opcode;
+    return false;
+}
+
+/* Reads until the answer to opcode arrives, skipping anything else such
+ * as a late answer to an earlier command.
+ */
+IOReturn BtIntel::
+readCommandEvent(uint16_t opcode, void *event, uint32_t eventBufSize, uint32_t *size, int timeout)
+{
+    IOReturn ret;
+    
+    do {
+        if ((ret = m_pTransport->interruptPipeRead(event, eventBufSize, size, timeout)) != kIOReturnSuccess)
+            return ret;
+        if (hardwareError(event, *size))
+            return kIOReturnError;
+        if (!isCommandEvent((const uint8_t *)event, *size, opcode))
+            XYLog("%s skipping event 0x%02x while waiting for opcode 0x%04x\n", __FUNCTION__,
+                  *(uint8_t *)event, opcode);
+    } while (!isCommandEvent((const uint8_t *)event, *size, opcode));
+    return kIOReturnSuccess;
+}
+
+/* A command that was sent again after its learned timeout expired may
+ * still get its first answer. Consume it before the next command goes
+ * out, so it is never taken for that command's answer. Returns true if
+ * the late answer arrived, it is left in event.
+ */
+bool BtIntel::
+drainLateReply(void *event, uint32_t eventBufSize, uint32_t *size)
+{
+    uint16_t opcode = m_lateOpcode;
+    uint8_t buf[CMD_BUF_MAX_SIZE];
+    uint32_t actLen = 0;
+    
+    if (!opcode)
+        return false;
+    m_lateOpcode = 0;
+    if (!event || eventBufSize < sizeof(HciResponse)) {
+        event = buf;
+        eventBufSize = sizeof(buf);
+    }
+    if (!size)
+        size = &actLen;
+    return readCommandEvent(opcode, event, eventBufSize, size, IBT_LATE_REPLY_TIMEOUT) == kIOReturnSuccess;
+}
+
+/* A command whose bulk answer timed out may still get it, and it would
+ * be taken for the answer to the next command on bulk, a secure send
+ * fragment included. Reads bulk until that opcode's answer arrives or
+ * nothing more does.
+ */
+void BtIntel::
+drainLateBulkReply()
+{
+    uint16_t opcode = m_lateBulkOpcode;
+    uint8_t buf[CMD_BUF_MAX_SIZE];
+    uint32_t actLen;
+    
+    if (!opcode)
+        return;
+    m_lateBulkOpcode = 0;
+    do {
+        actLen = 0;
+        if (m_pTransport->bulkPipeRead(buf, sizeof(buf), &actLen, IBT_LATE_REPLY_TIMEOUT) != kIOReturnSuccess)
+            return;
+        if (!isCommandEvent(buf, actLen, opcode))
+            XYLog("%s skipping event 0x%02x while waiting for opcode 0x%04x\n", __FUNCTION__, buf[0], opcode);
+    } while (!isCommandEvent(buf, actLen, opcode));
+}
+
 bool BtIntel::
 intelSendHCISync(HciCommandHdr *cmd, void *event, uint32_t eventBufSize, uint32_t *size, int timeout)
 {
 //    XYLog("%s cmd: 0x%02x len: %d\n", __PRETTY_FUNCTION__, cmd->opcode, cmd->len);
+    uint16_t opcode = OSSwapLittleToHostInt16(cmd->opcode);
+    int cmdTimeout = commandTimeout(opcode, timeout);
+    uint8_t buf[CMD_BUF_MAX_SIZE];
+    uint32_t actLen = 0;
+    uint64_t start;
     IOReturn ret;
-    if ((ret = m_pUSBDeviceController->sendHCIRequest(cmd, timeout)) != kIOReturnSuccess) {
-        XYLog("%s sendHCIRequest failed: %s %d\n", __FUNCTION__, m_pUSBDeviceController->stringFromReturn(ret), ret);
-        return false;
+    
+    /* The answer is always read, to match its opcode */
+    if (!event || eventBufSize < sizeof(HciResponse)) {
+        event = buf;
+        eventBufSize = sizeof(buf);
     }
-    if ((ret = m_pUSBDeviceController->interruptPipeRead(event, eventBufSize, size, timeout)) != kIOReturnSuccess) {
-        XYLog("%s interruptPipeRead failed: %s %d\n", __FUNCTION__, m_pUSBDeviceController->stringFromReturn(ret), ret);
+    if (!size)
+        size = &actLen;
+    drainLateReply(event, eventBufSize, size);
+    
+    /* Falls through to control when bulk turns out to be rejected, with
+     * the rejected command's answer possibly on the event channel.
+     */
+    if (routeBulk(cmd, event, eventBufSize) &&
+        intelBulkRouted(cmd, event, eventBufSize, size, timeout))
+        return true;
+    drainLateReply(event, eventBufSize, size);
+
+    start = mach_absolute_time();
+    do {
+        if ((ret = m_pTransport->sendHCIRequest(cmd, cmdTimeout)) != kIOReturnSuccess) {
+            XYLog("%s sendHCIRequest failed: %s %d\n", __FUNCTION__, m_pTransport->stringFromReturn(ret), ret);
+            return false;
+        }
+        ret = readCommandEvent(opcode, event, eventBufSize, size, cmdTimeout);
+        if (ret != kIOReturnTimeout)
+            break;
+        intelLatencyTimeout(m_pLatency, opcode);
+        if (cmdTimeout >= timeout)
+            break;
+        /* Only resend once the first answer is known not to be queued */
+        m_lateOpcode = opcode;
+        if (drainLateReply(event, eventBufSize, size)) {
+            ret = kIOReturnSuccess;
+            break;
+        }
+        XYLog("%s opcode 0x%04x no event after %dms, retrying\n", __FUNCTION__, opcode, cmdTimeout);
+        cmdTimeout = timeout;
+        m_lateOpcode = opcode;
+    } while (true);
+    if (ret != kIOReturnSuccess) {
+        XYLog("%s interruptPipeRead failed: %s %d\n", __FUNCTION__, m_pTransport->stringFromReturn(ret), ret);
         return false;
     }
+    commandLatency(opcode, start);
     return true;
 }
 
+/* Not retried: the awaited event need not carry an opcode, so a late
+ * answer to a first attempt could not be told apart.
+ */
 bool BtIntel::
 intelSendHCISyncEvent(HciCommandHdr *cmd, void *event, uint32_t eventBufSize, uint32_t *size, uint8_t syncEvent, int timeout)
 {
+    uint16_t opcode = OSSwapLittleToHostInt16(cmd->opcode);
+    uint64_t start;
     IOReturn ret;
-    if ((ret = m_pUSBDeviceController->sendHCIRequest(cmd, timeout)) != kIOReturnSuccess) {
-        XYLog("%s sendHCIRequest failed: %s %d\n", __FUNCTION__, m_pUSBDeviceController->stringFromReturn(ret), ret);
+    
+    drainLateReply(event, eventBufSize, size);
+    start = mach_absolute_time();
+    if ((ret = m_pTransport->sendHCIRequest(cmd, timeout)) != kIOReturnSuccess) {
+        XYLog("%s sendHCIRequest failed: %s %d\n", __FUNCTION__, m_pTransport->stringFromReturn(ret), ret);
         return false;
     }
     do {
-        ret = m_pUSBDeviceController->interruptPipeRead(event, eventBufSize, size, timeout);
+        ret = m_pTransport->interruptPipeRead(event, eventBufSize, size, timeout);
         if (ret != kIOReturnSuccess) {
-            XYLog("%s interruptPipeRead failed: %s %d\n", __FUNCTION__, m_pUSBDeviceController->stringFromReturn(ret), ret);
+            if (ret == kIOReturnTimeout)
+                intelLatencyTimeout(m_pLatency, opcode);
+            XYLog("%s interruptPipeRead failed: %s %d\n", __FUNCTION__, m_pTransport->stringFromReturn(ret), ret);
             break;
         }
+        if (hardwareError(event, *size))
+            break;
         if (*(uint8_t *)event == syncEvent) {
+            commandLatency(opcode, start);
             return true;
         }
     } while (true);
     return false;
 }
 
+const IntelPatchTableHdr *BtIntel::
+patchTableHeader(OSData *table)
+{
+    const IntelPatchTableHdr *hdr = (const IntelPatchTableHdr *)table->getBytesNoCopy();
+    
+    if (table->getLength() < sizeof(*hdr) ||
+        OSSwapLittleToHostInt32(hdr->magic) != IBT_PATCH_TABLE_MAGIC ||
+        hdr->version != IBT_PATCH_TABLE_VERSION ||
+        OSSwapLittleToHostInt32(hdr->length) != table->getLength() - sizeof(*hdr)) {
+        return NULL;
+    }
+    return hdr;
+}
+
+/* Every record is sent on its own and its expected event awaited
+ * before the next one goes out. Command Complete and Command Status
+ * events must carry the opcode of the record, except those for opcode 0
+ * that only return credits. These and any other event that is not the
+ * expected one are skipped.
+ */
+bool BtIntel::
+intelSendPatchTable(const IntelPatchTableHdr *hdr, bool checkStatus, int timeout)
+{
+    const IntelPatchRecord *rec;
+    const uint8_t *ptr = (const uint8_t *)(hdr + 1);
+    const uint8_t *end = ptr + OSSwapLittleToHostInt32(hdr->length);
+    int count = OSSwapLittleToHostInt16(hdr->count);
+    uint8_t respBuf[CMD_BUF_MAX_SIZE];
+    HciResponse *resp = (HciResponse *)respBuf;
+    HciCmdStatus *status = (HciCmdStatus *)(respBuf + sizeof(HciEventHdr));
+    uint32_t actRespLen;
+    uint32_t recSize;
+    uint16_t opcode;
+    IOReturn ret;
+    
+    for (int i = 0; i < count; i++) {
+        rec = (const IntelPatchRecord *)ptr;
+        if ((size_t)(end - ptr) < sizeof(*rec) ||
+            (size_t)(end - ptr) < (recSize = IBT_PATCH_RECORD_SIZE(rec->len))) {
+            XYLog("Intel fw corrupted: invalid record %d\n", i);
+            return false;
+        }
+        /* The record carries the command exactly as it goes on the wire */
+        if ((ret = m_pTransport->sendHCIRequest((HciCommandHdr *)&rec->opcode, timeout)) != kIOReturnSuccess) {
+            XYLog("%s sendHCIRequest failed: %s %d\n", __FUNCTION__, m_pTransport->stringFromReturn(ret), ret);
+            return false;
+        }
+        ptr += recSize;
+        
+        for (;;) {
+            if ((ret = m_pTransport->interruptPipeRead(respBuf, sizeof(respBuf), &actRespLen, timeout)) != kIOReturnSuccess) {
+                XYLog("%s interruptPipeRead failed: %s %d\n", __FUNCTION__, m_pTransport->stringFromReturn(ret), ret);
+                return false;
+            }
+            if (actRespLen < sizeof(HciEventHdr)) {
+                XYLog("Intel patch event too short: %u bytes\n", actRespLen);
+                return false;
+            }
+            if (resp->evt.evt == HCI_EV_CMD_COMPLETE || resp->evt.evt == HCI_EV_CMD_STATUS) {
+                if (resp->evt.evt == HCI_EV_CMD_COMPLETE ? actRespLen < sizeof(HciResponse) :
+                    actRespLen < sizeof(HciEventHdr) + sizeof(HciCmdStatus)) {
+                    XYLog("Intel patch event 0x%02x too short: %u bytes\n", resp->evt.evt, actRespLen);
+                    return false;
+                }
+                if (resp->evt.evt == HCI_EV_CMD_COMPLETE)
+                    opcode = OSSwapLittleToHostInt16(resp->opcode);
+                else
+                    opcode = OSSwapLittleToHostInt16(status->opcode);
+                /* Only returns command credits, the answer is still to come */
+                if (!opcode)
+                    continue;
+                if (opcode != OSSwapLittleToHostInt16(rec->opcode)) {
+                    XYLog("Intel patch event mismatch: opcode 0x%4.4x expected 0x%4.4x\n",
+                          opcode, OSSwapLittleToHostInt16(rec->opcode));
+                    return false;
+                }
+                if (resp->evt.evt == HCI_EV_CMD_STATUS && status->status) {
+                    XYLog("sending Intel patch command (0x%4.4x) failed: status %d\n", opcode, status->status);
+                    return false;
+                }
+                if (resp->evt.evt == HCI_EV_CMD_COMPLETE && checkStatus &&
+                    actRespLen > sizeof(HciResponse) && resp->data[0]) {
+                    XYLog("sending Intel patch command (0x%4.4x) failed: status %d\n", opcode, resp->data[0]);
+                    return false;
+                }
+            } else if (hardwareError(resp, actRespLen)) {
+                return false;
+            }
+            if (resp->evt.evt == rec->evt)
+                break;
+        }
+    }
+    
+    XYLog("Intel patch table sent: %d commands\n", count);
+    return true;
+}
+
 bool BtIntel::
 intelBulkHCISync(HciCommandHdr *cmd, void *event, uint32_t eventBufSize, uint32_t *size, int timeout)
 {
 //    XYLog("%s cmd: 0x%02x len: %d\n", __FUNCTION__, cmd->opcode, cmd->len);
     IOReturn ret;
-    if ((ret = m_pUSBDeviceController->bulkWrite(cmd, HCI_COMMAND_HDR_SIZE + cmd->len, timeout)) != kIOReturnSuccess) {
-        XYLog("%s bulkWrite failed: %s %d\n", __FUNCTION__, m_pUSBDeviceController->stringFromReturn(ret), ret);
+    uint64_t start;
+    
+    drainLateBulkReply();
+    start = mach_absolute_time();
+    if ((ret = m_pTransport->bulkWrite(cmd, HCI_COMMAND_HDR_SIZE + cmd->len, timeout)) != kIOReturnSuccess) {
+        IBTTrace(m_pTrace, IBT_TRACE_ERROR, "intelBulkHCISync opcode 0x%04llx bulkWrite failed: 0x%llx\n",
+                 OSSwapLittleToHostInt16(cmd->opcode), (uint32_t)ret);
         return false;
     }
-    if ((ret = m_pUSBDeviceController->bulkPipeRead(event, eventBufSize, size, timeout)) != kIOReturnSuccess) {
-        XYLog("%s bulkPipeRead failed: %s %d\n", __FUNCTION__, m_pUSBDeviceController->stringFromReturn(ret), ret);
+    if ((ret = m_pTransport->bulkPipeRead(event, eventBufSize, size, timeout)) != kIOReturnSuccess) {
+        IBTTrace(m_pTrace, IBT_TRACE_ERROR, "intelBulkHCISync opcode 0x%04llx bulkPipeRead failed: 0x%llx\n",
+                 OSSwapLittleToHostInt16(cmd->opcode), (uint32_t)ret);
+        if (ret == kIOReturnTimeout) {
+            intelLatencyTimeout(m_pLatency, OSSwapLittleToHostInt16(cmd->opcode));
+            m_lateBulkOpcode = OSSwapLittleToHostInt16(cmd->opcode);
+        }
+        m_roundTrip[kRoundTripBulk].failures++;
         return false;
     }
+    intelPathRecord(&m_roundTrip[kRoundTripBulk], commandLatency(OSSwapLittleToHostInt16(cmd->opcode), start));
     return true;
 }
 
+static bool
+isCommandComplete(const uint8_t *event, uint32_t size, uint16_t opcode)
+{
+    return size >= 6 && event[0] == HCI_EV_CMD_COMPLETE &&
+        (event[3] | event[4] << 8) == opcode;
+}
+
+/* Of the idempotent commands, only the bootloader's own queries go on
+ * bulk: Read Boot Params and the legacy Read Version, which takes no
+ * parameters. The TLV Read Version of TyP and later and Read Debug
+ * Features of the operational firmware stay on control.
+ */
+static bool
+isBulkRoutable(const HciCommandHdr *cmd)
+{
+    switch (OSSwapLittleToHostInt16(cmd->opcode)) {
+        case 0xfc05:    /* Intel Read Version */
+            return cmd->len == 0;
+        case 0xfc0d:    /* Intel Read Boot Params */
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* The bootloader may answer these queries on either endpoint. The first
+ * one is sent a few times over each path, and the faster one carries
+ * them until the bootloader is left, or from the start of the next
+ * bring-up of the same controller. Bulk loses for good as soon as it is
+ * not answered.
+ */
+bool BtIntel::
+routeBulk(HciCommandHdr *cmd, void *event, uint32_t eventBufSize)
+{
+    if (!m_bootloader || !event || eventBufSize < 6 || !isBulkRoutable(cmd))
+        return false;
+    if (!m_route.probed)
+        probeRoute(cmd);
+    if (m_route.bulk && !m_route.rejected)
+        return true;
+    m_route.controlCommands++;
+    return false;
+}
+
+bool BtIntel::
+probeRoundTrip(HciCommandHdr *cmd, bool bulk, uint64_t *us)
+{
+    uint8_t buf[CMD_BUF_MAX_SIZE];
+    uint32_t actLen = 0;
+    uint64_t start = mach_absolute_time(), ns;
+    IOReturn ret;
+    
+    if (bulk) {
+        drainLateBulkReply();
+        ret = m_pTransport->bulkWrite(cmd, HCI_COMMAND_HDR_SIZE + cmd->len, IBT_ROUTE_PROBE_TIMEOUT);
+        if (ret == kIOReturnSuccess)
+            ret = m_pTransport->bulkPipeRead(buf, sizeof(buf), &actLen, IBT_ROUTE_PROBE_TIMEOUT);
+        if (ret == kIOReturnTimeout)
+            m_lateBulkOpcode = OSSwapLittleToHostInt16(cmd->opcode);
+    } else {
+        ret = m_pTransport->sendHCIRequest(cmd, HCI_CMD_TIMEOUT);
+        if (ret == kIOReturnSuccess)
+            ret = m_pTransport->interruptPipeRead(buf, sizeof(buf), &actLen, HCI_CMD_TIMEOUT);
+    }
+    absolutetime_to_nanoseconds(mach_absolute_time() - start, &ns);
+    *us += ns / 1000;
+    return ret == kIOReturnSuccess && isCommandComplete(buf, actLen, OSSwapLittleToHostInt16(cmd->opcode));
+}
+
+void BtIntel::
+probeRoute(HciCommandHdr *cmd)
+{
+    uint64_t controlUs = 0, bulkUs = 0;
+    
+    m_route.probed = true;
+    if (m_cached.routeProbed) {
+        m_route.bulk = m_cached.routeBulk;
+        m_route.controlUs = m_cached.routeControlUs;
+        m_route.bulkUs = m_cached.routeBulkUs;
+        XYLog("%s using %s as probed before at 0x%08x\n", __FUNCTION__, m_route.bulk ? "bulk" : "control",
+              m_location);
+        noteRoute();
+        return;
+    }
+    for (int i = 0; i < IBT_ROUTE_PROBES; i++) {
+        if (!probeRoundTrip(cmd, false, &controlUs)) {
+            XYLog("%s control probe failed, not routing\n", __FUNCTION__);
+            return;
+        }
+    }
+    for (int i = 0; i < IBT_ROUTE_PROBES; i++) {
+        if (!probeRoundTrip(cmd, true, &bulkUs)) {
+            XYLog("%s bulk probe not answered, staying on control\n", __FUNCTION__);
+            rejectBulk(OSSwapLittleToHostInt16(cmd->opcode));
+            return;
+        }
+    }
+    m_route.controlUs = controlUs / IBT_ROUTE_PROBES;
+    m_route.bulkUs = bulkUs / IBT_ROUTE_PROBES;
+    m_route.bulk = m_route.bulkUs < m_route.controlUs;
+    XYLog("%s control %llu us, bulk %llu us, using %s\n", __FUNCTION__, (unsigned long long)m_route.controlUs,
+          (unsigned long long)m_route.bulkUs, m_route.bulk ? "bulk" : "control");
+    noteRoute();
+}
+
+/* The bootloader may have answered opcode on the interrupt endpoint
+ * instead. drainLateReply() takes that answer, and only that one, off
+ * before the next control command goes out. A late answer on bulk is
+ * left to drainLateBulkReply().
+ */
+void BtIntel::
+rejectBulk(uint16_t opcode)
+{
+    m_route.rejected = true;
+    m_route.bulk = false;
+    m_lateOpcode = opcode;
+    noteRoute();
+}
+
+/* Kept for the next bring-up by saveResumeState() */
+void BtIntel::
+noteRoute()
+{
+    m_current.routeProbed = true;
+    m_current.routeBulk = m_route.bulk;
+    m_current.routeControlUs = m_route.controlUs;
+    m_current.routeBulkUs = m_route.bulkUs;
+}
+
+bool BtIntel::
+intelBulkRouted(HciCommandHdr *cmd, void *event, uint32_t eventBufSize, uint32_t *size, int timeout)
+{
+    uint16_t opcode = OSSwapLittleToHostInt16(cmd->opcode);
+    uint32_t actLen = 0;
+    
+    if (intelBulkHCISync(cmd, event, eventBufSize, &actLen, commandTimeout(opcode, timeout)) &&
+        !hardwareError(event, actLen) && isCommandComplete((const uint8_t *)event, actLen, opcode)) {
+        if (size)
+            *size = actLen;
+        m_route.bulkCommands++;
+        return true;
+    }
+    XYLog("%s opcode 0x%04x failed on bulk, falling back to control\n", __FUNCTION__, opcode);
+    m_route.fallbacks++;
+    rejectBulk(opcode);
+    return false;
+}
+
+OSDictionary *BtIntel::
+copyRoute()
+{
+    OSDictionary *dict;
+    OSString *path;
+    OSNumber *num;
+    const struct {
+        const char *key;
+        uint64_t value;
+    } numbers[] = {
+        { "probe_control_us", m_route.controlUs },
+        { "probe_bulk_us", m_route.bulkUs },
+        { "control_commands", m_route.controlCommands },
+        { "bulk_commands", m_route.bulkCommands },
+        { "fallbacks", m_route.fallbacks },
+    };
+    
+    if (!m_route.probed)
+        return NULL;
+    dict = OSDictionary::withCapacity(7);
+    if (!dict)
+        return NULL;
+    path = OSString::withCString(m_route.bulk ? "bulk" : "control");
+    if (path) {
+        dict->setObject("path", path);
+        path->release();
+    }
+    dict->setObject("bulk_rejected", m_route.rejected ? kOSBooleanTrue : kOSBooleanFalse);
+    for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++) {
+        num = OSNumber::withNumber(numbers[i].value, 64);
+        if (num) {
+            dict->setObject(numbers[i].key, num);
+            num->release();
+        }
+    }
+    return dict;
+}
+
+void BtIntel::
+measureRoundTrip(uint32_t count)
+{
+    IntelPathLatency *path = &m_roundTrip[kRoundTripControl];
+    HciCommandHdr cmd = {
+        .opcode = OSSwapHostToLittleInt16(0xfc05),
+        .len = 0,
+    };
+    uint8_t buf[CMD_BUF_MAX_SIZE];
+    uint32_t actLen;
+    uint64_t start, ns;
+    IOReturn ret;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        actLen = 0;
+        start = mach_absolute_time();
+        ret = m_pTransport->sendHCIRequest(&cmd, HCI_CMD_TIMEOUT);
+        if (ret == kIOReturnSuccess)
+            ret = m_pTransport->interruptPipeRead(buf, sizeof(buf), &actLen, HCI_CMD_TIMEOUT);
+        absolutetime_to_nanoseconds(mach_absolute_time() - start, &ns);
+        if (ret != kIOReturnSuccess) {
+            XYLog("%s round-trip %u failed: %s %d\n", __FUNCTION__, i, m_pTransport->stringFromReturn(ret), ret);
+            path->failures++;
+            /* A controller that stopped answering would cost a timeout
+             * per remaining command.
+             */
+            if (ret == kIOReturnTimeout)
+                break;
+            continue;
+        }
+        /* Anything but the Command Complete of this opcode, e.g. a
+         * vendor event that raced it, does not time the command.
+         */
+        if (!isCommandComplete(buf, actLen, 0xfc05)) {
+            path->failures++;
+            continue;
+        }
+        intelPathRecord(path, ns / 1000);
+    }
+    XYLog("%s %d of %u round-trips, mean %llu us\n", __FUNCTION__, path->samples, count,
+          (unsigned long long)(path->samples ? path->totalUs / path->samples : 0));
+}
+
+OSDictionary *BtIntel::
+copyRoundTrip()
+{
+    static const char *names[kRoundTripPathCount] = { "control", "bulk" };
+    OSDictionary *dict = NULL, *path;
+    
+    for (int i = 0; i < kRoundTripPathCount; i++) {
+        path = intelPathCopyDictionary(&m_roundTrip[i]);
+        if (!path)
+            continue;
+        if (!dict)
+            dict = OSDictionary::withCapacity(kRoundTripPathCount);
+        if (dict)
+            dict->setObject(names[i], path);
+        path->release();
+    }
+    return dict;
+}
+
 bool BtIntel::
 securedSend(uint8_t fragmentType, uint32_t len, const uint8_t *fragment)
 {
@@ -117,9 +676,10 @@ securedSend(uint8_t fragmentType, uint32_t len, const uint8_t *fragment)
         hciCommand->len = fragment_len + 1;
         hciCommand->data[0] = fragmentType;
         memcpy(hciCommand->data + 1, fragment, fragment_len);
+        m_timeline.account(fragment_len, 1);
         
         if (!(ret = intelBulkHCISync(hciCommand, NULL, 0, NULL, HCI_INIT_TIMEOUT))) {
-            XYLog("secure send failed\n");
+            IBTTrace(m_pTrace, IBT_TRACE_ERROR, "secure send of type %llu failed, %llu bytes left\n", fragmentType, len);
             return ret;
         }
         
@@ -133,6 +693,7 @@ securedSend(uint8_t fragmentType, uint32_t len, const uint8_t *fragment)
 bool BtIntel::
 intelVersionInfo(IntelVersion *ver)
 {
+    const IntelVariantTraits *traits = intelVariantTraits(ver->hw_variant);
     const char *variant;
     
     /* The hardware platform number has a fixed value of 0x37 and
@@ -150,19 +711,12 @@ intelVersionInfo(IntelVersion *ver)
      * This check has been put in place to ensure correct forward
      * compatibility options when newer hardware variants come along.
      */
-    switch (ver->hw_variant) {
-        case 0x0b:      /* SfP */
-        case 0x0c:      /* WsP */
-        case 0x11:      /* JfP */
-        case 0x12:      /* ThP */
-        case 0x13:      /* HrP */
-        case 0x14:      /* CcP */
-            break;
-        default:
-            XYLog("Unsupported Intel hardware variant (%u)\n",
-                  ver->hw_variant);
-            return false;
+    if (!traits || traits->generation != 2) {
+        XYLog("Unsupported Intel hardware variant (%u)\n",
+              ver->hw_variant);
+        return false;
     }
+    m_variant = traits;
     
     switch (ver->fw_variant) {
         case 0x06:
@@ -176,8 +730,8 @@ intelVersionInfo(IntelVersion *ver)
             return false;
     }
     
-    XYLog("%s revision %u.%u build %u week %u %u\n",
-          variant, ver->fw_revision >> 4, ver->fw_revision & 0x0f,
+    XYLog("%s %s revision %u.%u build %u week %u %u\n",
+          traits->name, variant, ver->fw_revision >> 4, ver->fw_revision & 0x0f,
           ver->fw_build_num, ver->fw_build_ww,
           2000 + ver->fw_build_yy);
     
@@ -190,9 +744,13 @@ intelBoot(uint32_t bootAddr)
     uint8_t buf[CMD_BUF_MAX_SIZE];
     uint32_t actLen = 0;
     HciResponse *resp = (HciResponse *)buf;
+    IntelPhaseScope phase(&m_timeline, kPhaseBoot);
     
+    setBootloader(false);
     if (!sendIntelReset(bootAddr)) {
+        phase.fail();
         XYLog("Intel Soft Reset failed\n");
+        noteFault(kRecoveryBootFailed);
         resetToBootloader();
         return false;
     }
@@ -204,9 +762,15 @@ intelBoot(uint32_t bootAddr)
      * 1 second. However if that happens, then just fail the setup
      * since something went wrong.
      */
-    IOReturn ret = m_pUSBDeviceController->interruptPipeRead(buf, sizeof(buf), &actLen, 1000);
-    if (ret != kIOReturnSuccess || actLen <= 0) {
+    uint64_t start = mach_absolute_time();
+    IOReturn ret = m_pTransport->interruptPipeRead(buf, sizeof(buf), &actLen,
+                                                   m_variant ? m_variant->bootMs : IBT_VARIANT_BOOT_MS);
+    if (ret == kIOReturnTimeout)
+        intelLatencyTimeout(m_pLatency, IBT_LATENCY_BOOT_NOTIFY);
+    if (ret != kIOReturnSuccess || actLen <= 0 || hardwareError(buf, actLen)) {
+        phase.fail();
         XYLog("Intel boot failed\n");
+        noteFault(kRecoveryBootFailed);
         if (ret == kIOReturnTimeout) {
             XYLog("Reset to bootloader\n");
             resetToBootloader();
@@ -215,17 +779,20 @@ intelBoot(uint32_t bootAddr)
     }
     if (resp->evt.evt == 0xff && resp->numCommands == 0x02) {
         XYLog("Notify: Device reboot done\n");
+        commandLatency(IBT_LATENCY_BOOT_NOTIFY, start);
         return true;
     }
+    phase.fail();
+    noteFault(kRecoveryBootFailed);
     return false;
 }
 
 bool BtIntel::
 loadDDCConfig(const char *ddcFileName)
 {
-    const uint8_t *fw_ptr;
-    uint8_t buf[CMD_BUF_MAX_SIZE];
-    HciCommandHdr *cmd = (HciCommandHdr *)buf;
+    const IntelPatchTableHdr *hdr;
+    bool ret;
+    IntelPhaseScope phase(&m_timeline, kPhaseDDC);
     
     OSData *fwData = requestFirmwareData(ddcFileName);
     
@@ -236,25 +803,27 @@ loadDDCConfig(const char *ddcFileName)
     
     XYLog("Load DDC config: %s %d\n", ddcFileName, fwData->getLength());
     
-    fw_ptr = (uint8_t *)fwData->getBytesNoCopy();
-    
     /* DDC file contains one or more DDC structure which has
      * Length (1 byte), DDC ID (2 bytes), and DDC value (Length - 2).
+     * They are compiled at build time into a table of Intel_Write_DDC
+     * commands, each of which must complete with a zero status. They go
+     * out one at a time like the Gen1 patch: the controller hands out a
+     * single command credit, so there is nothing to pipeline.
      */
-    while (fwData->getLength() > fw_ptr - (uint8_t *)fwData->getBytesNoCopy()) {
-        uint8_t cmd_plen = fw_ptr[0] + sizeof(uint8_t);
-
-        cmd->opcode = OSSwapHostToLittleInt16(0xfc8b);
-        cmd->len = cmd_plen;
-        memcpy(cmd->data, fw_ptr, cmd->len);
-        if (!intelSendHCISync(cmd, NULL, 0, NULL, HCI_INIT_TIMEOUT)) {
-            XYLog("Failed to send Intel_Write_DDC\n");
-            return false;
-        }
-
-        fw_ptr += cmd_plen;
+    hdr = patchTableHeader(fwData);
+    if (!hdr) {
+        XYLog("DDC file corrupted: %s\n", ddcFileName);
+        OSSafeReleaseNULL(fwData);
+        return false;
     }
+    m_timeline.account(OSSwapLittleToHostInt32(hdr->length), OSSwapLittleToHostInt16(hdr->count));
+    ret = intelSendPatchTable(hdr, true, HCI_INIT_TIMEOUT);
     OSSafeReleaseNULL(fwData);
+    if (!ret) {
+        phase.fail();
+        XYLog("Failed to send Intel_Write_DDC\n");
+        return false;
+    }
     
     XYLog("Load DDC config done\n");
     return true;
@@ -17,7 +17,12 @@
 #include <libkern/c++/OSObject.h>
 #include <libkern/libkern.h>
 
-#include "USBDeviceController.hpp"
+#include "HCITransport.hpp"
+#include "BtIntelTimeline.h"
+#include "BtIntelLatency.h"
+#include "BtIntelDeadline.h"
+#include "BtIntelResume.h"
+#include "BtIntelVariant.h"
 #include "Hci.h"
 
 typedef struct __attribute__((packed)) {
@@ -119,6 +124,33 @@ typedef struct __attribute__((packed))
     uint8_t     len;
 } FWCommandHdr;
 
+/* Gen1 .bseq and .ddc files are compiled by scripts/zlib_compress_fw.py
+ * into a header followed by 4-byte aligned records. Each record is the last
+ * expected event code followed by a ready to send HciCommandHdr.
+ */
+#define IBT_PATCH_TABLE_MAGIC       0x50544249  /* "IBTP" */
+#define IBT_PATCH_TABLE_VERSION     1
+#define IBT_PATCH_TABLE_F_ENABLE    0x01        /* table loads a patch (0xfc8e) */
+
+typedef struct __attribute__((packed))
+{
+    uint32_t    magic;
+    uint8_t     version;
+    uint8_t     flags;
+    uint16_t    count;
+    uint32_t    length;    /* size of the records following the header */
+} IntelPatchTableHdr;
+
+typedef struct __attribute__((packed))
+{
+    uint8_t     evt;
+    uint16_t    opcode;
+    uint8_t     len;
+    uint8_t     data[];
+} IntelPatchRecord;
+
+#define IBT_PATCH_RECORD_SIZE(len)  (((len) + sizeof(IntelPatchRecord) + 3) & ~3)
+
 #define HCI_OP_INTEL_VERSION 0xfc05
 #define HCI_OP_INTEL_RESET 0xfc52
 #define HCI_OP_INTEL_RESET_BOOT 0xfc01
@@ -141,11 +173,49 @@ typedef struct __attribute__((packed))
 
 #define CMD_BUF_MAX_SIZE    256
 
+/* How long the first answer of a resent command is waited for */
+#define IBT_LATE_REPLY_TIMEOUT  50      /* ms */
+
+/* Endpoint paths timed by measureRoundTrip() */
+enum IntelRoundTripPath {
+    kRoundTripControl,      /* sendHCIRequest + interruptPipeRead */
+    kRoundTripBulk,         /* bulkWrite + bulkPipeRead */
+    kRoundTripPathCount,
+};
+
+/* Probes per path before the bootloader routes a command type */
+#define IBT_ROUTE_PROBES        4
+/* A bulk probe not answered by then means the bootloader rejects it */
+#define IBT_ROUTE_PROBE_TIMEOUT 100     /* ms */
+
+/* Where the idempotent vendor commands of the bootloader go. Secure
+ * send always takes bulk, everything else starts out on control.
+ */
+struct IntelRouteStats {
+    bool probed;
+    bool bulk;
+    bool rejected;
+    uint64_t controlUs;     /* mean probe round-trip */
+    uint64_t bulkUs;
+    uint32_t controlCommands;
+    uint32_t bulkCommands;
+    uint32_t fallbacks;
+};
+
+class IOService;
+class IOUSBHostDevice;
+
 class BtIntel : public OSObject {
     OSDeclareAbstractStructors(BtIntel)
 public:
     
-    virtual bool initWithDevice(IOService *client, IOUSBHostDevice *dev);
+    /* Opens the USB transport of dev, see BtIntelUSB.cpp. Only built
+     * into the kext.
+     */
+    bool initWithDevice(IOService *client, IOUSBHostDevice *dev);
+    
+    virtual bool initWithTransport(HCITransport *transport, uint32_t location = 0,
+                                   IntelSkuLatency *latency = NULL);
     
     virtual void free() override;
     
@@ -181,22 +251,138 @@ public:
     
     bool setDebugFeatures(IntelDebugFeatures *features);
     
+    virtual bool enableTelemetry();
+    
     bool loadDDCConfig(const char *ddcFileName);
     
     OSData *firmwareConvertion(OSData *originalFirmware);
     
+    OSData *requestFirmwareResource(const char *fwName);
+    
     OSData *requestFirmwareData(const char *fwName, bool noWarn = false);
     
+    IntelTimeline *getTimeline() { return &m_timeline; }
+    
+    OSDictionary *copyUSBStats() { return m_pTransport ? m_pTransport->copyStats() : NULL; }
+    
+    OSDictionary *copyLatency() { return intelLatencyCopyDictionary(m_pLatency); }
+    
+    /* Times count Read Version round-trips on the control path of the
+     * running firmware. The bulk path only answers the bootloader, so
+     * its samples are the secure send fragments of the download.
+     */
+    void measureRoundTrip(uint32_t count);
+    
+    OSDictionary *copyRoundTrip();
+    
+    OSDictionary *copyRoute();
+    
+    OSData *copySnoop() { return m_pTransport ? m_pTransport->copySnoop() : NULL; }
+    
+    void setSnapLen(uint32_t len) { if (m_pTransport) m_pTransport->setSnapLen(len); }
+    
+    void setSetupBudget(uint32_t ms) { m_deadline.arm(ms, &m_timeline); }
+    
+    IntelDeadline *getDeadline() { return &m_deadline; }
+    
+    IntelTraceRing *getTrace() { return m_pTrace; }
+    
+    /* True when an earlier bring-up of this controller was cached, see
+     * IntelResumeCache.
+     */
+    bool isResume() { return m_cached.firmware != NULL; }
+    
+    bool firmwareSurvived() { return m_survived; }
+    
+    uint32_t getLocation() { return m_location; }
+    
+    IntelRecoveryCause getFault() { return m_fault == kRecoveryCauseCount ? kRecoverySetupFailed : m_fault; }
+    
+    void saveResumeState();
+    
+    void dropResumeState();
+    
 protected:
     
+    void noteIdentity(const void *version, uint32_t len);
+    
+    void noteFault(IntelRecoveryCause cause);
+    
+    bool hardwareError(const void *event, uint32_t size);
+    
+    bool resumeFastPath();
+    
+    void keepFirmware(OSData *fwData, uint32_t bootAddr);
+    
+    /* Answers the bootloader gave the last bring-up, while the first
+     * version response matches it. See IntelResumeState.
+     */
+    bool cachedLegacyVersion(IntelVersion *ver);
+    
+    void noteLegacyVersion(const IntelVersion *ver);
+    
+    bool cachedBootParams(IntelBootParams *params);
+    
+    void noteBootParams(const IntelBootParams *params);
+    
+    bool cachedVersionAfterBoot();
+    
+    int commandTimeout(uint16_t opcode, int timeout);
+    
+    uint64_t commandLatency(uint16_t opcode, uint64_t start);
+    
+    IOReturn readCommandEvent(uint16_t opcode, void *event, uint32_t eventBufSize, uint32_t *size, int timeout);
+    
+    bool drainLateReply(void *event, uint32_t eventBufSize, uint32_t *size);
+    
+    void drainLateBulkReply();
+    
     bool intelSendHCISync(HciCommandHdr *cmd, void *event, uint32_t eventBufSize, uint32_t *size, int timeout);
     
     bool intelSendHCISyncEvent(HciCommandHdr *cmd, void *event, uint32_t eventBufSize, uint32_t *size, uint8_t syncEvent, int timeout);
     
+    const IntelPatchTableHdr *patchTableHeader(OSData *table);
+    
+    bool intelSendPatchTable(const IntelPatchTableHdr *hdr, bool checkStatus, int timeout);
+    
     bool intelBulkHCISync(HciCommandHdr *cmd, void *event, uint32_t eventBufSize, uint32_t *size, int timeout);
     
+    /* Set once the bootloader is identified, until intelBoot() */
+    void setBootloader(bool bootloader) { m_bootloader = bootloader; }
+    
+    bool routeBulk(HciCommandHdr *cmd, void *event, uint32_t eventBufSize);
+    
+    void probeRoute(HciCommandHdr *cmd);
+    
+    bool probeRoundTrip(HciCommandHdr *cmd, bool bulk, uint64_t *us);
+    
+    void rejectBulk(uint16_t opcode);
+    
+    void noteRoute();
+    
+    bool intelBulkRouted(HciCommandHdr *cmd, void *event, uint32_t eventBufSize, uint32_t *size, int timeout);
+    
 protected:
-    USBDeviceController *m_pUSBDeviceController;
+    HCITransport *m_pTransport;
+    IntelTimeline m_timeline;
+    IntelSkuLatency *m_pLatency;
+    IntelPathLatency m_roundTrip[kRoundTripPathCount];
+    IntelRouteStats m_route;
+    /* Opcode whose first answer may still be queued, see drainLateReply() */
+    uint16_t m_lateOpcode;
+    /* The same on the bulk endpoint, see drainLateBulkReply() */
+    uint16_t m_lateBulkOpcode;
+    bool m_bootloader;
+    IntelDeadline m_deadline;
+    IntelTraceRing *m_pTrace;
+    uint32_t m_location;
+    IntelResumeState m_cached;
+    IntelResumeState m_current;
+    bool m_survived;
+    bool m_identityKnown;
+    /* Set once the version response named the hardware variant */
+    const IntelVariantTraits *m_variant;
+    IntelRecoveryCause m_fault;
 };
 
 #endif /* BtIntel_h */
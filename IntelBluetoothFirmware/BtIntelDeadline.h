@@ -0,0 +1,74 @@
+//
+//  BtIntelDeadline.h
+//  IntelBluetoothFirmware
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef BtIntelDeadline_h
+#define BtIntelDeadline_h
+
+#include <kern/clock.h>
+
+#include "BtIntelTimeline.h"
+
+/* Overall time budget of one setup() in ms, can be changed with the
+ * ibtbudget=<ms> boot-arg, 0 disables it.
+ */
+#define IBT_SETUP_BUDGET    20000
+
+/* Every USB wait during setup is clamped to what is left of the budget,
+ * so nested helpers with their own full timeouts cannot add up to tens
+ * of seconds. Once the budget is gone all waits fail immediately, and
+ * the phase that was running at that point is remembered.
+ */
+class IntelDeadline {
+public:
+    void arm(uint32_t ms, IntelTimeline *timeline)
+    {
+        budgetMs = ms;
+        this->timeline = timeline;
+        expired = false;
+        expiredPhase = kPhaseNone;
+        if (ms)
+            clock_interval_to_deadline(ms, kMillisecondScale, &deadline);
+    }
+
+    void disarm() { budgetMs = 0; }
+
+    /* Returns the timeout to use, 0 once the budget is exhausted */
+    uint32_t clamp(uint32_t timeout)
+    {
+        uint64_t now, ns;
+
+        if (!budgetMs)
+            return timeout;
+        now = mach_absolute_time();
+        if (now < deadline) {
+            absolutetime_to_nanoseconds(deadline - now, &ns);
+            if (ns >= 1000000)
+                return (ns / 1000000 < timeout) ? (uint32_t)(ns / 1000000) : timeout;
+        }
+        if (!expired) {
+            expired = true;
+            expiredPhase = timeline ? timeline->current() : kPhaseNone;
+        }
+        return 0;
+    }
+
+    uint32_t budget() { return budgetMs; }
+
+    bool isExpired() { return expired; }
+
+    IntelPhase phase() { return expiredPhase; }
+
+private:
+    IntelTimeline *timeline;
+    uint64_t deadline;
+    uint32_t budgetMs;
+    bool expired;
+    IntelPhase expiredPhase;
+};
+
+#endif /* BtIntelDeadline_h */
@@ -9,6 +9,34 @@
 #include "Log.h"
 #include "BtIntel.h"
 #include "FwData.h"
+#include <libkern/OSKextLib.h>
+
+/* Firmware that is not embedded in the kext is looked up in the
+ * bundle's Resources folder as "<name>.zlib", see IBT_FW_EXTERNAL and
+ * scripts/zlib_compress_fw.py. The request is served by the kext
+ * daemon, so this only works once userspace is up.
+ */
+#define FW_RESOURCE_SUFFIX      ".zlib"
+#define FW_RESOURCE_TIMEOUT     10000
+
+struct FwResourceRequest {
+    IOLock *lock;
+    OSData *data;
+    bool done;
+};
+
+static void
+firmwareResourceCallback(OSKextRequestTag requestTag, OSReturn result, const void *resourceData, uint32_t resourceDataLength, void *context)
+{
+    FwResourceRequest *request = (FwResourceRequest *)context;
+    
+    IOLockLock(request->lock);
+    if (result == kOSReturnSuccess && resourceData && resourceDataLength)
+        request->data = OSData::withBytes(resourceData, resourceDataLength);
+    request->done = true;
+    IOLockWakeup(request->lock, request, true);
+    IOLockUnlock(request->lock);
+}
 
 OSData *BtIntel::
 firmwareConvertion(OSData *originalFirmware)
@@ -27,20 +55,228 @@ firmwareConvertion(OSData *originalFirmware)
 }
 
 OSData *BtIntel::
-requestFirmwareData(const char *fwName, bool noWarn)
+requestFirmwareResource(const char *fwName)
 {
-    OSData * _fwData = getFWDescByName(fwName);
-    if (!_fwData) {
-        if (!noWarn)
-            XYLog("Firmware: %s Not found!\n", fwName);
+    char resourceName[64];
+    FwResourceRequest request;
+    OSKextRequestTag requestTag;
+    AbsoluteTime deadline;
+    OSReturn ret;
+    
+    snprintf(resourceName, sizeof(resourceName), "%s" FW_RESOURCE_SUFFIX, fwName);
+    request.lock = IOLockAlloc();
+    request.data = NULL;
+    request.done = false;
+    if (!request.lock)
+        return NULL;
+    
+    ret = OSKextRequestResource(OSKextGetCurrentIdentifier(), resourceName, firmwareResourceCallback, &request, &requestTag);
+    if (ret != kOSReturnSuccess) {
+        IOLockFree(request.lock);
         return NULL;
     }
+    
+    clock_interval_to_deadline(m_deadline.clamp(FW_RESOURCE_TIMEOUT), kMillisecondScale, reinterpret_cast<uint64_t*> (&deadline));
+    IOLockLock(request.lock);
+    while (!request.done) {
+        if (IOLockSleepDeadline(request.lock, &request, deadline, THREAD_UNINT) == THREAD_TIMED_OUT)
+            break;
+    }
+    if (!request.done) {
+        IOLockUnlock(request.lock);
+        /* The callback must not run against our stack once we return,
+         * so either cancel it or wait for it to finish.
+         */
+        if (OSKextCancelRequest(requestTag, NULL) != kOSReturnSuccess) {
+            IOLockLock(request.lock);
+            while (!request.done)
+                IOLockSleep(request.lock, &request, THREAD_UNINT);
+            IOLockUnlock(request.lock);
+        } else {
+            XYLog("Firmware resource %s request timeout\n", resourceName);
+        }
+    } else {
+        IOLockUnlock(request.lock);
+    }
+    IOLockFree(request.lock);
+    return request.data;
+}
+
+OSData *BtIntel::
+requestFirmwareData(const char *fwName, bool noWarn)
+{
+    OSData *_fwData;
+    OSData *fwData;
+    
+    /* The image of the last bring-up is already inflated */
+    if (m_cached.firmware && !strncmp(fwName, m_cached.fwName, sizeof(m_cached.fwName))) {
+        XYLog("Found cached device firmware %s\n", fwName);
+        m_cached.firmware->retain();
+        return m_cached.firmware;
+    }
+    {
+        IntelPhaseScope phase(&m_timeline, kPhaseFirmwareLookup);
+        _fwData = getFWDescByName(fwName);
+        if (!_fwData && fwExternal)
+            _fwData = requestFirmwareResource(fwName);
+        if (!_fwData) {
+            if (!noWarn)
+                XYLog("Firmware: %s Not found!\n", fwName);
+            return NULL;
+        }
+        m_timeline.account(_fwData->getLength(), 1);
+    }
     XYLog("Found device firmware %s \n", fwName);
-    OSData *fwData = firmwareConvertion(_fwData);
-    OSSafeReleaseNULL(_fwData);
+    {
+        IntelPhaseScope phase(&m_timeline, kPhaseInflate);
+        fwData = firmwareConvertion(_fwData);
+        OSSafeReleaseNULL(_fwData);
+        if (fwData)
+            m_timeline.account(fwData->getLength(), 1);
+        else
+            phase.fail();
+    }
     if (fwData == NULL) {
         XYLog("Firmware %s uncompress fail!\n", fwName);
         return NULL;
     }
     return fwData;
 }
+
+void BtIntel::
+noteIdentity(const void *version, uint32_t len)
+{
+    m_current.identityLen = min(len, (uint32_t)sizeof(m_current.identity));
+    memcpy(m_current.identity, version, m_current.identityLen);
+    if (m_current.probeIdentityLen)
+        return;
+    
+    /* The first answer of the bring-up decides if what the bootloader
+     * told the last one still holds.
+     */
+    m_current.probeIdentityLen = m_current.identityLen;
+    memcpy(m_current.probeIdentity, m_current.identity, m_current.identityLen);
+    if (!m_cached.probeIdentityLen)
+        return;
+    if (m_cached.probeIdentityLen == m_current.probeIdentityLen &&
+        !memcmp(m_cached.probeIdentity, m_current.probeIdentity, m_current.probeIdentityLen)) {
+        m_identityKnown = true;
+        return;
+    }
+    XYLog("Version response at 0x%08x changed, forgetting the cached identity\n", m_location);
+    m_cached.probeIdentityLen = 0;
+    m_cached.legacyVersionLen = 0;
+    m_cached.bootParamsLen = 0;
+}
+
+bool BtIntel::
+cachedLegacyVersion(IntelVersion *ver)
+{
+    if (!m_identityKnown || m_cached.legacyVersionLen != sizeof(*ver))
+        return false;
+    memcpy(ver, m_cached.legacyVersion, sizeof(*ver));
+    noteLegacyVersion(ver);
+    XYLog("Using the cached legacy version\n");
+    return true;
+}
+
+void BtIntel::
+noteLegacyVersion(const IntelVersion *ver)
+{
+    static_assert(sizeof(*ver) <= IBT_RESUME_PARAMS_MAX, "legacy version does not fit the resume state");
+    m_current.legacyVersionLen = sizeof(*ver);
+    memcpy(m_current.legacyVersion, ver, sizeof(*ver));
+}
+
+bool BtIntel::
+cachedBootParams(IntelBootParams *params)
+{
+    if (!m_identityKnown || m_cached.bootParamsLen != sizeof(*params))
+        return false;
+    memcpy(params, m_cached.bootParams, sizeof(*params));
+    noteBootParams(params);
+    XYLog("Using the cached boot params, device revision %u\n",
+          OSSwapLittleToHostInt16(params->dev_revid));
+    return true;
+}
+
+void BtIntel::
+noteBootParams(const IntelBootParams *params)
+{
+    static_assert(sizeof(*params) <= IBT_RESUME_PARAMS_MAX, "boot params do not fit the resume state");
+    m_current.bootParamsLen = sizeof(*params);
+    memcpy(m_current.bootParams, params, sizeof(*params));
+}
+
+/* The version read after boot only confirms what the last bring-up of
+ * the same bootloader read after booting the same firmware, and leaves
+ * the identity resumeFastPath() compares against.
+ */
+bool BtIntel::
+cachedVersionAfterBoot()
+{
+    char fwName[64];
+    
+    if (!m_identityKnown || !m_cached.identityLen ||
+        !getFirmwareName(fwName, sizeof(fwName)) ||
+        strncmp(fwName, m_cached.fwName, sizeof(m_cached.fwName)))
+        return false;
+    m_current.identityLen = m_cached.identityLen;
+    memcpy(m_current.identity, m_cached.identity, m_cached.identityLen);
+    XYLog("Skipping the version read after boot of %s\n", fwName);
+    return true;
+}
+
+/* Called right after the first version query of setup(). When the
+ * controller answers exactly like it did once the cached bring-up had
+ * finished, its operational firmware survived and nothing has to be
+ * loaded.
+ */
+bool BtIntel::
+resumeFastPath()
+{
+    if (!m_cached.firmware || !m_current.identityLen ||
+        m_current.identityLen != m_cached.identityLen ||
+        memcmp(m_current.identity, m_cached.identity, m_current.identityLen))
+        return false;
+    XYLog("Firmware %s survived, skipping the download\n", m_cached.fwName);
+    m_survived = true;
+    keepFirmware(m_cached.firmware, m_cached.bootAddr);
+    return true;
+}
+
+void BtIntel::
+keepFirmware(OSData *fwData, uint32_t bootAddr)
+{
+    fwData->retain();
+    OSSafeReleaseNULL(m_current.firmware);
+    m_current.firmware = fwData;
+    m_current.bootAddr = bootAddr;
+}
+
+void BtIntel::
+saveResumeState()
+{
+    if (!m_location || !m_current.firmware)
+        return;
+    m_current.location = m_location;
+    getFirmwareName(m_current.fwName, sizeof(m_current.fwName));
+    /* A bring-up that left the bootloader early never asked */
+    if (!m_current.routeProbed && m_cached.routeProbed) {
+        m_current.routeProbed = true;
+        m_current.routeBulk = m_cached.routeBulk;
+        m_current.routeControlUs = m_cached.routeControlUs;
+        m_current.routeBulkUs = m_cached.routeBulkUs;
+    }
+    IntelResumeCache::store(&m_current);
+}
+
+/* The image stays cached for the retry, only the identity is no longer
+ * trusted.
+ */
+void BtIntel::
+dropResumeState()
+{
+    if (m_location)
+        IntelResumeCache::invalidate(m_location);
+}
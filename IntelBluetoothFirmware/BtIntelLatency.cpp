@@ -0,0 +1,222 @@
+//
+//  BtIntelLatency.cpp
+//  IntelBluetoothFirmware
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "BtIntelLatency.h"
+#include "Hci.h"
+#include <libkern/c++/OSArray.h>
+#include <libkern/c++/OSNumber.h>
+
+static IntelSkuLatency latencyTable[IBT_LATENCY_SKUS];
+
+IntelSkuLatency *
+intelLatencyForSku(uint16_t vendorID, uint16_t productID)
+{
+    UInt32 sku = ((UInt32)vendorID << 16) | productID;
+    
+    for (int i = 0; i < IBT_LATENCY_SKUS; i++) {
+        if (latencyTable[i].sku == sku ||
+            OSCompareAndSwap(0, sku, &latencyTable[i].sku))
+            return &latencyTable[i];
+    }
+    return NULL;
+}
+
+static IntelOpcodeLatency *
+opcodeLatency(IntelSkuLatency *table, uint16_t opcode, bool create)
+{
+    if (!table || !opcode)
+        return NULL;
+    for (int i = 0; i < IBT_LATENCY_OPCODES; i++) {
+        IntelOpcodeLatency *entry = &table->opcodes[i];
+        if (entry->opcode == opcode)
+            return entry;
+        if (!entry->opcode) {
+            if (!create)
+                return NULL;
+            if (OSCompareAndSwap(0, opcode, &entry->opcode) || entry->opcode == opcode)
+                return entry;
+        }
+    }
+    return NULL;
+}
+
+static int
+latencyBucket(uint64_t us)
+{
+    int bucket = 0;
+    
+    while (us > 1 && bucket < IBT_LATENCY_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void
+intelLatencyRecord(IntelSkuLatency *table, uint16_t opcode, uint64_t us)
+{
+    IntelOpcodeLatency *entry = opcodeLatency(table, opcode, true);
+    
+    if (!entry)
+        return;
+    OSIncrementAtomic(&entry->buckets[latencyBucket(us)]);
+    OSIncrementAtomic(&entry->samples);
+}
+
+void
+intelLatencyTimeout(IntelSkuLatency *table, uint16_t opcode)
+{
+    IntelOpcodeLatency *entry = opcodeLatency(table, opcode, true);
+    
+    if (entry)
+        OSIncrementAtomic(&entry->timeouts);
+}
+
+/* Upper bound in us of the bucket holding the given percentile */
+static uint64_t
+percentile(const volatile SInt32 *buckets, SInt32 samples, int pct)
+{
+    SInt64 want = ((SInt64)samples * pct + 99) / 100;
+    SInt64 seen = 0;
+    
+    for (int i = 0; i < IBT_LATENCY_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= want)
+            return 2ULL << i;
+    }
+    return 2ULL << (IBT_LATENCY_BUCKETS - 1);
+}
+
+int
+intelLatencyCommandTimeout(IntelSkuLatency *table, uint16_t opcode, int timeout)
+{
+    IntelOpcodeLatency *entry = opcodeLatency(table, opcode, false);
+    uint64_t ms;
+    
+    if (!entry || entry->samples < IBT_LATENCY_MIN_SAMPLES)
+        return timeout;
+    ms = percentile(entry->buckets, entry->samples, 99) * IBT_LATENCY_FACTOR / 1000;
+    if (ms < IBT_LATENCY_FLOOR)
+        ms = IBT_LATENCY_FLOOR;
+    return ms < (uint64_t)timeout ? (int)ms : timeout;
+}
+
+/* Only commands that can simply be sent again are cut short by the
+ * learned timeout, everything else keeps waiting the full constant.
+ */
+bool
+intelLatencyIdempotent(uint16_t opcode)
+{
+    switch (opcode) {
+        case 0xfc05:    /* Intel Read Version */
+        case 0xfc0d:    /* Intel Read Boot Params */
+        case 0xfca6:    /* Intel Read Debug Features */
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void
+setLatencyNumber(OSDictionary *dict, const char *key, uint64_t value)
+{
+    OSNumber *num = OSNumber::withNumber(value, 64);
+    if (num) {
+        dict->setObject(key, num);
+        num->release();
+    }
+}
+
+OSDictionary *
+intelLatencyCopyDictionary(IntelSkuLatency *table)
+{
+    OSDictionary *dict;
+    char key[8];
+    
+    if (!table)
+        return NULL;
+    dict = OSDictionary::withCapacity(IBT_LATENCY_OPCODES);
+    if (!dict)
+        return NULL;
+    for (int i = 0; i < IBT_LATENCY_OPCODES; i++) {
+        IntelOpcodeLatency *entry = &table->opcodes[i];
+        if (!entry->opcode || !entry->samples)
+            continue;
+        OSDictionary *op = OSDictionary::withCapacity(5);
+        if (!op)
+            break;
+        setLatencyNumber(op, "samples", entry->samples);
+        setLatencyNumber(op, "timeouts", entry->timeouts);
+        setLatencyNumber(op, "p50_us", percentile(entry->buckets, entry->samples, 50));
+        setLatencyNumber(op, "p99_us", percentile(entry->buckets, entry->samples, 99));
+        setLatencyNumber(op, "timeout_ms", intelLatencyCommandTimeout(table, entry->opcode, HCI_INIT_TIMEOUT));
+        snprintf(key, sizeof(key), "0x%04x", entry->opcode);
+        dict->setObject(key, op);
+        op->release();
+    }
+    return dict;
+}
+
+void
+intelPathReset(IntelPathLatency *path)
+{
+    memset(path, 0, sizeof(*path));
+    path->minUs = UINT64_MAX;
+}
+
+void
+intelPathRecord(IntelPathLatency *path, uint64_t us)
+{
+    path->buckets[latencyBucket(us)]++;
+    path->samples++;
+    path->totalUs += us;
+    if (us < path->minUs)
+        path->minUs = us;
+    if (us > path->maxUs)
+        path->maxUs = us;
+}
+
+/* min, mean and max are exact, the percentiles are bucket bounds like
+ * the ones of intelLatencyCopyDictionary().
+ */
+OSDictionary *
+intelPathCopyDictionary(const IntelPathLatency *path)
+{
+    OSDictionary *dict;
+    OSArray *buckets;
+    
+    if (!path->samples && !path->failures)
+        return NULL;
+    dict = OSDictionary::withCapacity(9);
+    buckets = OSArray::withCapacity(IBT_LATENCY_BUCKETS);
+    if (!dict || !buckets) {
+        OSSafeReleaseNULL(dict);
+        OSSafeReleaseNULL(buckets);
+        return NULL;
+    }
+    setLatencyNumber(dict, "samples", path->samples);
+    setLatencyNumber(dict, "failures", path->failures);
+    if (path->samples) {
+        setLatencyNumber(dict, "min_us", path->minUs);
+        setLatencyNumber(dict, "mean_us", path->totalUs / path->samples);
+        setLatencyNumber(dict, "max_us", path->maxUs);
+        setLatencyNumber(dict, "p50_us", percentile(path->buckets, path->samples, 50));
+        setLatencyNumber(dict, "p99_us", percentile(path->buckets, path->samples, 99));
+    }
+    /* Bucket i counts round-trips below 2^(i + 1) us */
+    for (int i = 0; i < IBT_LATENCY_BUCKETS; i++) {
+        OSNumber *num = OSNumber::withNumber(path->buckets[i], 32);
+        if (num) {
+            buckets->setObject(num);
+            num->release();
+        }
+    }
+    dict->setObject("buckets", buckets);
+    buckets->release();
+    return dict;
+}
@@ -0,0 +1,79 @@
+//
+//  BtIntelLatency.h
+//  IntelBluetoothFirmware
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef BtIntelLatency_h
+#define BtIntelLatency_h
+
+#include <libkern/OSAtomic.h>
+#include <libkern/c++/OSDictionary.h>
+
+/* Command latencies are learned per SKU (USB vid:pid) and per opcode in
+ * a table that lives as long as the kext, so a replug or reload of the
+ * same controller starts from what was observed before. Updates are
+ * lock free.
+ */
+#define IBT_LATENCY_SKUS            4
+#define IBT_LATENCY_OPCODES         24
+#define IBT_LATENCY_BUCKETS         24      /* log2 us, up to ~16s */
+
+/* Not enough samples yet, keep the caller's constant */
+#define IBT_LATENCY_MIN_SAMPLES     8
+/* Timeout = p99 bucket bound * factor, clamped to [floor, constant] */
+#define IBT_LATENCY_FACTOR          4
+#define IBT_LATENCY_FLOOR           100     /* ms */
+
+/* Waits that are not command round-trips, tracked under the vendor
+ * event they wait for.
+ */
+#define IBT_LATENCY_BOOT_NOTIFY     0xff02
+#define IBT_LATENCY_DOWNLOAD_NOTIFY 0xff06
+
+struct IntelOpcodeLatency {
+    volatile UInt32 opcode;
+    volatile SInt32 samples;
+    volatile SInt32 timeouts;
+    volatile SInt32 buckets[IBT_LATENCY_BUCKETS];
+};
+
+struct IntelSkuLatency {
+    volatile UInt32 sku;
+    IntelOpcodeLatency opcodes[IBT_LATENCY_OPCODES];
+};
+
+IntelSkuLatency *intelLatencyForSku(uint16_t vendorID, uint16_t productID);
+
+void intelLatencyRecord(IntelSkuLatency *table, uint16_t opcode, uint64_t us);
+
+void intelLatencyTimeout(IntelSkuLatency *table, uint16_t opcode);
+
+int intelLatencyCommandTimeout(IntelSkuLatency *table, uint16_t opcode, int timeout);
+
+bool intelLatencyIdempotent(uint16_t opcode);
+
+OSDictionary *intelLatencyCopyDictionary(IntelSkuLatency *table);
+
+/* Round-trip distribution of one endpoint path of one controller, as
+ * measured by BtIntel::measureRoundTrip(). Only the thread doing the
+ * bring-up touches it.
+ */
+struct IntelPathLatency {
+    SInt32 samples;
+    SInt32 failures;
+    uint64_t minUs;
+    uint64_t maxUs;
+    uint64_t totalUs;
+    SInt32 buckets[IBT_LATENCY_BUCKETS];
+};
+
+void intelPathReset(IntelPathLatency *path);
+
+void intelPathRecord(IntelPathLatency *path, uint64_t us);
+
+OSDictionary *intelPathCopyDictionary(const IntelPathLatency *path);
+
+#endif /* BtIntelLatency_h */
@@ -0,0 +1,286 @@
+//
+//  BtIntelResume.cpp
+//  IntelBluetoothFirmware
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "BtIntelResume.h"
+#include <IOKit/IOLocks.h>
+#include <libkern/OSAtomic.h>
+#include <libkern/c++/OSNumber.h>
+#include <kern/clock.h>
+
+static IntelResumeState resumeEntries[IBT_RESUME_ENTRIES];
+static IntelRecoveryStats recoveryEntries[IBT_RESUME_ENTRIES];
+static IOLock *resumeLock;
+
+/* There is no kext wide start routine to allocate the lock in, so the
+ * first caller installs it.
+ */
+static IOLock *
+resumeCacheLock()
+{
+    if (!resumeLock) {
+        IOLock *lock = IOLockAlloc();
+        if (lock && !OSCompareAndSwapPtr(NULL, lock, (void * volatile *)&resumeLock))
+            IOLockFree(lock);
+    }
+    return resumeLock;
+}
+
+static IntelResumeState *
+resumeFind(uint32_t location)
+{
+    for (int i = 0; i < IBT_RESUME_ENTRIES; i++) {
+        if (resumeEntries[i].firmware && resumeEntries[i].location == location)
+            return &resumeEntries[i];
+    }
+    return NULL;
+}
+
+bool IntelResumeCache::
+copy(uint32_t location, IntelResumeState *state)
+{
+    IOLock *lock = resumeCacheLock();
+    IntelResumeState *entry;
+
+    memset(state, 0, sizeof(*state));
+    if (!lock)
+        return false;
+    IOLockLock(lock);
+    entry = resumeFind(location);
+    if (entry) {
+        *state = *entry;
+        state->firmware->retain();
+    }
+    IOLockUnlock(lock);
+    return entry != NULL;
+}
+
+void IntelResumeCache::
+store(const IntelResumeState *state)
+{
+    IOLock *lock = resumeCacheLock();
+    IntelResumeState *entry;
+    OSData *old;
+
+    if (!lock || !state->firmware)
+        return;
+    IOLockLock(lock);
+    entry = resumeFind(state->location);
+    /* Otherwise take a free slot, or drop the first one */
+    for (int i = 0; !entry && i < IBT_RESUME_ENTRIES; i++) {
+        if (!resumeEntries[i].firmware)
+            entry = &resumeEntries[i];
+    }
+    if (!entry)
+        entry = &resumeEntries[0];
+    old = entry->firmware;
+    *entry = *state;
+    entry->firmware->retain();
+    IOLockUnlock(lock);
+    OSSafeReleaseNULL(old);
+}
+
+void IntelResumeCache::
+invalidate(uint32_t location)
+{
+    IOLock *lock = resumeCacheLock();
+    IntelResumeState *entry;
+
+    if (!lock)
+        return;
+    IOLockLock(lock);
+    entry = resumeFind(location);
+    if (entry) {
+        entry->identityLen = 0;
+        entry->probeIdentityLen = 0;
+        entry->routeProbed = false;
+    }
+    IOLockUnlock(lock);
+}
+
+void IntelResumeCache::
+remove(uint32_t location)
+{
+    IOLock *lock = resumeCacheLock();
+    IntelResumeState *entry;
+    OSData *old = NULL;
+
+    if (!lock)
+        return;
+    IOLockLock(lock);
+    entry = resumeFind(location);
+    if (entry) {
+        old = entry->firmware;
+        memset(entry, 0, sizeof(*entry));
+    }
+    IOLockUnlock(lock);
+    OSSafeReleaseNULL(old);
+}
+
+void IntelResumeCache::
+put(IntelResumeState *state)
+{
+    OSSafeReleaseNULL(state->firmware);
+}
+
+static const char *recoveryCauseNames[kRecoveryCauseCount] = {
+    "hardware_error",
+    "boot_failed",
+    "download_timeout",
+    "setup_failed",
+};
+
+static uint64_t
+msSince(uint64_t time)
+{
+    uint64_t ns;
+
+    absolutetime_to_nanoseconds(mach_absolute_time() - time, &ns);
+    return ns / 1000000;
+}
+
+/* Called with the lock held. Location 0 marks a free entry. */
+static IntelRecoveryStats *
+recoveryFind(uint32_t location, bool create)
+{
+    IntelRecoveryStats *free = NULL;
+
+    if (!location)
+        return NULL;
+
+    for (int i = 0; i < IBT_RESUME_ENTRIES; i++) {
+        IntelRecoveryStats *entry = &recoveryEntries[i];
+        if (entry->location == location)
+            return entry;
+        if (!free && !entry->location)
+            free = entry;
+    }
+    if (!create)
+        return NULL;
+    if (!free)
+        free = &recoveryEntries[0];
+    memset(free, 0, sizeof(*free));
+    free->location = location;
+    return free;
+}
+
+const char *IntelRecovery::
+causeName(IntelRecoveryCause cause)
+{
+    return cause < kRecoveryCauseCount ? recoveryCauseNames[cause] : "unknown";
+}
+
+uint32_t IntelRecovery::
+backoff(uint32_t location)
+{
+    IOLock *lock = resumeCacheLock();
+    IntelRecoveryStats *entry;
+    uint64_t wait = 0, elapsed;
+
+    if (!lock)
+        return 0;
+    IOLockLock(lock);
+    entry = recoveryFind(location, false);
+    if (entry && entry->attempts) {
+        elapsed = msSince(entry->lastFailure);
+        if (elapsed >= IBT_RECOVERY_RESET_MS) {
+            entry->attempts = 0;
+        } else if (entry->attempts >= IBT_RECOVERY_MAX_RETRIES) {
+            wait = UINT32_MAX;
+        } else {
+            wait = (uint64_t)IBT_RECOVERY_BACKOFF_MS << (entry->attempts - 1);
+            wait = wait > elapsed ? wait - elapsed : 0;
+        }
+    }
+    IOLockUnlock(lock);
+    return (uint32_t)wait;
+}
+
+void IntelRecovery::
+failed(uint32_t location, IntelRecoveryCause cause)
+{
+    IOLock *lock = resumeCacheLock();
+    IntelRecoveryStats *entry;
+
+    if (!lock || cause >= kRecoveryCauseCount)
+        return;
+    IOLockLock(lock);
+    entry = recoveryFind(location, true);
+    if (entry) {
+        if (!entry->attempts)
+            entry->firstFailure = mach_absolute_time();
+        entry->lastFailure = mach_absolute_time();
+        entry->attempts++;
+        entry->causes[cause]++;
+    }
+    IOLockUnlock(lock);
+}
+
+void IntelRecovery::
+succeeded(uint32_t location)
+{
+    IOLock *lock = resumeCacheLock();
+    IntelRecoveryStats *entry;
+    uint64_t ns;
+
+    if (!lock)
+        return;
+    IOLockLock(lock);
+    entry = recoveryFind(location, false);
+    if (entry && entry->attempts) {
+        absolutetime_to_nanoseconds(mach_absolute_time() - entry->firstFailure, &ns);
+        entry->lastRecoveryUs = ns / 1000;
+        entry->recoveries++;
+        entry->attempts = 0;
+    }
+    IOLockUnlock(lock);
+}
+
+static void
+setRecoveryNumber(OSDictionary *dict, const char *key, uint64_t value)
+{
+    OSNumber *num = OSNumber::withNumber(value, 64);
+    if (num) {
+        dict->setObject(key, num);
+        num->release();
+    }
+}
+
+OSDictionary *IntelRecovery::
+copyDictionary(uint32_t location)
+{
+    IOLock *lock = resumeCacheLock();
+    IntelRecoveryStats stats;
+    IntelRecoveryStats *entry;
+    OSDictionary *dict, *causes;
+
+    if (!lock)
+        return NULL;
+    IOLockLock(lock);
+    entry = recoveryFind(location, false);
+    if (entry)
+        stats = *entry;
+    IOLockUnlock(lock);
+    if (!entry)
+        return NULL;
+
+    dict = OSDictionary::withCapacity(4);
+    causes = OSDictionary::withCapacity(kRecoveryCauseCount);
+    if (!dict || !causes) {
+        OSSafeReleaseNULL(dict);
+        OSSafeReleaseNULL(causes);
+        return NULL;
+    }
+    setRecoveryNumber(dict, "attempts", stats.attempts);
+    setRecoveryNumber(dict, "recoveries", stats.recoveries);
+    setRecoveryNumber(dict, "last_recovery_us", stats.lastRecoveryUs);
+    for (int i = 0; i < kRecoveryCauseCount; i++)
+        setRecoveryNumber(causes, recoveryCauseNames[i], stats.causes[i]);
+    dict->setObject("causes", causes);
+    causes->release();
+    return dict;
+}
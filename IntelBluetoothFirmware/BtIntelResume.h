@@ -0,0 +1,126 @@
+//
+//  BtIntelResume.h
+//  IntelBluetoothFirmware
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef BtIntelResume_h
+#define BtIntelResume_h
+
+#include <libkern/c++/OSData.h>
+#include <libkern/c++/OSDictionary.h>
+
+/* Controllers remembered at once, one per USB location. */
+#define IBT_RESUME_ENTRIES          4
+
+/* Large enough for the TLV version response of the newest parts. */
+#define IBT_RESUME_IDENTITY_MAX     256
+
+/* Legacy version and boot params responses, status byte included */
+#define IBT_RESUME_PARAMS_MAX       32
+
+/* What a successful bring-up leaves behind for the next one of the same
+ * controller: the version response read once the firmware was running,
+ * the firmware that was loaded and its boot address. The inflated image
+ * is kept so a controller that lost its firmware over sleep does not go
+ * through lookup and inflate again.
+ *
+ * The first version response of the bring-up and what the bootloader
+ * answered after it (the legacy version of JfP to CcP, the boot params)
+ * let a controller that comes up in the bootloader again skip those
+ * queries, for as long as that first response stays the same.
+ */
+struct IntelResumeState {
+    uint32_t location;
+    uint32_t identityLen;
+    uint8_t identity[IBT_RESUME_IDENTITY_MAX];
+    uint32_t probeIdentityLen;
+    uint8_t probeIdentity[IBT_RESUME_IDENTITY_MAX];
+    uint32_t legacyVersionLen;
+    uint8_t legacyVersion[IBT_RESUME_PARAMS_MAX];
+    uint32_t bootParamsLen;
+    uint8_t bootParams[IBT_RESUME_PARAMS_MAX];
+    char fwName[64];
+    uint32_t bootAddr;
+    OSData *firmware;
+    /* Where probeRoute() sent the bootloader's queries, and the probe
+     * round-trips that decided it.
+     */
+    bool routeProbed;
+    bool routeBulk;
+    uint64_t routeControlUs;
+    uint64_t routeBulkUs;
+};
+
+/* Outlives the driver instances, since the controller usually
+ * re-enumerates on wake and comes back as a new IntelBluetoothFirmware.
+ */
+class IntelResumeCache {
+public:
+    /* Fills state and retains its firmware, release with put(). */
+    static bool copy(uint32_t location, IntelResumeState *state);
+
+    static void store(const IntelResumeState *state);
+
+    /* Keeps the image but no longer trusts either identity or the
+     * route, a failed bring-up may have been routed badly.
+     */
+    static void invalidate(uint32_t location);
+
+    static void remove(uint32_t location);
+
+    static void put(IntelResumeState *state);
+};
+
+/* Why a bring-up failed, the first fault seen wins. */
+enum IntelRecoveryCause {
+    kRecoveryHardwareError,
+    kRecoveryBootFailed,
+    kRecoveryDownloadTimeout,
+    kRecoverySetupFailed,
+    kRecoveryCauseCount,
+};
+
+/* Failed bring-ups in a row before a controller is left alone. */
+#define IBT_RECOVERY_MAX_RETRIES    5
+
+/* Wait before the n-th retry is IBT_RECOVERY_BACKOFF_MS << (n - 1). */
+#define IBT_RECOVERY_BACKOFF_MS     250
+
+/* A streak older than this is forgotten, so a controller that was given
+ * up on gets another chance when it shows up again later.
+ */
+#define IBT_RECOVERY_RESET_MS       60000
+
+struct IntelRecoveryStats {
+    uint32_t location;
+    uint32_t attempts;
+    uint32_t recoveries;
+    uint32_t causes[kRecoveryCauseCount];
+    uint64_t firstFailure;
+    uint64_t lastFailure;
+    uint64_t lastRecoveryUs;
+};
+
+/* Tracks failed bring-ups per USB location across re-enumerations, in
+ * the same table lifetime as IntelResumeCache.
+ */
+class IntelRecovery {
+public:
+    /* Milliseconds to wait before the next attempt, or UINT32_MAX when
+     * the retries are used up.
+     */
+    static uint32_t backoff(uint32_t location);
+
+    static void failed(uint32_t location, IntelRecoveryCause cause);
+
+    static void succeeded(uint32_t location);
+
+    static OSDictionary *copyDictionary(uint32_t location);
+
+    static const char *causeName(IntelRecoveryCause cause);
+};
+
+#endif /* BtIntelResume_h */
@@ -0,0 +1,174 @@
+//
+//  BtIntelSnoop.cpp
+//  IntelBluetoothFirmware
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "BtIntelSnoop.h"
+#include <IOKit/IOLib.h>
+#include <libkern/OSByteOrder.h>
+
+#include "Hci.h"
+
+#define IBT_SNOOP_SLOTS         (IBT_SNOOP_PINNED + IBT_SNOOP_RECORDS)
+
+#define HCI_OP_INTEL_SECURE_SEND    0xfc09
+
+bool IntelSnoopRing::
+init()
+{
+    clock_sec_t secs;
+    clock_usec_t micros;
+
+    records = (IntelSnoopRecord *)IOMalloc(sizeof(IntelSnoopRecord) * IBT_SNOOP_SLOTS);
+    if (!records)
+        return false;
+    memset(records, 0, sizeof(IntelSnoopRecord) * IBT_SNOOP_SLOTS);
+    head = 0;
+    runIndex = 0;
+    snapLen = IBT_SNOOP_MAX_SNAPLEN;
+    clock_get_calendar_microtime(&secs, &micros);
+    baseTime = mach_absolute_time();
+    baseMicros = (uint64_t)secs * 1000000 + micros;
+    return true;
+}
+
+void IntelSnoopRing::
+free()
+{
+    if (records) {
+        IOFree(records, sizeof(IntelSnoopRecord) * IBT_SNOOP_SLOTS);
+        records = NULL;
+    }
+}
+
+void IntelSnoopRing::
+setSnapLen(uint32_t len)
+{
+    snapLen = min(len, IBT_SNOOP_MAX_SNAPLEN);
+}
+
+IntelSnoopRecord *IntelSnoopRing::
+slot(UInt32 index)
+{
+    if (index < IBT_SNOOP_PINNED)
+        return &records[index];
+    return &records[IBT_SNOOP_PINNED + ((index - IBT_SNOOP_PINNED) & (IBT_SNOOP_RECORDS - 1))];
+}
+
+/* A secure send fragment of the same type as the one that opened the
+ * run, or the Command Complete of such a fragment once the run's first
+ * answer is recorded, is merged into the run's record. Secure send only
+ * ever comes from the thread doing the download, so the run needs no
+ * more than the seq dance to stay consistent for copyBtsnoop().
+ */
+bool IntelSnoopRing::
+fold(uint8_t type, const uint8_t *packet, uint32_t length)
+{
+    IntelSnoopRecord *rec;
+    bool command = type == IBT_SNOOP_COMMAND && length >= 4 &&
+        (packet[0] | packet[1] << 8) == HCI_OP_INTEL_SECURE_SEND;
+    bool answer = type == IBT_SNOOP_EVENT && length >= 5 && packet[0] == HCI_EV_CMD_COMPLETE &&
+        (packet[3] | packet[4] << 8) == HCI_OP_INTEL_SECURE_SEND;
+    
+    if (!command && !answer) {
+        runIndex = 0;
+        return false;
+    }
+    if (!runIndex || (command && packet[3] != runFragment) ||
+        (answer && (UInt32)head == runIndex)) {
+        if (command) {
+            runIndex = (UInt32)head + 1;
+            runFragment = packet[3];
+        }
+        return false;
+    }
+    rec = slot(runIndex - 1);
+    if (rec->seq != runIndex) {
+        /* Already overwritten */
+        runIndex = 0;
+        return false;
+    }
+    rec->seq = 0;
+    OSMemoryBarrier();
+    if (command)
+        rec->length += length;
+    rec->folded++;
+    OSMemoryBarrier();
+    rec->seq = runIndex;
+    return true;
+}
+
+void IntelSnoopRing::
+record(uint8_t type, const void *packet, uint32_t length)
+{
+    if (!records || fold(type, (const uint8_t *)packet, length))
+        return;
+    UInt32 index = (UInt32)OSIncrementAtomic(&head);
+    IntelSnoopRecord *rec = slot(index);
+
+    rec->seq = 0;
+    OSMemoryBarrier();
+    rec->time = mach_absolute_time();
+    rec->type = type;
+    rec->length = length;
+    rec->folded = 0;
+    rec->captured = (uint8_t)min(length, snapLen);
+    memcpy(rec->data, packet, rec->captured);
+    OSMemoryBarrier();
+    rec->seq = index + 1;
+}
+
+OSData *IntelSnoopRing::
+copyBtsnoop()
+{
+    BtsnoopHdr hdr = {
+        .magic = { 'b', 't', 's', 'n', 'o', 'o', 'p', 0 },
+        .version = OSSwapHostToBigInt32(BTSNOOP_VERSION),
+        .datalink = OSSwapHostToBigInt32(BTSNOOP_DATALINK_H4),
+    };
+    BtsnoopPkt pkt;
+    IntelSnoopRecord rec;
+    uint32_t drops = 0;
+    uint64_t ns;
+    OSData *data;
+
+    if (!records)
+        return NULL;
+    UInt32 end = (UInt32)head;
+    UInt32 tail = end > IBT_SNOOP_SLOTS ? end - IBT_SNOOP_RECORDS : IBT_SNOOP_PINNED;
+    data = OSData::withCapacity(sizeof(hdr) + min(end, IBT_SNOOP_SLOTS) * (sizeof(pkt) + 1 + snapLen));
+    if (!data)
+        return NULL;
+    data->appendBytes(&hdr, sizeof(hdr));
+    for (UInt32 index = 0; index < end; index++) {
+        /* Skip what the ring has overwritten since the pinned records */
+        if (index == IBT_SNOOP_PINNED && tail > index) {
+            drops += tail - index;
+            index = tail;
+        }
+        IntelSnoopRecord *cur = slot(index);
+        if (cur->seq != index + 1)
+            continue;
+        OSMemoryBarrier();
+        rec = *cur;
+        OSMemoryBarrier();
+        if (cur->seq != index + 1)
+            continue;
+        drops += rec.folded;
+        absolutetime_to_nanoseconds(rec.time - baseTime, &ns);
+        /* The H4 type byte counts towards the packet length. */
+        pkt.origLen = OSSwapHostToBigInt32(rec.length + 1);
+        pkt.inclLen = OSSwapHostToBigInt32(rec.captured + 1);
+        pkt.flags = OSSwapHostToBigInt32(BTSNOOP_FLAG_CMD_EVT |
+                                         (rec.type == IBT_SNOOP_EVENT ? BTSNOOP_FLAG_RECEIVED : 0));
+        pkt.drops = OSSwapHostToBigInt32(drops);
+        pkt.ts = OSSwapHostToBigInt64(BTSNOOP_EPOCH_DELTA + baseMicros + ns / 1000);
+        data->appendBytes(&pkt, sizeof(pkt));
+        data->appendBytes(&rec.type, 1);
+        data->appendBytes(rec.data, rec.captured);
+    }
+    return data;
+}
@@ -0,0 +1,107 @@
+//
+//  BtIntelSnoop.h
+//  IntelBluetoothFirmware
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef BtIntelSnoop_h
+#define BtIntelSnoop_h
+
+#include <libkern/OSAtomic.h>
+#include <libkern/c++/OSData.h>
+#include <kern/clock.h>
+
+/* The first IBT_SNOOP_PINNED records are never overwritten, they hold
+ * the version, boot params and CSS exchange ahead of the download.
+ * Everything after goes to a ring of IBT_SNOOP_RECORDS, which must be a
+ * power of two. Runs of secure send fragments are folded into one record
+ * (see record()), so a full bring-up takes a few dozen records.
+ */
+#define IBT_SNOOP_PINNED        64
+#define IBT_SNOOP_RECORDS       512
+
+/* Bytes kept per packet, counted from the start of the HCI header. The
+ * default keeps every event and the small commands whole; lower it with
+ * the ibtsnaplen boot-arg to only keep the headers.
+ */
+#define IBT_SNOOP_MAX_SNAPLEN   32
+
+/* H4 packet types, they are also what the export writes in front of
+ * each packet.
+ */
+#define IBT_SNOOP_COMMAND       0x01
+#define IBT_SNOOP_EVENT         0x04
+
+/* The btsnoop file format, all fields big endian */
+#define BTSNOOP_VERSION         1
+#define BTSNOOP_DATALINK_H4     1002
+
+/* Microseconds between 0 AD, the btsnoop epoch, and the Unix epoch. */
+#define BTSNOOP_EPOCH_DELTA     0x00dcddb30f2f8000ULL
+
+#define BTSNOOP_FLAG_RECEIVED   0x01
+#define BTSNOOP_FLAG_CMD_EVT    0x02
+
+struct __attribute__((packed)) BtsnoopHdr {
+    uint8_t magic[8];
+    uint32_t version;
+    uint32_t datalink;
+};
+
+struct __attribute__((packed)) BtsnoopPkt {
+    uint32_t origLen;
+    uint32_t inclLen;
+    uint32_t flags;
+    uint32_t drops;
+    uint64_t ts;
+};
+
+/* For a folded run, length is the sum of all its commands and folded
+ * the number of packets (fragments and their answers) merged into it.
+ */
+struct IntelSnoopRecord {
+    uint64_t time;
+    volatile UInt32 seq;
+    uint32_t length;
+    uint32_t folded;
+    uint8_t captured;
+    uint8_t type;
+    uint8_t data[IBT_SNOOP_MAX_SNAPLEN];
+};
+
+/* Records HCI traffic the same way IntelTraceRing records trace points:
+ * a slot is claimed with one atomic increment and published through its
+ * seq, so capture can stay on in production. copyBtsnoop() turns the
+ * ring into a btsnoop file (H4 datalink) that Wireshark opens as is,
+ * folded and overwritten packets show up as drops.
+ */
+class IntelSnoopRing {
+public:
+    bool init();
+
+    void free();
+
+    void setSnapLen(uint32_t len);
+
+    void record(uint8_t type, const void *packet, uint32_t length);
+
+    OSData *copyBtsnoop();
+
+private:
+    IntelSnoopRecord *slot(UInt32 index);
+
+    bool fold(uint8_t type, const uint8_t *packet, uint32_t length);
+
+    IntelSnoopRecord *records;
+    volatile SInt32 head;
+    /* Index + 1 of the record a secure send run is folded into */
+    UInt32 runIndex;
+    uint8_t runFragment;
+    uint32_t snapLen;
+    uint64_t baseTime;
+    uint64_t baseMicros;
+};
+
+#endif /* BtIntelSnoop_h */
@@ -0,0 +1,138 @@
+//
+//  BtIntelTimeline.cpp
+//  IntelBluetoothFirmware
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "BtIntelTimeline.h"
+#include <libkern/c++/OSDictionary.h>
+#include <libkern/c++/OSNumber.h>
+#include <libkern/c++/OSString.h>
+#include <libkern/c++/OSBoolean.h>
+
+static const char *phaseNames[kPhaseCount] = {
+    "probe",
+    "usb_config",
+    "find_pipes",
+    "read_version",
+    "fw_lookup",
+    "inflate",
+    "patch",
+    "header",
+    "payload",
+    "download_wait",
+    "boot",
+    "ddc",
+    "event_mask",
+};
+
+void IntelTimeline::
+reset()
+{
+    memset(stats, 0, sizeof(stats));
+    active = kPhaseNone;
+}
+
+IntelPhase IntelTimeline::
+begin(IntelPhase phase, uint64_t *start)
+{
+    IntelPhase outer = active;
+    
+    *start = mach_absolute_time();
+    if (!stats[phase].count)
+        stats[phase].start = *start;
+    stats[phase].count++;
+    active = phase;
+    return outer;
+}
+
+void IntelTimeline::
+end(IntelPhase phase, IntelPhase outer, uint64_t start, bool failed)
+{
+    stats[phase].duration += mach_absolute_time() - start;
+    stats[phase].failed |= failed;
+    active = outer;
+    if (handler)
+        handler(handlerTarget, phase);
+}
+
+void IntelTimeline::
+record(IntelPhase phase, uint64_t start, uint64_t end)
+{
+    if (!stats[phase].count || start < stats[phase].start)
+        stats[phase].start = start;
+    stats[phase].duration += end - start;
+    stats[phase].count++;
+}
+
+void IntelTimeline::
+account(uint32_t bytes, uint32_t fragments)
+{
+    if (active == kPhaseNone)
+        return;
+    stats[active].bytes += bytes;
+    stats[active].fragments += fragments;
+}
+
+const char *IntelTimeline::
+phaseName(IntelPhase phase)
+{
+    return phase < kPhaseCount ? phaseNames[phase] : "none";
+}
+
+static void
+setNumber(OSDictionary *dict, const char *key, uint64_t value)
+{
+    OSNumber *num = OSNumber::withNumber(value, 64);
+    if (num) {
+        dict->setObject(key, num);
+        num->release();
+    }
+}
+
+/* One dictionary per phase that was entered, start times relative to
+ * the earliest phase, all times in microseconds.
+ */
+OSArray *IntelTimeline::
+copyArray()
+{
+    uint64_t origin = UINT64_MAX;
+    uint64_t ns;
+    OSArray *array;
+    
+    for (int i = 0; i < kPhaseCount; i++) {
+        if (stats[i].count && stats[i].start < origin)
+            origin = stats[i].start;
+    }
+    array = OSArray::withCapacity(kPhaseCount);
+    if (!array)
+        return NULL;
+    for (int i = 0; i < kPhaseCount; i++) {
+        if (!stats[i].count)
+            continue;
+        OSDictionary *dict = OSDictionary::withCapacity(7);
+        if (!dict)
+            break;
+        OSString *name = OSString::withCString(phaseNames[i]);
+        if (name) {
+            dict->setObject("phase", name);
+            name->release();
+        }
+        absolutetime_to_nanoseconds(stats[i].start - origin, &ns);
+        setNumber(dict, "start_us", ns / 1000);
+        absolutetime_to_nanoseconds(stats[i].duration, &ns);
+        setNumber(dict, "duration_us", ns / 1000);
+        setNumber(dict, "count", stats[i].count);
+        if (stats[i].bytes || stats[i].fragments) {
+            setNumber(dict, "bytes", stats[i].bytes);
+            setNumber(dict, "fragments", stats[i].fragments);
+        }
+        if (stats[i].failed)
+            dict->setObject("failed", kOSBooleanTrue);
+        array->setObject(dict);
+        dict->release();
+    }
+    return array;
+}
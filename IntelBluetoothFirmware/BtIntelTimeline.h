@@ -0,0 +1,108 @@
+//
+//  BtIntelTimeline.h
+//  IntelBluetoothFirmware
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef BtIntelTimeline_h
+#define BtIntelTimeline_h
+
+#include <libkern/c++/OSArray.h>
+#include <kern/clock.h>
+
+/* Bring-up phases, in the order they normally happen. Each phase keeps
+ * its first start time, the accumulated time spent in it and how often
+ * it was entered, plus the bytes and fragments sent while it was the
+ * innermost active phase.
+ */
+enum IntelPhase {
+    kPhaseProbe,
+    kPhaseUSBConfig,
+    kPhaseFindPipes,
+    kPhaseReadVersion,
+    kPhaseFirmwareLookup,
+    kPhaseInflate,
+    kPhasePatch,
+    kPhaseHeader,
+    kPhasePayload,
+    kPhaseDownloadWait,
+    kPhaseBoot,
+    kPhaseDDC,
+    kPhaseEventMask,
+    kPhaseCount,
+    kPhaseNone = kPhaseCount,
+};
+
+struct IntelPhaseStat {
+    uint64_t start;
+    uint64_t duration;
+    uint32_t count;
+    uint32_t bytes;
+    uint32_t fragments;
+    bool failed;
+};
+
+/* Called on the setup thread whenever a phase ends */
+typedef void (*IntelPhaseHandler)(void *target, IntelPhase phase);
+
+class IntelTimeline {
+public:
+    void reset();
+
+    /* Survives reset(), so it can be set before the device is opened */
+    void setHandler(IntelPhaseHandler handler, void *target)
+    {
+        this->handler = handler;
+        handlerTarget = target;
+    }
+
+    IntelPhase begin(IntelPhase phase, uint64_t *start);
+
+    void end(IntelPhase phase, IntelPhase outer, uint64_t start, bool failed);
+
+    void record(IntelPhase phase, uint64_t start, uint64_t end);
+
+    void account(uint32_t bytes, uint32_t fragments);
+
+    IntelPhase current() { return active; }
+
+    OSArray *copyArray();
+
+    static const char *phaseName(IntelPhase phase);
+
+private:
+    IntelPhaseStat stats[kPhaseCount];
+    IntelPhase active;
+    IntelPhaseHandler handler;
+    void *handlerTarget;
+};
+
+/* Times the enclosing scope as one entry of the given phase. Call
+ * fail() before leaving on an error path so the phase is flagged.
+ */
+class IntelPhaseScope {
+public:
+    IntelPhaseScope(IntelTimeline *timeline, IntelPhase phase)
+    : timeline(timeline), phase(phase), failed(false)
+    {
+        outer = timeline->begin(phase, &start);
+    }
+
+    ~IntelPhaseScope()
+    {
+        timeline->end(phase, outer, start, failed);
+    }
+
+    void fail() { failed = true; }
+
+private:
+    IntelTimeline *timeline;
+    IntelPhase phase;
+    IntelPhase outer;
+    uint64_t start;
+    bool failed;
+};
+
+#endif /* BtIntelTimeline_h */
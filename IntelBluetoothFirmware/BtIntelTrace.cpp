@@ -0,0 +1,72 @@
+//
+//  BtIntelTrace.cpp
+//  IntelBluetoothFirmware
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "BtIntelTrace.h"
+#include "Log.h"
+
+static const char traceLevels[] = { 'E', 'I', 'D' };
+
+void IntelTraceRing::
+reset()
+{
+    memset(records, 0, sizeof(records));
+    head = 0;
+}
+
+void IntelTraceRing::
+record(uint8_t level, const char *fmt, uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3)
+{
+    UInt32 index = (UInt32)OSIncrementAtomic(&head);
+    IntelTraceRecord *rec = &records[index & (IBT_TRACE_RECORDS - 1)];
+
+    rec->seq = 0;
+    OSMemoryBarrier();
+    rec->time = mach_absolute_time();
+    rec->fmt = fmt;
+    rec->args[0] = a0;
+    rec->args[1] = a1;
+    rec->args[2] = a2;
+    rec->args[3] = a3;
+    rec->level = level;
+    OSMemoryBarrier();
+    rec->seq = index + 1;
+}
+
+/* Formats the ring oldest first. Meant for failure paths and teardown,
+ * it calls IOLog once per record.
+ */
+void IntelTraceRing::
+dump(const char *reason)
+{
+    UInt32 end = (UInt32)head;
+    UInt32 index = end > IBT_TRACE_RECORDS ? end - IBT_TRACE_RECORDS : 0;
+    uint64_t base = 0;
+    uint64_t ns;
+    char line[128];
+
+    XYLog("trace (%s): %u records, %u dropped\n", reason, end - index, index);
+    for (; index != end; index++) {
+        IntelTraceRecord *slot = &records[index & (IBT_TRACE_RECORDS - 1)];
+        if (slot->seq != index + 1)
+            continue;
+        OSMemoryBarrier();
+        IntelTraceRecord rec = *slot;
+        OSMemoryBarrier();
+        if (slot->seq != index + 1 || !rec.fmt)
+            continue;
+        if (!base)
+            base = rec.time;
+        absolutetime_to_nanoseconds(rec.time - base, &ns);
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wformat-nonliteral"
+        snprintf(line, sizeof(line), rec.fmt, rec.args[0], rec.args[1], rec.args[2], rec.args[3]);
+#pragma clang diagnostic pop
+        XYLog("%c +%lluus %s", rec.level < sizeof(traceLevels) ? traceLevels[rec.level] : '?',
+              (unsigned long long)(ns / 1000), line);
+    }
+}
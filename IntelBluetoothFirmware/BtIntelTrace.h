@@ -0,0 +1,77 @@
+//
+//  BtIntelTrace.h
+//  IntelBluetoothFirmware
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef BtIntelTrace_h
+#define BtIntelTrace_h
+
+#include <libkern/OSAtomic.h>
+#include <kern/clock.h>
+
+#define IBT_TRACE_ERROR     0
+#define IBT_TRACE_INFO      1
+#define IBT_TRACE_DEBUG     2
+
+/* Records above this level are compiled out entirely. */
+#ifndef IBT_TRACE_LEVEL
+#if DEBUG
+#define IBT_TRACE_LEVEL     IBT_TRACE_DEBUG
+#else
+#define IBT_TRACE_LEVEL     IBT_TRACE_INFO
+#endif
+#endif
+
+/* Must be a power of two. */
+#define IBT_TRACE_RECORDS   256
+#define IBT_TRACE_ARGS      4
+
+/* The format is only kept by pointer, so it has to be a string literal,
+ * and it is only applied when the ring is exported. Every argument is
+ * widened to 64 bits, use the ll length modifier for all conversions
+ * and never %s.
+ */
+struct IntelTraceRecord {
+    uint64_t time;
+    const char *fmt;
+    uint64_t args[IBT_TRACE_ARGS];
+    volatile UInt32 seq;
+    uint8_t level;
+};
+
+/* Writers claim a slot with a single atomic increment and never block,
+ * so recording is fine from USB completion context. A slot is only
+ * valid once its seq matches the index it was claimed for; export skips
+ * slots that are being written or were already overwritten.
+ */
+class IntelTraceRing {
+public:
+    void reset();
+
+    void record(uint8_t level, const char *fmt, uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3);
+
+    void dump(const char *reason);
+
+private:
+    IntelTraceRecord records[IBT_TRACE_RECORDS];
+    volatile SInt32 head;
+};
+
+static inline void
+intelTrace(IntelTraceRing *ring, uint8_t level, const char *fmt,
+           uint64_t a0 = 0, uint64_t a1 = 0, uint64_t a2 = 0, uint64_t a3 = 0)
+{
+    ring->record(level, fmt, a0, a1, a2, a3);
+}
+
+#define IBTTrace(ring, level, fmt, x...)\
+do\
+{\
+if ((level) <= IBT_TRACE_LEVEL)\
+intelTrace((ring), (level), fmt, ##x);\
+}while(0)
+
+#endif /* BtIntelTrace_h */
@@ -0,0 +1,54 @@
+//
+//  BtIntelUSB.cpp
+//  IntelBluetoothFirmware
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "BtIntel.h"
+#include "USBDeviceController.hpp"
+#include "Log.h"
+
+/* Everything of BtIntel that needs IOUSBHost lives here, so the rest of
+ * the core also builds on the host (see host/).
+ */
+bool BtIntel::
+initWithDevice(IOService *client, IOUSBHostDevice *dev)
+{
+    XYLog("%s\n", __PRETTY_FUNCTION__);
+    USBDeviceController *controller;
+    bool ret;
+    
+    OSNumber *location = OSDynamicCast(OSNumber, dev->getProperty(kUSBDevicePropertyLocationID));
+    IntelSkuLatency *latency = intelLatencyForSku(USBToHost16(dev->getDeviceDescriptor()->idVendor),
+                                                  USBToHost16(dev->getDeviceDescriptor()->idProduct));
+    
+    controller = new USBDeviceController();
+    if (!controller) {
+        return false;
+    }
+    if (!controller->init(client, dev)) {
+        controller->release();
+        return false;
+    }
+    ret = initWithTransport(controller, location ? location->unsigned32BitValue() : 0, latency);
+    controller->release();
+    if (!ret) {
+        return false;
+    }
+    {
+        IntelPhaseScope phase(&m_timeline, kPhaseUSBConfig);
+        if (!controller->initConfiguration() ||
+            !controller->findInterface()) {
+            phase.fail();
+            return false;
+        }
+    }
+    IntelPhaseScope phase(&m_timeline, kPhaseFindPipes);
+    if (!controller->findPipes()) {
+        phase.fail();
+        return false;
+    }
+    return true;
+}
@@ -53,6 +53,7 @@ setEventMask(bool debug)
     uint8_t buf[CMD_BUF_MAX_SIZE];
     uint8_t mask[8] = { 0x87, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
     HciCommandHdr *cmd = (HciCommandHdr *)buf;
+    IntelPhaseScope phase(&m_timeline, kPhaseEventMask);
     
     if (debug)
         mask[1] |= 0x62;
@@ -91,19 +92,23 @@ readVersion(IntelVersion *version)
     };
     uint8_t buf[CMD_BUF_MAX_SIZE];
     HciResponse *resp = (HciResponse *)buf;
+    IntelPhaseScope phase(&m_timeline, kPhaseReadVersion);
     
     memset(buf, 0, sizeof(buf));
     if (!intelSendHCISync(&cmd, resp, sizeof(buf), &actLen, HCI_CMD_TIMEOUT)) {
+        phase.fail();
         XYLog("Reading Intel version information failed\n");
         return false;
     }
     
     if (actLen - 5 != sizeof(*version)) {
+        phase.fail();
         XYLog("Intel version event size mismatch (act: %d, ver: %d)\n", actLen, (int)sizeof(*version));
         return false;
     }
     
     memcpy(version, resp->data, actLen - 5);
+    noteIdentity(resp->data, actLen - 5);
     
     return true;
 }
@@ -122,7 +127,7 @@ sendIntelReset(uint32_t bootParam)
     cmd->opcode = OSSwapHostToLittleInt16(0xfc01);
     cmd->len = sizeof(params);
     memcpy(cmd->data, &params, sizeof(params));
-    return m_pUSBDeviceController->sendHCIRequest(cmd, HCI_INIT_TIMEOUT) == kIOReturnSuccess;
+    return m_pTransport->sendHCIRequest(cmd, HCI_INIT_TIMEOUT) == kIOReturnSuccess;
 }
 
 bool BtIntel::
@@ -210,7 +215,7 @@ resetToBootloader()
     cmd->len = sizeof(params);
     memcpy(cmd->data, &params, sizeof(params));
     
-    ret = m_pUSBDeviceController->sendHCIRequest(cmd, HCI_INIT_TIMEOUT);
+    ret = m_pTransport->sendHCIRequest(cmd, HCI_INIT_TIMEOUT);
     
     /* Current Intel BT controllers(ThP/JfP) hold the USB reset
      * lines for 2ms when it receives Intel Reset in bootloader mode.
@@ -284,3 +289,17 @@ setDebugFeatures(IntelDebugFeatures *features)
     
     return true;
 }
+
+/* Asks the operational firmware for its telemetry and exception events
+ * and the debug event mask. Nothing here reads them, IntelBTPatcher
+ * counts them once the Bluetooth stack owns the device.
+ */
+bool BtIntel::
+enableTelemetry()
+{
+    IntelDebugFeatures features;
+    
+    if (!readDebugFeatures(&features) || !setDebugFeatures(&features))
+        return false;
+    return setEventMask(true);
+}
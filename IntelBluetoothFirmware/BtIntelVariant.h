@@ -0,0 +1,146 @@
+//
+//  BtIntelVariant.h
+//  IntelBluetoothFirmware
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef BtIntelVariant_h
+#define BtIntelVariant_h
+
+#include <stdint.h>
+
+/* How the firmware file of a hardware variant is named */
+enum IntelFirmwareNaming {
+    kNamingDevRevid,        /* ibt-<hw_variant>-<dev_revid> */
+    kNamingRevision,        /* ibt-<hw_variant>-<hw_revision>-<fw_revision> */
+    kNamingCnvTop,          /* ibt-<cnvi_top>-<cnvr_top> */
+};
+
+/* The bootloader sends the boot notification within a second */
+#define IBT_VARIANT_BOOT_MS     1000
+
+struct IntelVariantTraits {
+    uint8_t variant;
+    const char *name;
+    /* 2 for the legacy bootloader of IntelBluetoothOpsGen2, 3 for the
+     * TLV bootloader of IntelBluetoothOpsGen3.
+     */
+    uint8_t generation;
+    IntelFirmwareNaming naming;
+    /* The operational firmware also answers the TLV version query */
+    bool tlvVersion;
+    /* The build of the firmware on file can be compared with the one
+     * running, SfP and WsP do not update it.
+     */
+    bool versionCheck;
+    /* An ECDSA CSS header follows the RSA one, the SBE type picks which
+     * of the two is sent.
+     */
+    bool ecdsa;
+    uint16_t bootMs;
+};
+
+/* Every hardware variant the loader knows, sorted by variant. Adding a
+ * part is adding a row here.
+ */
+static constexpr IntelVariantTraits intelVariants[] = {
+    { 0x0b, "SfP",   2, kNamingDevRevid, false, false, false, IBT_VARIANT_BOOT_MS },
+    { 0x0c, "WsP",   2, kNamingDevRevid, false, false, false, IBT_VARIANT_BOOT_MS },
+    { 0x11, "JfP",   2, kNamingRevision, true,  true,  false, IBT_VARIANT_BOOT_MS },
+    { 0x12, "ThP",   2, kNamingRevision, true,  true,  false, IBT_VARIANT_BOOT_MS },
+    { 0x13, "HrP",   2, kNamingRevision, true,  true,  false, IBT_VARIANT_BOOT_MS },
+    { 0x14, "CcP",   2, kNamingRevision, true,  true,  false, IBT_VARIANT_BOOT_MS },
+    { 0x17, "TyP",   3, kNamingCnvTop,   true,  true,  true,  IBT_VARIANT_BOOT_MS },
+    { 0x18, "Slr",   3, kNamingCnvTop,   true,  true,  true,  IBT_VARIANT_BOOT_MS },
+    { 0x19, "Slr-F", 3, kNamingCnvTop,   true,  true,  true,  IBT_VARIANT_BOOT_MS },
+    { 0x1b, "Mgr",   3, kNamingCnvTop,   true,  true,  true,  IBT_VARIANT_BOOT_MS },
+    { 0x1c, "GaP",   3, kNamingCnvTop,   true,  true,  true,  IBT_VARIANT_BOOT_MS },
+};
+
+#define IBT_VARIANT_COUNT   (sizeof(intelVariants) / sizeof(intelVariants[0]))
+
+/* NULL for a variant this loader does not support */
+static constexpr const IntelVariantTraits *
+intelVariantTraits(uint8_t variant)
+{
+    for (unsigned int i = 0; i < IBT_VARIANT_COUNT; i++) {
+        if (intelVariants[i].variant == variant)
+            return &intelVariants[i];
+    }
+    return nullptr;
+}
+
+/* USB product IDs of the parts loaded by IntelBluetoothOpsGen1 and
+ * IntelBluetoothOpsGen3, every other product goes to Gen2.
+ */
+struct IntelProductTraits {
+    uint16_t productID;
+    uint8_t generation;
+};
+
+static constexpr IntelProductTraits intelProducts[] = {
+    { 0x0032, 3 },
+    { 0x0033, 3 },
+    { 0x0035, 3 },
+    { 0x0036, 3 },
+    { 0x0038, 3 },
+    { 0x07dc, 1 },
+    { 0x0a2a, 1 },
+    { 0x0aa7, 1 },
+};
+
+static constexpr uint8_t
+intelProductGeneration(uint16_t productID)
+{
+    for (unsigned int i = 0; i < sizeof(intelProducts) / sizeof(intelProducts[0]); i++) {
+        if (intelProducts[i].productID == productID)
+            return intelProducts[i].generation;
+    }
+    return 2;
+}
+
+static constexpr bool
+intelVariantsValid()
+{
+    for (unsigned int i = 0; i < IBT_VARIANT_COUNT; i++) {
+        const IntelVariantTraits &t = intelVariants[i];
+        if (i && intelVariants[i - 1].variant >= t.variant)
+            return false;
+        /* The TLV bootloader names its firmware after the CNVi/CNVr
+         * pair and always carries an ECDSA header.
+         */
+        if ((t.generation == 3) != (t.naming == kNamingCnvTop) ||
+            (t.generation == 3) != t.ecdsa)
+            return false;
+        if (t.generation == 3 && !t.tlvVersion)
+            return false;
+        if (t.generation != 2 && t.generation != 3)
+            return false;
+    }
+    return true;
+}
+
+static constexpr bool
+intelProductsValid()
+{
+    for (unsigned int i = 1; i < sizeof(intelProducts) / sizeof(intelProducts[0]); i++) {
+        if (intelProducts[i - 1].productID >= intelProducts[i].productID)
+            return false;
+    }
+    return true;
+}
+
+static_assert(intelVariantsValid(), "intelVariants must be sorted and consistent per generation");
+static_assert(intelProductsValid(), "intelProducts must be sorted");
+static_assert(intelVariantTraits(0x0c)->naming == kNamingDevRevid &&
+              !intelVariantTraits(0x0c)->versionCheck, "WsP firmware is named by device revision");
+static_assert(intelVariantTraits(0x12)->generation == 2 &&
+              intelVariantTraits(0x12)->tlvVersion, "ThP has a legacy bootloader with TLV firmware");
+static_assert(intelVariantTraits(0x17)->generation == 3, "TyP has the TLV bootloader");
+static_assert(intelVariantTraits(0x15) == nullptr, "0x15 is not a supported variant");
+static_assert(intelProductGeneration(0x0a2a) == 1 && intelProductGeneration(0x0036) == 3 &&
+              intelProductGeneration(0x0025) == 2, "product to generation mapping");
+
+#endif /* BtIntelVariant_h */
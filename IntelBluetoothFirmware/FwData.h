@@ -30,12 +30,14 @@ struct FwDesc {
 
 extern const struct FwDesc fwList[];
 extern const int fwNumber;
+extern const char *fwVariant;
+extern const bool fwExternal;
 
 static inline OSData *getFWDescByName(const char* name) {
     for (int i = 0; i < fwNumber; i++) {
         if (strcmp(fwList[i].name, name) == 0) {
             FwDesc desc = fwList[i];
-            return OSData::withBytes(desc.var, (unsigned int)desc.size);
+            return OSData::withBytesNoCopy((void *)desc.var, (unsigned int)desc.size);
         }
     }
     return NULL;
@@ -0,0 +1,12 @@
+//
+//  HCITransport.cpp
+//  IntelBluetoothFirmware
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "HCITransport.hpp"
+
+#define super OSObject
+OSDefineMetaClassAndAbstractStructors(HCITransport, OSObject)
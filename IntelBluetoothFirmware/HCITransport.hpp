@@ -0,0 +1,62 @@
+//
+//  HCITransport.hpp
+//  IntelBluetoothFirmware
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef HCITransport_hpp
+#define HCITransport_hpp
+
+#include <libkern/c++/OSObject.h>
+#include <IOKit/IOReturn.h>
+
+#include "Hci.h"
+#include "BtIntelTrace.h"
+
+class OSData;
+class OSDictionary;
+class IntelDeadline;
+
+/* What BtIntel and the Ops classes need to talk HCI to the controller.
+ * Commands go out either on the command channel (sendHCIRequest) or, for
+ * the bootloader's secure send, on the data channel (bulkWrite). Events
+ * come back on the event channel (interruptPipeRead) or the data channel
+ * (bulkPipeRead) respectively. All of them block for at most timeout ms.
+ *
+ * The names follow the USB endpoints of USBDeviceController, the only
+ * implementation in the kext; another transport maps them onto its own
+ * channels.
+ */
+class HCITransport : public OSObject {
+    OSDeclareAbstractStructors(HCITransport)
+    
+public:
+    
+    virtual IOReturn sendHCIRequest(HciCommandHdr *cmd, uint32_t timeout) = 0;
+    
+    virtual IOReturn interruptPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout) = 0;
+    
+    virtual IOReturn bulkWrite(const void *data, uint32_t length, uint32_t timeout) = 0;
+    
+    virtual IOReturn bulkPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout) = 0;
+    
+    virtual const char* stringFromReturn(IOReturn code) = 0;
+    
+    virtual IntelTraceRing *getTrace() = 0;
+    
+    /* Transfers are clamped to what is left of the deadline. */
+    virtual void setDeadline(IntelDeadline *deadline) {}
+    
+    /* Per channel stats and the btsnoop capture, where the transport
+     * keeps them.
+     */
+    virtual OSDictionary *copyStats() { return NULL; }
+    
+    virtual OSData *copySnoop() { return NULL; }
+    
+    virtual void setSnapLen(uint32_t len) {}
+};
+
+#endif /* HCITransport_hpp */
@@ -13,6 +13,7 @@
 #include <libkern/OSKextLib.h>
 #include <libkern/version.h>
 #include <libkern/OSTypes.h>
+#include <pexpert/pexpert.h>
 #include <IOKit/usb/StandardUSB.h>
 #include "Hci.h"
 #include "linux.h"
@@ -21,6 +22,7 @@
 #include "IntelBluetoothOpsGen1.hpp"
 #include "IntelBluetoothOpsGen2.hpp"
 #include "IntelBluetoothOpsGen3.hpp"
+#include "FwData.h"
 
 #define super IOService
 OSDefineMetaClassAndStructors(IntelBluetoothFirmware, IOService)
@@ -52,6 +54,8 @@ bool IntelBluetoothFirmware::start(IOService *provider)
 {
     XYLog("Driver Start()\n");
     char fwName[64];
+    uint32_t traceDump = 0;
+    uint32_t backoff;
     m_pDevice = OSDynamicCast(IOUSBHostDevice, provider);
     if (m_pDevice == NULL) {
         XYLog("Driver Start fail, not usb device\n");
@@ -66,29 +70,73 @@ bool IntelBluetoothFirmware::start(IOService *provider)
         return false;
     }
     
+    setupCall = thread_call_allocate(setupCallback, this);
+    if (!setupCall) {
+        XYLog("start fail, can not allocate setup call\n");
+        stop(this);
+        return false;
+    }
+    
     if (!m_pDevice->open(this)) {
         XYLog("start fail, can not open device\n");
         cleanUp();
         stop(this);
         return false;
     }
-    if (currentType == kTypeGen1) {
-        m_pBTIntel = new IntelBluetoothOpsGen1();
-    } else {
-        m_pBTIntel = new IntelBluetoothOpsGen3();
-    }
+    createOps();
+    m_pBTIntel->getTimeline()->setHandler(phaseEnded, this);
     if (!m_pBTIntel->initWithDevice(this, m_pDevice)) {
         XYLog("start fail, can not init device\n");
+        m_pBTIntel->getTimeline()->record(kPhaseProbe, probeStart, probeEnd);
+        IntelRecovery::failed(m_pBTIntel->getLocation(), kRecoverySetupFailed);
+        publishStats(m_pDevice);
+        dumpTrace("init failed");
         cleanUp();
         stop(this);
         return false;
     }
+    m_pBTIntel->getTimeline()->record(kPhaseProbe, probeStart, probeEnd);
     XYLog("BT init succeed\n");
+    /* Every failed bring-up resets the controller, which brings it back
+     * here. Space those attempts out and stop after a few.
+     */
+    backoff = IntelRecovery::backoff(m_pBTIntel->getLocation());
+    if (backoff == UINT32_MAX) {
+        /* The cached image stays, the controller may well come back
+         * once the retries are forgotten.
+         */
+        XYLog("start fail, giving up after %d failed attempts\n", IBT_RECOVERY_MAX_RETRIES);
+        publishStats(m_pDevice);
+        cleanUp();
+        stop(this);
+        return false;
+    }
+    if (backoff) {
+        /* Not waited for here, start() runs on the matching thread */
+        XYLog("Retrying in %u ms\n", backoff);
+        cleanUp();
+        setupDeferred = true;
+        scheduleSetup(backoff);
+        return true;
+    }
+    configureSetup();
     if (!m_pBTIntel->setup()) {
+        setupFailed("setup failed");
         cleanUp();
         stop(this);
         return false;
     }
+    m_pBTIntel->getDeadline()->disarm();
+    if (PE_parse_boot_argn("ibttrace", &traceDump, sizeof(traceDump)) && traceDump)
+        dumpTrace("setup done");
+    m_pBTIntel->saveResumeState();
+    IntelRecovery::succeeded(m_pBTIntel->getLocation());
+    measureRoundTrip();
+    startTelemetry();
+    /* A controller that re-enumerated on wake comes back through probe */
+    if (m_pBTIntel->isResume())
+        publishResume(probeStart);
+    firmwareLoaded = true;
     m_pBTIntel->getFirmwareName(fwName, sizeof(fwName));
     publishReg(true, fwName);
     cleanUp();
@@ -100,11 +148,132 @@ void IntelBluetoothFirmware::publishReg(bool isSucceed, const char *fwName)
     m_pDevice->setProperty("FirmwareLoaded", isSucceed);
     if (isSucceed)
         setProperty("fw_name", OSString::withCString(fwName));
+    setProperty("fw_variant", fwVariant);
+    publishStats(this);
     // Monterey+
     if (version_major >= 21)
         m_pDevice->setName("Bluetooth USB Host Controller");
 }
 
+void IntelBluetoothFirmware::publishStats(IORegistryEntry *entry)
+{
+    if (!m_pBTIntel)
+        return;
+    OSArray *timeline = m_pBTIntel->getTimeline()->copyArray();
+    if (timeline) {
+        entry->setProperty("fw_timeline", timeline);
+        timeline->release();
+    }
+    OSDictionary *usbStats = m_pBTIntel->copyUSBStats();
+    if (usbStats) {
+        entry->setProperty("usb_stats", usbStats);
+        usbStats->release();
+    }
+    OSDictionary *latency = m_pBTIntel->copyLatency();
+    if (latency) {
+        entry->setProperty("cmd_latency", latency);
+        latency->release();
+    }
+    OSDictionary *recovery = IntelRecovery::copyDictionary(m_pBTIntel->getLocation());
+    if (recovery) {
+        entry->setProperty("fw_recovery", recovery);
+        recovery->release();
+    }
+    OSDictionary *roundTrip = m_pBTIntel->copyRoundTrip();
+    if (roundTrip) {
+        entry->setProperty("fw_rtt", roundTrip);
+        roundTrip->release();
+    }
+    OSDictionary *route = m_pBTIntel->copyRoute();
+    if (route) {
+        entry->setProperty("fw_route", route);
+        route->release();
+    }
+    OSData *snoop = m_pBTIntel->copySnoop();
+    if (snoop) {
+        entry->setProperty("hci_snoop", snoop);
+        snoop->release();
+    }
+}
+
+/* usb_stats on the device follows the bring-up, it is refreshed every
+ * time a phase ends so a stalled download still shows its counters.
+ */
+void IntelBluetoothFirmware::phaseEnded(void *target, IntelPhase phase)
+{
+    IntelBluetoothFirmware *that = (IntelBluetoothFirmware *)target;
+    
+    if (!that->m_pDevice || !that->m_pBTIntel)
+        return;
+    OSDictionary *usbStats = that->m_pBTIntel->copyUSBStats();
+    if (usbStats) {
+        that->m_pDevice->setProperty("usb_stats", usbStats);
+        usbStats->release();
+    }
+}
+
+void IntelBluetoothFirmware::publishResume(uint64_t start)
+{
+    uint64_t ns;
+    OSDictionary *dict = OSDictionary::withCapacity(2);
+    OSNumber *latency;
+    
+    absolutetime_to_nanoseconds(mach_absolute_time() - start, &ns);
+    XYLog("Resume to operational took %llu us, firmware %s\n", ns / 1000,
+          m_pBTIntel->firmwareSurvived() ? "survived" : "reloaded");
+    if (!dict)
+        return;
+    latency = OSNumber::withNumber(ns / 1000, 64);
+    if (latency) {
+        dict->setObject("latency_us", latency);
+        latency->release();
+    }
+    dict->setObject("firmware_survived", m_pBTIntel->firmwareSurvived() ? kOSBooleanTrue : kOSBooleanFalse);
+    setProperty("fw_resume", dict);
+    dict->release();
+}
+
+/* Boot-args that apply to every bring-up, the one of start() and the
+ * one of resume() alike.
+ */
+void IntelBluetoothFirmware::configureSetup()
+{
+    uint32_t setupBudget = IBT_SETUP_BUDGET;
+    uint32_t snapLen;
+    
+    if (PE_parse_boot_argn("ibtsnaplen", &snapLen, sizeof(snapLen)))
+        m_pBTIntel->setSnapLen(snapLen);
+    PE_parse_boot_argn("ibtbudget", &setupBudget, sizeof(setupBudget));
+    m_pBTIntel->setSetupBudget(setupBudget);
+}
+
+void IntelBluetoothFirmware::setupFailed(const char *reason)
+{
+    IntelDeadline *deadline = m_pBTIntel->getDeadline();
+    
+    if (deadline->isExpired()) {
+        XYLog("setup budget of %u ms exhausted during %s\n", deadline->budget(),
+              IntelTimeline::phaseName(deadline->phase()));
+        m_pDevice->setProperty("fw_budget_exhausted", IntelTimeline::phaseName(deadline->phase()));
+    }
+    /* Count the failure towards the next attempt's backoff and
+     * stop trusting the cached identity.
+     */
+    IntelRecovery::failed(m_pBTIntel->getLocation(), m_pBTIntel->getFault());
+    m_pBTIntel->dropResumeState();
+    /* Keep the stats of a failed bring-up on the device, this
+     * service may go away.
+     */
+    publishStats(m_pDevice);
+    dumpTrace(reason);
+}
+
+void IntelBluetoothFirmware::dumpTrace(const char *reason)
+{
+    if (m_pBTIntel && m_pBTIntel->getTrace())
+        m_pBTIntel->getTrace()->dump(reason);
+}
+
 void IntelBluetoothFirmware::cleanUp()
 {
     XYLog("Clean up...\n");
@@ -117,15 +286,181 @@ void IntelBluetoothFirmware::cleanUp()
     }
 }
 
+void IntelBluetoothFirmware::createOps()
+{
+    if (currentType == kTypeGen1) {
+        m_pBTIntel = new IntelBluetoothOpsGen1();
+    } else {
+        m_pBTIntel = new IntelBluetoothOpsGen3();
+    }
+}
+
+/* ibtrtt=<count> times count cheap vendor commands once the firmware
+ * runs, before telemetry can put events of its own on the interrupt
+ * pipe. Published as fw_rtt together with the bulk round-trips of the
+ * download.
+ */
+void IntelBluetoothFirmware::measureRoundTrip()
+{
+    uint32_t count = 0;
+    
+    if (!PE_parse_boot_argn("ibtrtt", &count, sizeof(count)) || !count)
+        return;
+    m_pBTIntel->measureRoundTrip(count);
+}
+
+/* Opt-in with the ibttelemetry boot-arg, the events are counted by
+ * IntelBTPatcher with the same boot-arg.
+ */
+void IntelBluetoothFirmware::startTelemetry()
+{
+    uint32_t telemetry = 0;
+    bool enabled;
+    
+    if (!PE_parse_boot_argn("ibttelemetry", &telemetry, sizeof(telemetry)) || !telemetry)
+        return;
+    enabled = m_pBTIntel->enableTelemetry();
+    XYLog("Controller telemetry %s\n", enabled ? "enabled" : "not supported");
+    setProperty("fw_telemetry", enabled);
+}
+
+/* The controller stayed attached over sleep. One version query tells if
+ * it kept its firmware, otherwise it is loaded again from the image
+ * cached by the last bring-up. Runs on setupCall, a bring-up can take
+ * seconds that the power management thread must not wait for. The
+ * same call runs the bring-up start() deferred for its backoff.
+ */
+void IntelBluetoothFirmware::resume()
+{
+    uint64_t start = mach_absolute_time();
+    bool wake = firmwareLoaded;
+    uint32_t backoff;
+    char fwName[64];
+    
+    if (sleeping)
+        return;
+    m_pDevice = OSDynamicCast(IOUSBHostDevice, getProvider());
+    if (!m_pDevice) {
+        XYLog("resume fail, no usb device\n");
+        return;
+    }
+    /* The Bluetooth stack already drives the controller, whatever state
+     * it is in is not ours to change.
+     */
+    if (interfaceInUse()) {
+        XYLog("resume skipped, interface held by another client\n");
+        m_pDevice = NULL;
+        return;
+    }
+    if (!m_pDevice->open(this)) {
+        XYLog("resume fail, can not open device\n");
+        m_pDevice = NULL;
+        return;
+    }
+    createOps();
+    m_pBTIntel->getTimeline()->setHandler(phaseEnded, this);
+    if (!m_pBTIntel->initWithDevice(this, m_pDevice)) {
+        XYLog("resume fail, can not init device\n");
+        cleanUp();
+        return;
+    }
+    /* Same spacing as start(), but waited for on setupCall rather
+     * than here.
+     */
+    backoff = IntelRecovery::backoff(m_pBTIntel->getLocation());
+    if (backoff == UINT32_MAX) {
+        XYLog("resume fail, giving up after %d failed attempts\n", IBT_RECOVERY_MAX_RETRIES);
+        publishStats(m_pDevice);
+        setupDeferred = false;
+        cleanUp();
+        return;
+    }
+    if (backoff) {
+        XYLog("Retrying in %u ms\n", backoff);
+        cleanUp();
+        scheduleSetup(backoff);
+        return;
+    }
+    configureSetup();
+    if (!m_pBTIntel->setup()) {
+        XYLog("resume fail, firmware not loaded\n");
+        setupFailed(wake ? "resume failed" : "setup failed");
+        m_pDevice->setProperty("FirmwareLoaded", false);
+        firmwareLoaded = false;
+        setupDeferred = false;
+        cleanUp();
+        return;
+    }
+    m_pBTIntel->getDeadline()->disarm();
+    m_pBTIntel->saveResumeState();
+    IntelRecovery::succeeded(m_pBTIntel->getLocation());
+    measureRoundTrip();
+    startTelemetry();
+    if (wake || m_pBTIntel->isResume())
+        publishResume(wake ? start : probeStart);
+    firmwareLoaded = true;
+    setupDeferred = false;
+    m_pBTIntel->getFirmwareName(fwName, sizeof(fwName));
+    publishReg(true, fwName);
+    cleanUp();
+}
+
+void IntelBluetoothFirmware::scheduleSetup(uint32_t delayMs)
+{
+    uint64_t deadline;
+    
+    clock_interval_to_deadline(delayMs, kMillisecondScale, &deadline);
+    thread_call_enter_delayed(setupCall, deadline);
+}
+
+void IntelBluetoothFirmware::setupCallback(thread_call_param_t param0, thread_call_param_t param1)
+{
+    ((IntelBluetoothFirmware *)param0)->resume();
+}
+
+bool IntelBluetoothFirmware::interfaceInUse()
+{
+    OSIterator *iterator = m_pDevice->getChildIterator(gIOServicePlane);
+    OSObject *candidate;
+    bool inUse = false;
+    
+    if (!iterator)
+        return false;
+    while ((candidate = iterator->getNextObject()) != NULL) {
+        IOUSBHostInterface *interface = OSDynamicCast(IOUSBHostInterface, candidate);
+        if (interface && interface->isOpen()) {
+            inUse = true;
+            break;
+        }
+    }
+    OSSafeReleaseNULL(iterator);
+    return inUse;
+}
+
 IOReturn IntelBluetoothFirmware::setPowerState(unsigned long powerStateOrdinal, IOService *whatDevice)
 {
 //    XYLog("setPowerState powerStateOrdinal=%lu\n", powerStateOrdinal);
+    if (powerStateOrdinal == kMyOffPowerState) {
+        sleeping = true;
+        /* A bring-up still waiting out its backoff starts over on wake */
+        if (setupCall)
+            thread_call_cancel(setupCall);
+    } else if (sleeping) {
+        sleeping = false;
+        if ((firmwareLoaded || setupDeferred) && setupCall)
+            thread_call_enter(setupCall);
+    }
     return IOPMAckImplied;
 }
 
 void IntelBluetoothFirmware::stop(IOService *provider)
 {
     XYLog("Driver Stop()\n");
+    if (setupCall) {
+        thread_call_cancel_wait(setupCall);
+        thread_call_free(setupCall);
+        setupCall = NULL;
+    }
     PMstop();
     super::stop(provider);
 }
@@ -133,6 +468,7 @@ void IntelBluetoothFirmware::stop(IOService *provider)
 IOService * IntelBluetoothFirmware::probe(IOService *provider, SInt32 *score)
 {
     XYLog("Driver Probe()\n");
+    probeStart = mach_absolute_time();
     if (!super::probe(provider, score)) {
         XYLog("super probe failed\n");
         return NULL;
@@ -145,14 +481,18 @@ IOService * IntelBluetoothFirmware::probe(IOService *provider, SInt32 *score)
     UInt16 vendorID = USBToHost16(m_pDevice->getDeviceDescriptor()->idVendor);
     UInt16 productID = USBToHost16(m_pDevice->getDeviceDescriptor()->idProduct);
     XYLog("name=%s, class=%s, vendorID=0x%04X, productID=0x%04X\n", m_pDevice->getName(), provider->metaClass->getClassName(), vendorID, productID);
-    if (productID == 0x07dc || productID == 0x0a2a || productID == 0x0aa7) {
-        currentType = kTypeGen1;
-    } else if (productID == 0x0032 || productID == 0x0033 || productID == 0x0035
-               || productID == 0x0036 || productID == 0x0038) {
-        currentType = kTypeGen3;
-    } else {
-        currentType = kTypeGen2;
+    switch (intelProductGeneration(productID)) {
+        case 1:
+            currentType = kTypeGen1;
+            break;
+        case 3:
+            currentType = kTypeGen3;
+            break;
+        default:
+            currentType = kTypeGen2;
+            break;
     }
     m_pDevice = NULL;
+    probeEnd = mach_absolute_time();
     return this;
 }
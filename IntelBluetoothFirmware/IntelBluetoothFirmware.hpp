@@ -21,6 +21,7 @@
 #include <libkern/OSKextLib.h>
 #include <IOKit/usb/IOUSBHostDevice.h>
 #include <IOKit/usb/IOUSBHostInterface.h>
+#include <kern/thread_call.h>
 
 #include "BtIntel.h"
 
@@ -52,10 +53,43 @@ public:
     
     void publishReg(bool isSucceed, const char *fwName);
     
+    void publishStats(IORegistryEntry *entry);
+    
+    void dumpTrace(const char *reason);
+    
+    void publishResume(uint64_t start);
+    
+    void resume();
+    
+private:
+    void createOps();
+    
+    void startTelemetry();
+    
+    void measureRoundTrip();
+    
+    void configureSetup();
+    
+    void setupFailed(const char *reason);
+    
+    bool interfaceInUse();
+    
+    void scheduleSetup(uint32_t delayMs);
+    
+    static void phaseEnded(void *target, IntelPhase phase);
+    
+    static void setupCallback(thread_call_param_t param0, thread_call_param_t param1);
+    
 private:
     BTType currentType;
+    bool firmwareLoaded;
+    bool sleeping;
+    bool setupDeferred;
+    uint64_t probeStart;
+    uint64_t probeEnd;
     BtIntel *m_pBTIntel;
     IOUSBHostDevice* m_pDevice;
+    thread_call_t setupCall;
 };
 
 #endif
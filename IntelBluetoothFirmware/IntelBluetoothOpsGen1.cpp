@@ -15,7 +15,6 @@ OSDefineMetaClassAndStructors(IntelBluetoothOpsGen1, BtIntel)
 bool IntelBluetoothOpsGen1::
 setup()
 {
-    const uint8_t *fw_ptr;
     bool disablePatch;
     IntelVersion ver;
     OSData *fwData = NULL;
@@ -50,6 +49,11 @@ setup()
           ver.fw_variant,  ver.fw_revision, ver.fw_build_num,
           ver.fw_build_ww, ver.fw_build_yy, ver.fw_patch_num);
     
+    if (resumeFastPath()) {
+        strncpy(this->loadedFirmwareName, m_cached.fwName, sizeof(this->loadedFirmwareName));
+        goto complete;
+    }
+    
     /* Opens the firmware patch file based on the firmware version read
      * from the controller. If it fails to open the matching firmware
      * patch file, it tries to open the default firmware patch file.
@@ -57,6 +61,8 @@ setup()
      * a patch.
      */
     fwData = getFirmware(&ver, fwname, sizeof(fwname));
+    if (fwData)
+        keepFirmware(fwData, 0);
     
     strncpy(this->loadedFirmwareName, fwname, sizeof(this->loadedFirmwareName));
     
@@ -73,8 +79,6 @@ setup()
         goto complete;
     }
     
-    fw_ptr = (uint8_t *)fwData->getBytesNoCopy();
-    
     /* Enable the manufacturer mode of the controller.
      * Only while this mode is enabled, the driver can download the
      * firmware patch data and configuration parameters.
@@ -88,14 +92,12 @@ setup()
     disablePatch = true;
     
     /* The firmware data file consists of list of Intel specific HCI
-     * commands and its expected events. The first byte indicates the
-     * type of the message, either HCI command or HCI event.
+     * commands and its expected events, compiled at build time into a
+     * table of records (see IntelPatchTableHdr).
      *
-     * It reads the command and its expected event from the firmware file,
-     * and send to the controller. Once __hci_cmd_sync_ev() returns,
-     * the returned event is compared with the event read from the firmware
-     * file and it will continue until all the messages are downloaded to
-     * the controller.
+     * The commands are sent to the controller one by one and each
+     * expected event is awaited before the next command, until all the
+     * records are downloaded to the controller.
      *
      * Once the firmware patching is completed successfully,
      * the manufacturer mode is disabled with reset and activating the
@@ -107,10 +109,8 @@ setup()
      * If the default patch file is used, no reset is done when disabling
      * the manufacturer.
      */
-    while (fwData->getLength() > fw_ptr - (uint8_t *)fwData->getBytesNoCopy()) {
-        if (!patching(fwData, &fw_ptr, &disablePatch))
-            goto exit_mfg_deactivate;
-    }
+    if (!patching(fwData, &disablePatch))
+        goto exit_mfg_deactivate;
     
     XYLog("Patch file download done\n");
     
@@ -184,6 +184,15 @@ getFirmwareName(char *fwname, size_t len)
     return true;
 }
 
+/* These controllers have no debug features page, only the debug event
+ * mask, which can only be set in manufacturer mode.
+ */
+bool IntelBluetoothOpsGen1::
+enableTelemetry()
+{
+    return setEventMaskMfg(true);
+}
+
 bool IntelBluetoothOpsGen1::
 hciReset()
 {
@@ -220,101 +229,31 @@ getFirmware(IntelVersion *ver, char *fwname, size_t len)
 }
 
 bool IntelBluetoothOpsGen1::
-patching(OSData *fwData, const uint8_t **fw_ptr, bool *disablePatch)
+patching(OSData *fwData, bool *disablePatch)
 {
-    const uint8_t *cmdParam;
-    FWCommandHdr *cmd = NULL;
-    const uint8_t *evtParam = NULL;
-    HciEventHdr *evt = NULL;
-    uint8_t sendBuf[CMD_BUF_MAX_SIZE];
-    uint8_t respBuf[CMD_BUF_MAX_SIZE];
-    HciCommandHdr *hciCmd = (HciCommandHdr *)sendBuf;
-    HciResponse *resp = (HciResponse *)respBuf;
-    uint32_t actRespLen = 0;
-    int remain = (int)(fwData->getLength() - (*fw_ptr - (uint8_t *)fwData->getBytesNoCopy()));
-    
-    /* The first byte indicates the types of the patch command or event.
-     * 0x01 means HCI command and 0x02 is HCI event. If the first bytes
-     * in the current firmware buffer doesn't start with 0x01 or
-     * the size of remain buffer is smaller than HCI command header,
-     * the firmware file is corrupted and it should stop the patching
-     * process.
+    /* The command and event framing was validated when the table was
+     * generated, only the bounds are checked here.
      */
-    if (remain > HCI_COMMAND_HDR_SIZE && *fw_ptr[0] != 0x01) {
-        XYLog("Intel fw corrupted: invalid cmd read\n");
+    IntelPhaseScope phase(&m_timeline, kPhasePatch);
+    const IntelPatchTableHdr *hdr = patchTableHeader(fwData);
+    if (!hdr) {
+        phase.fail();
+        XYLog("Intel fw corrupted: invalid patch table\n");
         return false;
     }
-    (*fw_ptr)++;
-    remain--;
-    
-    cmd = (FWCommandHdr *)(*fw_ptr);
-    *fw_ptr += sizeof(*cmd);
-    remain -= sizeof(*cmd);
     
-    /* Ensure that the remain firmware data is long enough than the length
-     * of command parameter. If not, the firmware file is corrupted.
-     */
-    if (remain < cmd->len) {
-        XYLog("Intel fw corrupted: invalid cmd len\n");
-        return false;
-    }
     /* If there is a command that loads a patch in the firmware
      * file, then enable the patch upon success, otherwise just
      * disable the manufacturer mode, for example patch activation
      * is not required when the default firmware patch file is used
      * because there are no patch data to load.
      */
-    if (*disablePatch && OSSwapLittleToHostInt16(cmd->opcode) == 0xfc8e)
-        *disablePatch = false;
-    
-    cmdParam = *fw_ptr;
-    *fw_ptr += cmd->len;
-    remain -= cmd->len;
-    
-    /* This reads the expected events when the above command is sent to the
-     * device. Some vendor commands expects more than one events, for
-     * example command status event followed by vendor specific event.
-     * For this case, it only keeps the last expected event. so the command
-     * can be sent with __hci_cmd_sync_ev() which returns the sk_buff of
-     * last expected event.
-     */
-    while (remain > HCI_EVENT_HDR_SIZE && *fw_ptr[0] == 0x02) {
-        (*fw_ptr)++;
-        remain--;
-        
-        evt = (HciEventHdr *)(*fw_ptr);
-        *fw_ptr += sizeof(*evt);
-        remain -= sizeof(*evt);
-        
-        if (remain < evt->len) {
-            XYLog("Intel fw corrupted: invalid evt len\n");
-            return false;
-        }
-        
-        evtParam = *fw_ptr;
-        *fw_ptr += evt->len;
-        remain -= evt->len;
-    }
-    
-    /* Every HCI commands in the firmware file has its correspond event.
-     * If event is not found or remain is smaller than zero, the firmware
-     * file is corrupted.
-     */
-    if (!evt || !evtParam || remain < 0) {
-        XYLog("Intel fw corrupted: invalid evt read\n");
-        return false;
-    }
-    
-    memset(sendBuf, 0, sizeof(sendBuf));
-    memset(respBuf, 0, sizeof(respBuf));
-    hciCmd->opcode = OSSwapLittleToHostInt16(cmd->opcode);
-    hciCmd->len = cmd->len;
-    memcpy(hciCmd->data, cmdParam, hciCmd->len);
+    *disablePatch = !(hdr->flags & IBT_PATCH_TABLE_F_ENABLE);
     
-    if (!intelSendHCISyncEvent(hciCmd, resp, sizeof(respBuf), &actRespLen, evt->evt, HCI_INIT_TIMEOUT)) {
-        XYLog("sending Intel patch command (0x%4.4x) failed\n", hciCmd->opcode);
+    m_timeline.account(OSSwapLittleToHostInt32(hdr->length), OSSwapLittleToHostInt16(hdr->count));
+    if (!intelSendPatchTable(hdr, false, HCI_INIT_TIMEOUT)) {
+        phase.fail();
         return false;
     }
-    
     return true;
 }
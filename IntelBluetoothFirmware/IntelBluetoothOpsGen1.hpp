@@ -22,9 +22,13 @@ public:
     
     virtual bool getFirmwareName(char *fwname, size_t len) override;
     
-private:
+    virtual bool enableTelemetry() override;
+    
+protected:
     
-    bool patching(OSData *fwData, const uint8_t **fw_ptr, bool *disablePatch);
+    bool patching(OSData *fwData, bool *disablePatch);
+    
+private:
     
     bool hciReset();
     
@@ -53,12 +53,14 @@ bootloaderSetup(IntelVersion *ver)
     }
     
     /* Read the Intel version information after loading the FW  */
-    if (!readVersion(&newVer)) {
-        return false;
+    if (!cachedVersionAfterBoot()) {
+        if (!readVersion(&newVer)) {
+            return false;
+        }
+        
+        intelVersionInfo(&newVer);
     }
     
-    intelVersionInfo(&newVer);
-    
 finish:
     
     /* Set the event mask for Intel specific vendor events. This enables
@@ -92,6 +94,11 @@ setup()
         return false;
     }
     
+    if (resumeFastPath()) {
+        strncpy(this->loadedFirmwareName, m_cached.fwName, sizeof(this->loadedFirmwareName));
+        return setEventMask(false);
+    }
+    
     return bootloaderSetup(&ver);
 }
 
@@ -104,12 +111,14 @@ downloadFirmware(IntelVersion *ver, IntelBootParams *params, uint32_t *bootParam
     uint32_t actSize = 0;
     uint8_t buf[CMD_BUF_MAX_SIZE];
     HciResponse *resp = (HciResponse *)buf;
+    const IntelVariantTraits *traits;
     bool firmwareMode = false;
     bool ret = true;
     
     if (!ver || !params) {
         return false;
     }
+    traits = intelVariantTraits(ver->hw_variant);
     
     /* The firmware variant determines if the device is in bootloader
      * mode or is running operational firmware. The value 0x06 identifies
@@ -131,21 +140,23 @@ downloadFirmware(IntelVersion *ver, IntelBootParams *params, uint32_t *bootParam
         /* SfP and WsP don't seem to update the firmware version on file
          * so version checking is currently possible.
          */
-        switch (ver->hw_variant) {
-            case 0x0b:    /* SfP */
-            case 0x0c:    /* WsP */
-                return true;
-        }
+        if (traits && !traits->versionCheck)
+            return true;
         
         /* Proceed to download to check if the version matches */
         goto download;
     }
     
+    setBootloader(true);
+    
     /* Read the secure boot parameters to identify the operating
      * details of the bootloader.
      */
-    if (!readBootParams(params)) {
-        return false;
+    if (!cachedBootParams(params)) {
+        if (!readBootParams(params)) {
+            return false;
+        }
+        noteBootParams(params);
     }
     
     /* It is required that every single firmware fragment is acknowledged
@@ -235,9 +246,20 @@ download:
      * of this device.
      */
     memset(buf, 0, sizeof(buf));
-    ior = m_pUSBDeviceController->interruptPipeRead(resp, sizeof(buf), &actSize, 5000);
+    {
+        IntelPhaseScope phase(&m_timeline, kPhaseDownloadWait);
+        uint64_t start = mach_absolute_time();
+        ior = m_pTransport->interruptPipeRead(resp, sizeof(buf), &actSize, 5000);
+        if (ior == kIOReturnTimeout)
+            intelLatencyTimeout(m_pLatency, IBT_LATENCY_DOWNLOAD_NOTIFY);
+        if (ior != kIOReturnSuccess || resp->evt.evt != 0xff || resp->numCommands != 0x06)
+            phase.fail();
+        else
+            commandLatency(IBT_LATENCY_DOWNLOAD_NOTIFY, start);
+    }
     if (ior != kIOReturnSuccess) {
         XYLog("waiting for firmware download done timeout\n");
+        noteFault(kRecoveryDownloadTimeout);
         resetToBootloader();
         ret = false;
         goto done;
@@ -248,9 +270,12 @@ download:
         goto done;
     }
     
+    hardwareError(resp, actSize);
     ret = false;
     
 done:
+    if (ret && fwData)
+        keepFirmware(fwData, *bootParams);
     OSSafeReleaseNULL(fwData);
     return ret;
 }
@@ -258,26 +283,22 @@ done:
 IOReturn IntelBluetoothOpsGen2::
 downloadFirmwareData(IntelVersion *ver, OSData *fwData, uint32_t *bootParams)
 {
+    const IntelVariantTraits *traits = intelVariantTraits(ver->hw_variant);
+    
     /* SfP and WsP don't seem to update the firmware version on file
      * so version checking is currently not possible.
      */
-    switch (ver->hw_variant) {
-        case 0x0b:    /* SfP */
-        case 0x0c:    /* WsP */
-            /* Skip version checking */
-            break;
-        default:
-            
-            /* Skip download if firmware has the same version */
-            if (firmwareVersion(ver->fw_build_num,
-                                ver->fw_build_ww, ver->fw_build_yy,
-                                fwData, bootParams)) {
-                XYLog("Firmware already loaded\n");
-                /* Return -EALREADY to indicate that the firmware has
-                 * already been loaded.
-                 */
-                return -EALREADY;
-            }
+    if (!traits || traits->versionCheck) {
+        /* Skip download if firmware has the same version */
+        if (firmwareVersion(ver->fw_build_num,
+                            ver->fw_build_ww, ver->fw_build_yy,
+                            fwData, bootParams)) {
+            XYLog("Firmware already loaded\n");
+            /* Return -EALREADY to indicate that the firmware has
+             * already been loaded.
+             */
+            return -EALREADY;
+        }
     }
     
     /* The firmware variant determines if the device is in bootloader
@@ -305,18 +326,18 @@ bool IntelBluetoothOpsGen2::
 getFirmware(IntelVersion *ver, IntelBootParams *params, 
             char *name, size_t len, const char *suffix)
 {
-    switch (ver->hw_variant) {
-        case 0x0b:    /* SfP */
-        case 0x0c:    /* WsP */
+    const IntelVariantTraits *traits = intelVariantTraits(ver->hw_variant);
+    
+    if (!traits)
+        return false;
+    switch (traits->naming) {
+        case kNamingDevRevid:
             snprintf(name, len, "ibt-%u-%u.%s",
                      OSSwapLittleToHostInt16(ver->hw_variant),
                      OSSwapLittleToHostInt16(params->dev_revid),
                      suffix);
             break;
-        case 0x11:    /* JfP */
-        case 0x12:    /* ThP */
-        case 0x13:    /* HrP */
-        case 0x14:    /* CcP */
+        case kNamingRevision:
             snprintf(name, len, "ibt-%u-%u-%u.%s",
                      OSSwapLittleToHostInt16(ver->hw_variant),
                      OSSwapLittleToHostInt16(ver->hw_revision),
@@ -333,35 +354,40 @@ getFirmware(IntelVersion *ver, IntelBootParams *params,
 bool IntelBluetoothOpsGen2::
 rsaHeaderSecureSend(OSData *fwData)
 {
+    IntelPhaseScope phase(&m_timeline, kPhaseHeader);
+    
     /* Start the firmware download transaction with the Init fragment
      * represented by the 128 bytes of CSS header.
      */
-    XYLog("send firmware header\n");
+    IBTTrace(m_pTrace, IBT_TRACE_DEBUG, "send firmware header\n");
     if (!securedSend(0x00, 128, (const uint8_t *)fwData->getBytesNoCopy())) {
-        XYLog("Failed to send firmware header\n");
+        phase.fail();
+        IBTTrace(m_pTrace, IBT_TRACE_ERROR, "Failed to send firmware header\n");
         return false;
     }
-    XYLog("send firmware header done\n");
+    IBTTrace(m_pTrace, IBT_TRACE_DEBUG, "send firmware header done\n");
     
     /* Send the 256 bytes of public key information from the firmware
      * as the PKey fragment.
      */
-    XYLog("send firmware pkey\n");
+    IBTTrace(m_pTrace, IBT_TRACE_DEBUG, "send firmware pkey\n");
     if (!securedSend(0x03, 256, (const uint8_t *)fwData->getBytesNoCopy() + 128)) {
-        XYLog("Failed to send firmware pkey\n");
+        phase.fail();
+        IBTTrace(m_pTrace, IBT_TRACE_ERROR, "Failed to send firmware pkey\n");
         return false;
     }
-    XYLog("send firmware pkey done\n");
+    IBTTrace(m_pTrace, IBT_TRACE_DEBUG, "send firmware pkey done\n");
     
     /* Send the 256 bytes of signature information from the firmware
      * as the Sign fragment.
      */
-    XYLog("send firmware signature\n");
+    IBTTrace(m_pTrace, IBT_TRACE_DEBUG, "send firmware signature\n");
     if (!securedSend(0x02, 256, (const uint8_t *)fwData->getBytesNoCopy() + 388)) {
-        XYLog("Failed to send firmware signature\n");
+        phase.fail();
+        IBTTrace(m_pTrace, IBT_TRACE_ERROR, "Failed to send firmware signature\n");
         return false;
     }
-    XYLog("send firmware signature done\n");
+    IBTTrace(m_pTrace, IBT_TRACE_DEBUG, "send firmware signature done\n");
     
     return true;
 }
@@ -369,7 +395,8 @@ rsaHeaderSecureSend(OSData *fwData)
 bool IntelBluetoothOpsGen2::
 downloadFirmwarePayload(OSData *fwData, size_t offset)
 {
-    XYLog("send firmware payload\n");
+    IBTTrace(m_pTrace, IBT_TRACE_INFO, "send firmware payload from offset %llu\n", offset);
+    IntelPhaseScope phase(&m_timeline, kPhasePayload);
     uint32_t frag_len;
     bool ret = true;
     const uint8_t *fw_ptr = (uint8_t *)fwData->getBytesNoCopy() + offset;
@@ -390,7 +417,9 @@ downloadFirmwarePayload(OSData *fwData, size_t offset)
          */
         if (!(frag_len % 4)) {
             if (!securedSend(0x01, frag_len, fw_ptr)) {
-                XYLog("Failed to send firmware data\n");
+                IBTTrace(m_pTrace, IBT_TRACE_ERROR, "Failed to send firmware data at offset %llu\n",
+                         fw_ptr - (uint8_t *)fwData->getBytesNoCopy());
+                phase.fail();
                 ret = false;
                 goto done;
             }
@@ -401,7 +430,7 @@ downloadFirmwarePayload(OSData *fwData, size_t offset)
     }
     
 done:
-    XYLog("send firmware payload done\n");
+    IBTTrace(m_pTrace, IBT_TRACE_INFO, "send firmware payload done\n");
     return ret;
 }
 
@@ -40,10 +40,10 @@ protected:
     
     bool bootloaderSetup(IntelVersion *ver);
     
-private:
-    
     bool getFirmware(IntelVersion *ver, IntelBootParams *params, char *name, size_t len, const char *suffix);
     
+private:
+    
     IOReturn downloadFirmwareData(IntelVersion *ver, OSData *fwData, uint32_t *bootParams);
     
     bool downloadFirmware(IntelVersion *ver, IntelBootParams *params, uint32_t *bootParams);
@@ -19,12 +19,14 @@ readVersionTyP(void *version)
     uint actLen = 0;
     HciCommandHdr *cmd = (HciCommandHdr *)buf;
     HciResponse *resp = (HciResponse *)temp;
+    IntelPhaseScope phase(&m_timeline, kPhaseReadVersion);
     
     memset(temp, 0, sizeof(temp));
     cmd->opcode = OSSwapHostToLittleInt16(0xfc05);
     cmd->len = 1;
     cmd->data[0] = 0xFF;
     if (!intelSendHCISync(cmd, resp, sizeof(buf), &actLen, HCI_CMD_TIMEOUT)) {
+        phase.fail();
         XYLog("Reading Intel version information failed\n");
         return 0;
     }
@@ -35,6 +37,7 @@ readVersionTyP(void *version)
     }
     
     memcpy(version, resp->data, actLen - 5);
+    noteIdentity(resp->data, actLen - 5);
     
     return actLen - 5;
 }
@@ -79,13 +82,15 @@ bootloaderSetupTLV(IntelVersionTLV *verTLV)
     loadDDCConfig(ddcname);
     
     /* Read the Intel version information after loading the FW  */
-    if (!readVersionTLV(&newVerTLV)) {
-        XYLog("Intel Read TLV version failed %d\n", __LINE__);
-        return false;
+    if (!cachedVersionAfterBoot()) {
+        if (!readVersionTLV(&newVerTLV)) {
+            XYLog("Intel Read TLV version failed %d\n", __LINE__);
+            return false;
+        }
+        
+        versionInfoTLV(&newVerTLV);
     }
     
-    versionInfoTLV(&newVerTLV);
-    
 finish:
     /* Set the event mask for Intel specific vendor events. This enables
      * a few extra events that are useful during general operation. It
@@ -105,6 +110,7 @@ setup()
     uint8_t v[CMD_BUF_MAX_SIZE];
     IntelVersion *verPtr = reinterpret_cast<IntelVersion *>(v);
     IntelVersionTLV verTLV;
+    const IntelVariantTraits *traits;
     
     /* Starting from TyP device, the command parameter and response are
      * changed even though the OCF for HCI_Intel_Read_Version command
@@ -119,6 +125,11 @@ setup()
         return false;
     }
     
+    if (resumeFastPath()) {
+        strncpy(this->loadedFirmwareName, m_cached.fwName, sizeof(this->loadedFirmwareName));
+        return setEventMask(false);
+    }
+    
     /* For Legacy device, check the HW platform value and size */
     if (actLen == sizeof(IntelVersion)) {
         XYLog("Read the legacy Intel version information\n");
@@ -134,22 +145,14 @@ setup()
          * along.
          */
         
-        switch (verPtr->hw_variant) {
-            case 0x0b:      /* SfP */
-            case 0x0c:      /* WsP */
-            case 0x11:      /* JfP */
-            case 0x12:      /* ThP */
-            case 0x13:      /* HrP */
-            case 0x14:      /* CcP */
-                
-                if (!bootloaderSetup(verPtr)) {
-                    return false;
-                }
-                break;
-                
-            default:
-                XYLog("Unsupported Intel hw variant (%u)\n", verPtr->hw_variant);
-                return false;
+        traits = intelVariantTraits(verPtr->hw_variant);
+        if (!traits || traits->generation != 2) {
+            XYLog("Unsupported Intel hw variant (%u)\n", verPtr->hw_variant);
+            return false;
+        }
+        
+        if (!bootloaderSetup(verPtr)) {
+            return false;
         }
         
         return true;
@@ -179,55 +182,48 @@ setup()
      * compatibility options when newer hardware variants come
      * along.
      */
-    switch (INTEL_HW_VARIANT(verTLV.cnvi_bt)) {
-        case 0x11:      /* JfP */
-        case 0x12:      /* ThP */
-        case 0x13:      /* HrP */
-        case 0x14:      /* CcP */
-            
-            XYLog("Legacy bootloader with new firmware\n");
-            
-            /* Some legacy bootloader devices starting from JfP,
-             * the operational firmware supports both old and TLV based
-             * HCI_Intel_Read_Version command based on the command
-             * parameter.
-             *
-             * For upgrading firmware case, the TLV based version cannot
-             * be used because the firmware filename for legacy bootloader
-             * is based on the old format.
-             *
-             * Also, it is not easy to convert TLV based version from the
-             * legacy version format.
-             *
-             * So, as a workaround for those devices, use the legacy
-             * HCI_Intel_Read_Version to get the version information and
-             * run the legacy bootloader setup.
-             */
+    traits = intelVariantTraits(INTEL_HW_VARIANT(verTLV.cnvi_bt));
+    if (traits && traits->generation == 2 && traits->tlvVersion) {
+        XYLog("Legacy bootloader with new firmware\n");
+        
+        /* Some legacy bootloader devices starting from JfP,
+         * the operational firmware supports both old and TLV based
+         * HCI_Intel_Read_Version command based on the command
+         * parameter.
+         *
+         * For upgrading firmware case, the TLV based version cannot
+         * be used because the firmware filename for legacy bootloader
+         * is based on the old format.
+         *
+         * Also, it is not easy to convert TLV based version from the
+         * legacy version format.
+         *
+         * So, as a workaround for those devices, use the legacy
+         * HCI_Intel_Read_Version to get the version information and
+         * run the legacy bootloader setup.
+         */
+        if (!cachedLegacyVersion(verPtr)) {
             if (!readVersion(verPtr)) {
                 XYLog("Intel Read version failed\n");
                 return false;
             }
-            
-            if (!bootloaderSetup(verPtr)) {
-                return false;
-            }
-            break;
-        case 0x17:
-        case 0x18:
-        case 0x19:
-        case 0x1b:
-        case 0x1c:
-            /* Display version information of TLV type */
-            versionInfoTLV(&verTLV);
-            
-            if (!bootloaderSetupTLV(&verTLV)) {
-                return false;
-            }
-            break;
-        default:
-            XYLog("Unsupported Intel hw variant (%u)\n",
-                  INTEL_HW_VARIANT(verTLV.cnvi_bt));
+            noteLegacyVersion(verPtr);
+        }
+        
+        if (!bootloaderSetup(verPtr)) {
             return false;
+        }
+    } else if (traits && traits->generation == 3) {
+        /* Display version information of TLV type */
+        versionInfoTLV(&verTLV);
+        
+        if (!bootloaderSetupTLV(&verTLV)) {
+            return false;
+        }
+    } else {
+        XYLog("Unsupported Intel hw variant (%u)\n",
+              INTEL_HW_VARIANT(verTLV.cnvi_bt));
+        return false;
     }
     
     return true;
@@ -264,6 +260,8 @@ downloadFirmware(IntelVersionTLV *ver, uint32_t *bootParams)
      */
     if (ver->img_type == 0x03) {
         firmwareMode = true;
+    } else {
+        setBootloader(true);
     }
     
     getFirmware(ver, fwname, sizeof(fwname), "sfi");
@@ -317,9 +315,20 @@ downloadFirmware(IntelVersionTLV *ver, uint32_t *bootParams)
      * of this device.
      */
     memset(buf, 0, sizeof(buf));
-    ior = m_pUSBDeviceController->interruptPipeRead(resp, sizeof(buf), &actSize, 5000);
+    {
+        IntelPhaseScope phase(&m_timeline, kPhaseDownloadWait);
+        uint64_t start = mach_absolute_time();
+        ior = m_pTransport->interruptPipeRead(resp, sizeof(buf), &actSize, 5000);
+        if (ior == kIOReturnTimeout)
+            intelLatencyTimeout(m_pLatency, IBT_LATENCY_DOWNLOAD_NOTIFY);
+        if (ior != kIOReturnSuccess || resp->evt.evt != 0xff || resp->numCommands != 0x06)
+            phase.fail();
+        else
+            commandLatency(IBT_LATENCY_DOWNLOAD_NOTIFY, start);
+    }
     if (ior != kIOReturnSuccess) {
         XYLog("waiting for firmware download done timeout\n");
+        noteFault(kRecoveryDownloadTimeout);
         resetToBootloader();
         ret = false;
         goto done;
@@ -330,9 +339,12 @@ downloadFirmware(IntelVersionTLV *ver, uint32_t *bootParams)
         goto done;
     }
     
+    hardwareError(resp, actSize);
     ret = false;
     
 done:
+    if (ret && fwData)
+        keepFirmware(fwData, *bootParams);
     OSSafeReleaseNULL(fwData);
     return ret;
 }
@@ -340,6 +352,7 @@ done:
 IOReturn IntelBluetoothOpsGen3::
 downloadFirmwareData(IntelVersionTLV *ver, OSData *fwData, uint32_t *bootParams, uint8_t hwVariant, uint8_t sbeType)
 {
+    const IntelVariantTraits *traits;
     uint32_t cssHeaderVer;
 
     /* Skip download if firmware has the same version */
@@ -386,7 +399,13 @@ downloadFirmwareData(IntelVersionTLV *ver, OSData *fwData, uint32_t *bootParams,
     
     XYLog("%s hwVariant: %d sbeType: %d\n", __FUNCTION__, hwVariant, sbeType);
     
-    if (hwVariant <= 0x14) {
+    traits = intelVariantTraits(hwVariant);
+    if (!traits) {
+        XYLog("Unsupported Intel hw variant (%u)\n", hwVariant);
+        return kIOReturnUnsupported;
+    }
+    
+    if (!traits->ecdsa) {
         if (sbeType != 0x00) {
             XYLog("Invalid SBE type for hardware variant (%d)",
                   hwVariant);
@@ -402,7 +421,7 @@ downloadFirmwareData(IntelVersionTLV *ver, OSData *fwData, uint32_t *bootParams,
             return kIOReturnError;
         }
         
-    } else if (hwVariant >= 0x17) {
+    } else {
         /* Check if CSS header for ECDSA follows the RSA header */
         if (((uint8_t *)fwData->getBytesNoCopy())[ECDSA_OFFSET] != 0x06)
             return -EINVAL;
@@ -441,35 +460,40 @@ downloadFirmwareData(IntelVersionTLV *ver, OSData *fwData, uint32_t *bootParams,
 bool IntelBluetoothOpsGen3::
 ecdsaHeaderSecureSend(OSData *fwData)
 {
+    IntelPhaseScope phase(&m_timeline, kPhaseHeader);
+    
     /* Start the firmware download transaction with the Init fragment
      * represented by the 128 bytes of CSS header.
      */
-    XYLog("send firmware header\n");
+    IBTTrace(m_pTrace, IBT_TRACE_DEBUG, "send firmware header\n");
     if (!securedSend(0x00, 128, (const uint8_t *)fwData->getBytesNoCopy() + 644)) {
-        XYLog("Failed to send firmware header\n");
+        phase.fail();
+        IBTTrace(m_pTrace, IBT_TRACE_ERROR, "Failed to send firmware header\n");
         return false;
     }
-    XYLog("send firmware header done\n");
+    IBTTrace(m_pTrace, IBT_TRACE_DEBUG, "send firmware header done\n");
     
     /* Send the 96 bytes of public key information from the firmware
      * as the PKey fragment.
      */
-    XYLog("send firmware pkey\n");
+    IBTTrace(m_pTrace, IBT_TRACE_DEBUG, "send firmware pkey\n");
     if (!securedSend(0x03, 96, (const uint8_t *)fwData->getBytesNoCopy() + 644 + 128)) {
-        XYLog("Failed to send firmware pkey\n");
+        phase.fail();
+        IBTTrace(m_pTrace, IBT_TRACE_ERROR, "Failed to send firmware pkey\n");
         return false;
     }
-    XYLog("send firmware pkey done\n");
+    IBTTrace(m_pTrace, IBT_TRACE_DEBUG, "send firmware pkey done\n");
     
     /* Send the 96 bytes of signature information from the firmware
      * as the Sign fragment
      */
-    XYLog("send firmware signature\n");
+    IBTTrace(m_pTrace, IBT_TRACE_DEBUG, "send firmware signature\n");
     if (!securedSend(0x02, 96, (const uint8_t *)fwData->getBytesNoCopy() + 644 + 224)) {
-        XYLog("Failed to send firmware signature\n");
+        phase.fail();
+        IBTTrace(m_pTrace, IBT_TRACE_ERROR, "Failed to send firmware signature\n");
         return false;
     }
-    XYLog("send firmware signature done\n");
+    IBTTrace(m_pTrace, IBT_TRACE_DEBUG, "send firmware signature done\n");
     
     return true;
 }
@@ -580,6 +604,7 @@ readVersionTLV(IntelVersionTLV *version)
     HciCommandHdr *cmd = (HciCommandHdr *)sendBuf;
     const uint8_t *versionDataPtr;
     int len = 0;
+    IntelPhaseScope phase(&m_timeline, kPhaseReadVersion);
     
     memset(sendBuf, 0, sizeof(sendBuf));
     cmd->opcode = OSSwapHostToLittleInt16(0xfc05);
@@ -588,17 +613,20 @@ readVersionTLV(IntelVersionTLV *version)
     
     memset(respBuf, 0, sizeof(respBuf));
     if (!intelSendHCISync(cmd, resp, sizeof(respBuf), &actLen, HCI_CMD_TIMEOUT)) {
+        phase.fail();
         XYLog("Reading Intel version information failed\n");
         return false;
     }
     
     if (actLen < 5) {
+        phase.fail();
         XYLog("Invalid size %d\n", actLen);
         return false;
     }
     
     versionDataPtr = resp->data;
     len = actLen - 5;
+    noteIdentity(versionDataPtr, len);
     
     parseVersionTLV(version, versionDataPtr, len);
     
@@ -608,6 +636,7 @@ readVersionTLV(IntelVersionTLV *version)
 bool IntelBluetoothOpsGen3::
 versionInfoTLV(IntelVersionTLV *version)
 {
+    const IntelVariantTraits *traits = intelVariantTraits(INTEL_HW_VARIANT(version->cnvi_bt));
     const char *variant;
     
     /* The hardware platform number has a fixed value of 0x37 and
@@ -625,18 +654,12 @@ versionInfoTLV(IntelVersionTLV *version)
      * This check has been put in place to ensure correct forward
      * compatibility options when newer hardware variants come along.
      */
-    switch (INTEL_HW_VARIANT(version->cnvi_bt)) {
-        case 0x17:    /* TyP */
-        case 0x18:    /* Slr */
-        case 0x19:    /* Slr-F */
-        case 0x1b:    /* Mgr */
-        case 0x1c:    /* Gale Peak (GaP) */
-            break;
-        default:
-            XYLog("Unsupported Intel hardware variant (0x%x)\n",
-                  INTEL_HW_VARIANT(version->cnvi_bt));
-            return false;
+    if (!traits || traits->generation != 3) {
+        XYLog("Unsupported Intel hardware variant (0x%x)\n",
+              INTEL_HW_VARIANT(version->cnvi_bt));
+        return false;
     }
+    m_variant = traits;
     
     switch (version->img_type) {
         case 0x01:
@@ -679,7 +702,7 @@ versionInfoTLV(IntelVersionTLV *version)
             return false;
     }
     
-    XYLog("%s timestamp %u.%u buildtype %u build %u\n", variant,
+    XYLog("%s %s timestamp %u.%u buildtype %u build %u\n", traits->name, variant,
           2000 + (version->timestamp >> 8), version->timestamp & 0xff,
           version->build_type, version->build_num);
     
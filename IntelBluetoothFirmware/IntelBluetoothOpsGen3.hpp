@@ -67,6 +67,10 @@ protected:
     
     bool bootloaderSetupTLV(IntelVersionTLV *ver);
     
+    bool parseVersionTLV(IntelVersionTLV *version, const uint8_t *versionDataPtr, int len);
+    
+    bool getFirmware(IntelVersionTLV *tlv, char *name, size_t len, const char *suffix);
+    
 private:
     
     int readVersionTyP(void *version);
@@ -75,10 +79,6 @@ private:
     
     bool readVersionTLV(IntelVersionTLV *version);
     
-    bool parseVersionTLV(IntelVersionTLV *version, const uint8_t *versionDataPtr, int len);
-    
-    bool getFirmware(IntelVersionTLV *tlv, char *name, size_t len, const char *suffix);
-    
     bool downloadFirmware(IntelVersionTLV *ver, uint32_t *bootParams);
     
     IOReturn downloadFirmwareData(IntelVersionTLV *ver, OSData *fwData, uint32_t *bootParams, uint8_t hwVariant, uint8_t sbeType);
@@ -10,8 +10,8 @@
 #include "Log.h"
 #include "Hci.h"
 
-#define super OSObject
-OSDefineMetaClassAndStructors(USBDeviceController, OSObject)
+#define super HCITransport
+OSDefineMetaClassAndStructors(USBDeviceController, HCITransport)
 
 #define kReadBufferSize 4096
 
@@ -26,6 +26,13 @@ init(IOService *client, IOUSBHostDevice *dev)
     if (!_hciLock) {
         return false;
     }
+    memset(mStats, 0, sizeof(mStats));
+    m_pDeadline = NULL;
+    mTrace.reset();
+    if (!mSnoop.init()) {
+        XYLog("Fail to alloc snoop ring\n");
+        return false;
+    }
     mReadBuffer = IOBufferMemoryDescriptor::inTaskWithOptions(kernel_task
                                                               , kIODirectionIn, kReadBufferSize);
     if (!mReadBuffer) {
@@ -92,6 +99,7 @@ free()
         IOLockFree(_hciLock);
         _hciLock = NULL;
     }
+    mSnoop.free();
     if (m_pInterface) {
         if (m_pClient && m_pInterface->isOpen(m_pClient)) {
             m_pInterface->close(m_pClient);
@@ -182,18 +190,36 @@ findPipes()
     return (m_pInterruptReadPipe != NULL && m_pBulkWritePipe != NULL && m_pBulkReadPipe != NULL);
 }
 
+/* A zero timeout means wait forever to the pipes, so a spent budget
+ * must not reach them.
+ */
+bool USBDeviceController::
+clampTimeout(uint32_t *timeout)
+{
+    if (!m_pDeadline)
+        return true;
+    *timeout = m_pDeadline->clamp(*timeout);
+    return *timeout != 0;
+}
+
 IOReturn USBDeviceController::
 bulkPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout)
 {
     uint32_t actualLength = 0;
+    if (!clampTimeout(&timeout))
+        return kIOReturnTimeout;
+    uint64_t start = mach_absolute_time();
     IOReturn ret = m_pBulkReadPipe->io(mReadBuffer, (uint32_t)mReadBuffer->getLength(), actualLength, timeout);
     if (ret == kIOUSBPipeStalled) {
         m_pBulkReadPipe->clearStall(true);
+        OSIncrementAtomic64(&mStats[kUSBEndpointBulkIn].stallsCleared);
         ret = m_pBulkReadPipe->io(mReadBuffer, (uint32_t)mReadBuffer->getLength(), actualLength, timeout);
     }
+    usbStatsComplete(&mStats[kUSBEndpointBulkIn], start, actualLength, ret);
     if (ret == kIOReturnSuccess) {
+        mSnoop.record(IBT_SNOOP_EVENT, mReadBuffer->getBytesNoCopy(), actualLength);
         if (buf && actualLength > buf_size) {
-            XYLog("%s buf size too small. buflen: %d act: %d\n", __FUNCTION__, buf_size, actualLength);
+            IBTTrace(&mTrace, IBT_TRACE_ERROR, "bulkPipeRead buf size too small. buflen: %llu act: %llu\n", buf_size, actualLength);
         }
         if (buf) {
             memcpy(buf, mReadBuffer->getBytesNoCopy(), min(actualLength, buf_size));
@@ -202,7 +228,7 @@ bulkPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout)
             *size = min(actualLength, buf_size);
         }
     } else {
-        XYLog("%s failed: %s %d\n", __FUNCTION__, stringFromReturn(ret), ret);
+        IBTTrace(&mTrace, IBT_TRACE_ERROR, "bulkPipeRead failed: 0x%llx\n", (uint32_t)ret);
     }
     return ret;
 }
@@ -219,8 +245,9 @@ interruptHandler(void *owner, void *parameter, IOReturn status, uint32_t bytesTr
             break;
         case kIOReturnNotResponding:
             controller->m_pInterruptReadPipe->clearStall(false);
+            OSIncrementAtomic64(&controller->mStats[kUSBEndpointInterruptIn].stallsCleared);
         default:
-            XYLog("%s status: %s (%d) len: %d\n", __FUNCTION__, controller->stringFromReturn(status), status, bytesTransferred);
+            IBTTrace(&controller->mTrace, IBT_TRACE_ERROR, "interruptHandler status: 0x%llx len: %llu\n", (uint32_t)status, bytesTransferred);
             break;
     }
     
@@ -236,6 +263,10 @@ interruptPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout
     AbsoluteTime deadline;
     IOUSBHostCompletion comple;
     InterruptResp interrupResp;
+    USBEndpointStats *stats = &mStats[kUSBEndpointInterruptIn];
+    if (!clampTimeout(&timeout))
+        return kIOReturnTimeout;
+    uint64_t start = mach_absolute_time();
     
     clock_interval_to_deadline(timeout, kMillisecondScale, reinterpret_cast<uint64_t*> (&deadline));
     memset(&interrupResp, 0, sizeof(interrupResp));
@@ -246,6 +277,7 @@ interruptPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout
     IOReturn ret = m_pInterruptReadPipe->io(mReadBuffer, (uint32_t)mReadBuffer->getLength(), &comple, 0);
     if (ret == kIOUSBPipeStalled) {
         m_pInterruptReadPipe->clearStall(true);
+        OSIncrementAtomic64(&stats->stallsCleared);
         ret = m_pInterruptReadPipe->io(mReadBuffer, (uint32_t)mReadBuffer->getLength(), &comple, 0);
     }
     
@@ -254,16 +286,21 @@ interruptPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout
         if (IOLockSleepDeadline(_hciLock, this, deadline, THREAD_INTERRUPTIBLE) != THREAD_AWAKENED) {
             IOLockUnlock(_hciLock);
             m_pInterruptReadPipe->abort();
-            XYLog("%s Timeout\n", __FUNCTION__);
+            OSIncrementAtomic64(&stats->aborts);
+            usbStatsComplete(stats, start, 0, kIOReturnTimeout);
+            IBTTrace(&mTrace, IBT_TRACE_ERROR, "interruptPipeRead timeout after %llums\n", timeout);
             return kIOReturnTimeout;
         }
+        usbStatsComplete(stats, start, interrupResp.dataLen,
+                         interrupResp.dataLen > 0 ? interrupResp.status : kIOReturnError);
         if (interrupResp.dataLen <= 0) {
             IOLockUnlock(_hciLock);
-            XYLog("%s invalid response size: %d\n", __FUNCTION__, interrupResp.dataLen);
+            IBTTrace(&mTrace, IBT_TRACE_ERROR, "interruptPipeRead invalid response size: %llu status: 0x%llx\n", interrupResp.dataLen, (uint32_t)interrupResp.status);
             return kIOReturnError;
         }
+        mSnoop.record(IBT_SNOOP_EVENT, mReadBuffer->getBytesNoCopy(), interrupResp.dataLen);
         if (buf && interrupResp.dataLen > buf_size) {
-            XYLog("%s buf size too small. buflen: %d act: %d\n", __FUNCTION__, buf_size, interrupResp.dataLen);
+            IBTTrace(&mTrace, IBT_TRACE_ERROR, "interruptPipeRead buf size too small. buflen: %llu act: %llu\n", buf_size, interrupResp.dataLen);
         }
         if (buf) {
             memcpy(buf, mReadBuffer->getBytesNoCopy(), min(interrupResp.dataLen, buf_size));
@@ -273,7 +310,8 @@ interruptPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout
         }
         IOLockUnlock(_hciLock);
     } else {
-        XYLog("%s failed: %s %d\n", __FUNCTION__, stringFromReturn(ret), ret);
+        usbStatsComplete(stats, start, 0, ret);
+        IBTTrace(&mTrace, IBT_TRACE_ERROR, "interruptPipeRead failed: 0x%llx\n", (uint32_t)ret);
     }
     return ret;
 }
@@ -281,7 +319,12 @@ interruptPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout
 IOReturn USBDeviceController::
 sendHCIRequest(HciCommandHdr *cmd, uint32_t timeout)
 {
-    uint32_t actualLength;
+    uint32_t actualLength = 0;
+    uint64_t start;
+    IOReturn ret;
+    if (!clampTimeout(&timeout))
+        return kIOReturnTimeout;
+    start = mach_absolute_time();
     StandardUSB::DeviceRequest request =
     {
         .bmRequestType = makeDeviceRequestbmRequestType(kRequestDirectionOut, kRequestTypeClass, kRequestRecipientDevice),
@@ -291,12 +334,17 @@ sendHCIRequest(HciCommandHdr *cmd, uint32_t timeout)
         .wLength = (uint16_t)(HCI_COMMAND_HDR_SIZE + cmd->len)
     };
     
-    return m_pInterface->deviceRequest(request, cmd, actualLength, timeout);
+    mSnoop.record(IBT_SNOOP_COMMAND, cmd, HCI_COMMAND_HDR_SIZE + cmd->len);
+    ret = m_pInterface->deviceRequest(request, cmd, actualLength, timeout);
+    usbStatsComplete(&mStats[kUSBEndpointControl], start, actualLength, ret);
+    return ret;
 }
 
 IOReturn USBDeviceController::
 bulkWrite(const void *data, uint32_t length, uint32_t timeout)
 {
+    if (!clampTimeout(&timeout))
+        return kIOReturnTimeout;
     IOMemoryDescriptor* buffer = IOMemoryDescriptor::withAddress((void *)data, length, kIODirectionOut);
     if (!buffer) {
         XYLog("Unable to allocate bulk write buffer.\n");
@@ -304,22 +352,27 @@ bulkWrite(const void *data, uint32_t length, uint32_t timeout)
     }
     IOReturn ret;
     uint32_t actLen = 0;
+    uint64_t start = mach_absolute_time();
     if ((ret = buffer->prepare(kIODirectionOut)) != kIOReturnSuccess) {
-        XYLog("Failed to prepare bulk write memory buffer (error %d).\n", ret);
+        IBTTrace(&mTrace, IBT_TRACE_ERROR, "Failed to prepare bulk write memory buffer (error 0x%llx)\n", (uint32_t)ret);
         buffer->release();
         return ret;
     }
-    if ((ret = m_pBulkWritePipe->io(buffer, (uint32_t)buffer->getLength(), actLen, timeout)) != kIOReturnSuccess) {
-        XYLog("Failed to write to bulk pipe (error %d)\n", ret);
+    mSnoop.record(IBT_SNOOP_COMMAND, data, length);
+    ret = m_pBulkWritePipe->io(buffer, (uint32_t)buffer->getLength(), actLen, timeout);
+    usbStatsComplete(&mStats[kUSBEndpointBulkOut], start, actLen, ret);
+    if (ret != kIOReturnSuccess) {
+        IBTTrace(&mTrace, IBT_TRACE_ERROR, "Failed to write to bulk pipe (error 0x%llx)\n", (uint32_t)ret);
         buffer->complete();
         buffer->release();
         return ret;
     }
     if ((ret = buffer->complete(kIODirectionOut)) != kIOReturnSuccess) {
-        XYLog("Failed to complete bulk write memory buffer (error %d)\n", ret);
+        IBTTrace(&mTrace, IBT_TRACE_ERROR, "Failed to complete bulk write memory buffer (error 0x%llx)\n", (uint32_t)ret);
         buffer->release();
         return ret;
     }
+    buffer->release();
     return ret;
 }
 
@@ -328,3 +381,57 @@ stringFromReturn(IOReturn code)
 {
     return m_pDevice->stringFromReturn(code);
 }
+
+static const char *endpointNames[kUSBEndpointCount] = {
+    "control",
+    "bulk_out",
+    "bulk_in",
+    "interrupt_in",
+};
+
+static void
+setStatsNumber(OSDictionary *dict, const char *key, SInt64 value)
+{
+    OSNumber *num = OSNumber::withNumber((unsigned long long)value, 64);
+    if (num) {
+        dict->setObject(key, num);
+        num->release();
+    }
+}
+
+OSDictionary *USBDeviceController::
+copyStats()
+{
+    OSDictionary *stats = OSDictionary::withCapacity(kUSBEndpointCount);
+    if (!stats)
+        return NULL;
+    for (int i = 0; i < kUSBEndpointCount; i++) {
+        USBEndpointStats *ep = &mStats[i];
+        OSDictionary *dict = OSDictionary::withCapacity(7);
+        OSArray *latency = OSArray::withCapacity(USB_LATENCY_BUCKETS);
+        if (!dict || !latency) {
+            OSSafeReleaseNULL(dict);
+            OSSafeReleaseNULL(latency);
+            break;
+        }
+        setStatsNumber(dict, "transfers", ep->transfers);
+        setStatsNumber(dict, "bytes", ep->bytes);
+        setStatsNumber(dict, "errors", ep->errors);
+        setStatsNumber(dict, "timeouts", ep->timeouts);
+        setStatsNumber(dict, "stalls_cleared", ep->stallsCleared);
+        setStatsNumber(dict, "aborts", ep->aborts);
+        /* Index i is the number of transfers that took [2^i, 2^(i+1)) us */
+        for (int b = 0; b < USB_LATENCY_BUCKETS; b++) {
+            OSNumber *num = OSNumber::withNumber((unsigned long long)ep->latency[b], 64);
+            if (num) {
+                latency->setObject(num);
+                num->release();
+            }
+        }
+        dict->setObject("latency_log2_us", latency);
+        latency->release();
+        stats->setObject(endpointNames[i], dict);
+        dict->release();
+    }
+    return stats;
+}
@@ -18,13 +18,18 @@
 #include <IOKit/usb/IOUSBHostInterface.h>
 
 #include "Hci.h"
+#include "HCITransport.hpp"
+#include "USBEndpointStats.h"
+#include "BtIntelDeadline.h"
+#include "BtIntelTrace.h"
+#include "BtIntelSnoop.h"
 
 typedef struct {
     int status;
     uint32_t dataLen;
 } InterruptResp;
 
-class USBDeviceController : public OSObject {
+class USBDeviceController : public HCITransport {
     OSDeclareDefaultStructors(USBDeviceController)
     
 public:
@@ -39,15 +44,25 @@ public:
     
     virtual bool findPipes();
     
-    IOReturn bulkPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout);
+    IOReturn bulkPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout) override;
     
-    IOReturn interruptPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout);
+    IOReturn interruptPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout) override;
     
-    IOReturn sendHCIRequest(HciCommandHdr *cmd, uint32_t timeout);
+    IOReturn sendHCIRequest(HciCommandHdr *cmd, uint32_t timeout) override;
     
-    IOReturn bulkWrite(const void *data, uint32_t length, uint32_t timeout);
+    IOReturn bulkWrite(const void *data, uint32_t length, uint32_t timeout) override;
     
-    const char* stringFromReturn(IOReturn code);
+    const char* stringFromReturn(IOReturn code) override;
+    
+    OSDictionary *copyStats() override;
+    
+    void setDeadline(IntelDeadline *deadline) override { m_pDeadline = deadline; }
+    
+    IntelTraceRing *getTrace() override { return &mTrace; }
+    
+    void setSnapLen(uint32_t len) override { mSnoop.setSnapLen(len); }
+    
+    OSData *copySnoop() override { return mSnoop.copyBtsnoop(); }
     
     static void interruptHandler(void *owner, void *parameter, IOReturn status, uint32_t bytesTransferred);
     
@@ -62,6 +77,16 @@ private:
     
     IOLock *_hciLock;
     IOBufferMemoryDescriptor* mReadBuffer;
+    
+    USBEndpointStats mStats[kUSBEndpointCount];
+    
+    IntelDeadline *m_pDeadline;
+    
+    IntelTraceRing mTrace;
+    
+    IntelSnoopRing mSnoop;
+    
+    bool clampTimeout(uint32_t *timeout);
 };
 
 #endif /* USBDeviceController_hpp */
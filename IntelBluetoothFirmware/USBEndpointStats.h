@@ -0,0 +1,70 @@
+//
+//  USBEndpointStats.h
+//  IntelBluetoothFirmware
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef USBEndpointStats_h
+#define USBEndpointStats_h
+
+#include <libkern/OSAtomic.h>
+#include <kern/clock.h>
+
+/* Latency bucket i counts transfers that took [2^i, 2^(i+1)) us, the
+ * first one also takes anything below 1us and the last one anything
+ * above ~0.5s.
+ */
+#define USB_LATENCY_BUCKETS 20
+
+enum USBEndpoint {
+    kUSBEndpointControl,
+    kUSBEndpointBulkOut,
+    kUSBEndpointBulkIn,
+    kUSBEndpointInterruptIn,
+    kUSBEndpointCount,
+};
+
+/* Only ever updated with atomics, so they can be sampled at any time
+ * without _hciLock.
+ */
+struct USBEndpointStats {
+    volatile SInt64 transfers;
+    volatile SInt64 bytes;
+    volatile SInt64 errors;
+    volatile SInt64 timeouts;
+    volatile SInt64 stallsCleared;
+    volatile SInt64 aborts;
+    volatile SInt64 latency[USB_LATENCY_BUCKETS];
+};
+
+static inline int
+usbLatencyBucket(uint64_t us)
+{
+    int bucket = 0;
+
+    while (us > 1 && bucket < USB_LATENCY_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static inline void
+usbStatsComplete(USBEndpointStats *stats, uint64_t start, uint32_t bytes, IOReturn ret)
+{
+    uint64_t ns;
+
+    absolutetime_to_nanoseconds(mach_absolute_time() - start, &ns);
+    OSIncrementAtomic64(&stats->latency[usbLatencyBucket(ns / 1000)]);
+    OSIncrementAtomic64(&stats->transfers);
+    if (ret == kIOReturnSuccess)
+        OSAddAtomic64(bytes, &stats->bytes);
+    else if (ret == kIOReturnTimeout)
+        OSIncrementAtomic64(&stats->timeouts);
+    else
+        OSIncrementAtomic64(&stats->errors);
+}
+
+#endif /* USBEndpointStats_h */
@@ -0,0 +1,25 @@
+//
+//  Lilu.cpp
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <Headers/kern_api.hpp>
+
+LiluAPI lilu;
+
+bool KernelPatcher::
+routeMultiple(size_t id, RouteRequest *requests, size_t num, mach_vm_address_t start, size_t size,
+              bool kernelRoute, bool force)
+{
+    error = Error::MethodNotFound;
+    return false;
+}
+
+bool LiluAPI::
+onKextLoadForce(KernelPatcher::KextInfo *infos, size_t num, t_kextLoaded callback, void *user)
+{
+    return true;
+}
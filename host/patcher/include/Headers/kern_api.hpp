@@ -0,0 +1,28 @@
+//
+//  kern_api.hpp
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef kern_api_hpp
+#define kern_api_hpp
+
+#include <Headers/kern_patcher.hpp>
+
+/* No kext ever loads on the host, so the callbacks never run and a tool
+ * calls the plugin's methods itself.
+ */
+class LiluAPI {
+public:
+    typedef void (*t_kextLoaded)(void *user, KernelPatcher &patcher, size_t index, mach_vm_address_t address,
+                                 size_t size);
+    
+    bool onKextLoadForce(KernelPatcher::KextInfo *infos, size_t num = 1, t_kextLoaded callback = nullptr,
+                         void *user = nullptr);
+};
+
+extern LiluAPI lilu;
+
+#endif /* kern_api_hpp */
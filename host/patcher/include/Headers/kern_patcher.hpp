@@ -0,0 +1,56 @@
+//
+//  kern_patcher.hpp
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef kern_patcher_hpp
+#define kern_patcher_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint64_t mach_vm_address_t;
+
+/* Lilu's patcher as far as IntelBTPatcher declares its routes. There is
+ * no kernel to patch, every route fails and leaves the original unset.
+ */
+class KernelPatcher {
+public:
+    enum class Error {
+        NoError,
+        MethodNotFound,
+    };
+    
+    struct KextInfo {
+        static constexpr size_t Unloaded {SIZE_MAX};
+        const char *id;
+        const char **paths;
+        size_t pathNum;
+        bool sys[4];
+        size_t loadIndex;
+    };
+    
+    struct RouteRequest {
+        const char *symbol;
+        mach_vm_address_t to;
+        mach_vm_address_t *org;
+        
+        template <typename T>
+        RouteRequest(const char *s, T t, mach_vm_address_t &o) :
+            symbol(s), to(reinterpret_cast<mach_vm_address_t>(t)), org(&o) {}
+    };
+    
+    bool routeMultiple(size_t id, RouteRequest *requests, size_t num, mach_vm_address_t start = 0,
+                       size_t size = 0, bool kernelRoute = true, bool force = false);
+    
+    Error getError() { return error; }
+    void clearError() { error = Error::NoError; }
+    
+private:
+    Error error {Error::NoError};
+};
+
+#endif /* kern_patcher_hpp */
@@ -0,0 +1,35 @@
+//
+//  kern_util.hpp
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef kern_util_hpp
+#define kern_util_hpp
+
+#include <IOKit/IOLib.h>
+#include <Headers/kern_patcher.hpp>
+
+/* Both go to IOLog(), see IBTHostSetLog() */
+#define SYSLOG(module, str, ...) IOLog("%s: " str "\n", module, ##__VA_ARGS__)
+#if DEBUG
+#define DBGLOG(module, str, ...) IOLog("%s: " str "\n", module, ##__VA_ARGS__)
+#else
+#define DBGLOG(module, str, ...) do { } while (0)
+#endif
+
+template <typename T, size_t N>
+constexpr size_t arrsize(const T (&array)[N])
+{
+    return N;
+}
+
+template <typename T>
+static inline T FunctionCast(T org, mach_vm_address_t ptr)
+{
+    return reinterpret_cast<T>(ptr);
+}
+
+#endif /* kern_util_hpp */
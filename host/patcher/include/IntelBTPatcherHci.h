@@ -0,0 +1,30 @@
+//
+//  IntelBTPatcherHci.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef IntelBTPatcherHci_h
+#define IntelBTPatcherHci_h
+
+#include <stdint.h>
+
+/* The HCI headers IntelBTPatcher expects from its build environment,
+ * parameters included, unlike the kext's Hci.h. Included ahead of the
+ * plugin's sources, which do not include it themselves.
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t opcode;
+    uint8_t len;
+    uint8_t data[];
+} HciCommandHdr;
+
+typedef struct __attribute__((packed)) {
+    uint8_t evt;
+    uint8_t len;
+    uint8_t data[];
+} HciEventHdr;
+
+#endif /* IntelBTPatcherHci_h */
@@ -0,0 +1,292 @@
+//
+//  IOLib.cpp
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <IOKit/IOLib.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "IBTHost.h"
+
+static FILE *hostLog = stderr;
+static bool virtualClock;
+/* Added to the monotonic clock, or with the virtual clock on, the time
+ * itself.
+ */
+static volatile SInt64 clockOffset;
+static volatile SInt64 allocations;
+
+static uint64_t
+monotonicTime(void)
+{
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * kSecondScale + ts.tv_nsec;
+}
+
+void
+IBTHostSetLog(FILE *log)
+{
+    hostLog = log;
+}
+
+void
+IBTHostSetVirtualClock(bool enabled)
+{
+    if (enabled == virtualClock)
+        return;
+    /* The clock carries on from where the other one was */
+    if (enabled)
+        clockOffset += monotonicTime();
+    else
+        clockOffset -= monotonicTime();
+    virtualClock = enabled;
+}
+
+bool
+IBTHostVirtualClock(void)
+{
+    return virtualClock;
+}
+
+void
+IBTHostAdvanceClock(uint64_t ns)
+{
+    OSAddAtomic64((SInt64)ns, &clockOffset);
+}
+
+uint64_t
+IBTHostAllocations(void)
+{
+    return (uint64_t)allocations;
+}
+
+void
+IOLogv(const char *format, va_list ap)
+{
+    if (hostLog)
+        vfprintf(hostLog, format, ap);
+}
+
+void
+IOLog(const char *format, ...)
+{
+    va_list ap;
+    
+    va_start(ap, format);
+    IOLogv(format, ap);
+    va_end(ap);
+}
+
+void *
+IOMalloc(size_t size)
+{
+    OSIncrementAtomic64(&allocations);
+    return malloc(size);
+}
+
+void *
+IOMallocZero(size_t size)
+{
+    OSIncrementAtomic64(&allocations);
+    return calloc(1, size);
+}
+
+void
+IOFree(void *address, size_t size)
+{
+    free(address);
+}
+
+void
+IOSleep(unsigned milliseconds)
+{
+    IODelay(milliseconds * 1000);
+}
+
+void
+IODelay(unsigned microseconds)
+{
+    struct timespec ts;
+    
+    if (virtualClock) {
+        IBTHostAdvanceClock((uint64_t)microseconds * kMicrosecondScale);
+        return;
+    }
+    ts.tv_sec = microseconds / 1000000;
+    ts.tv_nsec = (microseconds % 1000000) * 1000L;
+    while (nanosleep(&ts, &ts) && errno == EINTR)
+        ;
+}
+
+uint64_t
+mach_absolute_time(void)
+{
+    if (virtualClock)
+        return (uint64_t)clockOffset;
+    return monotonicTime() + (uint64_t)clockOffset;
+}
+
+void
+clock_get_uptime(uint64_t *result)
+{
+    *result = mach_absolute_time();
+}
+
+void
+absolutetime_to_nanoseconds(uint64_t abstime, uint64_t *result)
+{
+    *result = abstime;
+}
+
+void
+nanoseconds_to_absolutetime(uint64_t nanoseconds, uint64_t *result)
+{
+    *result = nanoseconds;
+}
+
+void
+clock_interval_to_absolutetime_interval(uint32_t interval, uint32_t scale_factor, uint64_t *result)
+{
+    *result = (uint64_t)interval * scale_factor;
+}
+
+void
+clock_interval_to_deadline(uint32_t interval, uint32_t scale_factor, uint64_t *result)
+{
+    *result = mach_absolute_time() + (uint64_t)interval * scale_factor;
+}
+
+void
+clock_get_calendar_microtime(clock_sec_t *secs, clock_usec_t *microsecs)
+{
+    struct timeval tv;
+    
+    gettimeofday(&tv, NULL);
+    *secs = tv.tv_sec;
+    *microsecs = (clock_usec_t)tv.tv_usec;
+}
+
+struct IOLock {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+};
+
+IOLock *
+IOLockAlloc(void)
+{
+    IOLock *lock = (IOLock *)IOMalloc(sizeof(IOLock));
+    pthread_condattr_t attr;
+    
+    if (!lock)
+        return NULL;
+    pthread_mutex_init(&lock->mutex, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&lock->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    return lock;
+}
+
+void
+IOLockFree(IOLock *lock)
+{
+    pthread_cond_destroy(&lock->cond);
+    pthread_mutex_destroy(&lock->mutex);
+    IOFree(lock, sizeof(IOLock));
+}
+
+void
+IOLockLock(IOLock *lock)
+{
+    pthread_mutex_lock(&lock->mutex);
+}
+
+void
+IOLockUnlock(IOLock *lock)
+{
+    pthread_mutex_unlock(&lock->mutex);
+}
+
+bool
+IOLockTryLock(IOLock *lock)
+{
+    return pthread_mutex_trylock(&lock->mutex) == 0;
+}
+
+int
+IOLockSleep(IOLock *lock, void *event, uint32_t interType)
+{
+    uint64_t start = monotonicTime();
+    
+    pthread_cond_wait(&lock->cond, &lock->mutex);
+    if (virtualClock)
+        IBTHostAdvanceClock(monotonicTime() - start);
+    return THREAD_AWAKENED;
+}
+
+/* The deadline is on the shifted clock, the wait on the monotonic one.
+ * Other threads run in real time, so a virtual clock moves on by as
+ * long as the wait really took.
+ */
+int
+IOLockSleepDeadline(IOLock *lock, void *event, AbsoluteTime deadline, uint32_t interType)
+{
+    uint64_t start = monotonicTime(), now = mach_absolute_time();
+    uint64_t wake = start + (deadline > now ? deadline - now : 0);
+    struct timespec ts;
+    int ret = THREAD_AWAKENED;
+    
+    ts.tv_sec = wake / kSecondScale;
+    ts.tv_nsec = wake % kSecondScale;
+    if (pthread_cond_timedwait(&lock->cond, &lock->mutex, &ts) == ETIMEDOUT)
+        ret = THREAD_TIMED_OUT;
+    if (virtualClock)
+        IBTHostAdvanceClock(monotonicTime() - start);
+    return ret;
+}
+
+void
+IOLockWakeup(IOLock *lock, void *event, bool oneThread)
+{
+    pthread_cond_broadcast(&lock->cond);
+}
+
+struct IOSimpleLock {
+    pthread_mutex_t mutex;
+};
+
+IOSimpleLock *
+IOSimpleLockAlloc(void)
+{
+    IOSimpleLock *lock = (IOSimpleLock *)IOMalloc(sizeof(IOSimpleLock));
+    
+    if (lock)
+        pthread_mutex_init(&lock->mutex, NULL);
+    return lock;
+}
+
+void
+IOSimpleLockFree(IOSimpleLock *lock)
+{
+    pthread_mutex_destroy(&lock->mutex);
+    IOFree(lock, sizeof(IOSimpleLock));
+}
+
+void
+IOSimpleLockLock(IOSimpleLock *lock)
+{
+    pthread_mutex_lock(&lock->mutex);
+}
+
+void
+IOSimpleLockUnlock(IOSimpleLock *lock)
+{
+    pthread_mutex_unlock(&lock->mutex);
+}
@@ -0,0 +1,184 @@
+//
+//  IOService.cpp
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <IOKit/IOLib.h>
+#include <IOKit/IOService.h>
+#include <IOKit/IOBufferMemoryDescriptor.h>
+#include <IOKit/usb/IOUSBHostDevice.h>
+#include <IOKit/usb/IOUSBHostInterface.h>
+
+/* IORegistryEntry and IOService */
+
+OSDefineMetaClassAndStructors(IORegistryEntry, OSObject)
+
+bool IORegistryEntry::
+init()
+{
+    if (!OSObject::init())
+        return false;
+    properties = OSDictionary::withCapacity(4);
+    propertyLock = IOLockAlloc();
+    return properties && propertyLock;
+}
+
+void IORegistryEntry::
+free()
+{
+    OSSafeReleaseNULL(properties);
+    if (propertyLock)
+        IOLockFree(propertyLock);
+    OSObject::free();
+}
+
+bool IORegistryEntry::
+setProperty(const char *aKey, OSObject *anObject)
+{
+    bool ret;
+    
+    IOLockLock(propertyLock);
+    ret = properties->setObject(aKey, anObject);
+    IOLockUnlock(propertyLock);
+    return ret;
+}
+
+OSObject *IORegistryEntry::
+copyProperty(const char *aKey) const
+{
+    OSObject *object;
+    
+    IOLockLock(propertyLock);
+    object = properties->getObject(aKey);
+    if (object)
+        object->retain();
+    IOLockUnlock(propertyLock);
+    return object;
+}
+
+void IORegistryEntry::
+removeProperty(const char *aKey)
+{
+    IOLockLock(propertyLock);
+    properties->removeObject(aKey);
+    IOLockUnlock(propertyLock);
+}
+
+OSDefineMetaClassAndStructors(IOService, IORegistryEntry)
+
+/* IOMemoryDescriptor and IOBufferMemoryDescriptor */
+
+OSDefineMetaClassAndStructors(IOMemoryDescriptor, OSObject)
+
+IOMemoryDescriptor *IOMemoryDescriptor::
+withAddress(void *address, IOByteCount withLength, IODirection withDirection)
+{
+    IOMemoryDescriptor *me = new IOMemoryDescriptor;
+    
+    if (!me->initWithAddress(address, withLength, withDirection)) {
+        me->release();
+        return NULL;
+    }
+    return me;
+}
+
+bool IOMemoryDescriptor::
+initWithAddress(void *address, IOByteCount withLength, IODirection withDirection)
+{
+    if (!OSObject::init() || (!address && withLength))
+        return false;
+    this->address = address;
+    length = withLength;
+    direction = withDirection;
+    return true;
+}
+
+IOByteCount IOMemoryDescriptor::
+readBytes(IOByteCount offset, void *bytes, IOByteCount withLength)
+{
+    if (offset >= length)
+        return 0;
+    if (withLength > length - offset)
+        withLength = length - offset;
+    memcpy(bytes, (const uint8_t *)address + offset, withLength);
+    return withLength;
+}
+
+IOByteCount IOMemoryDescriptor::
+writeBytes(IOByteCount offset, const void *bytes, IOByteCount withLength)
+{
+    if (offset >= length)
+        return 0;
+    if (withLength > length - offset)
+        withLength = length - offset;
+    memcpy((uint8_t *)address + offset, bytes, withLength);
+    return withLength;
+}
+
+OSDefineMetaClassAndStructors(IOBufferMemoryDescriptor, IOMemoryDescriptor)
+
+IOBufferMemoryDescriptor *IOBufferMemoryDescriptor::
+withBytes(const void *bytes, IOByteCount withLength, IODirection withDirection)
+{
+    IOBufferMemoryDescriptor *me = new IOBufferMemoryDescriptor;
+    void *buffer = withLength ? IOMalloc(withLength) : NULL;
+    
+    if (withLength && !buffer) {
+        me->release();
+        return NULL;
+    }
+    if (buffer)
+        memcpy(buffer, bytes, withLength);
+    if (!me->initWithAddress(buffer, withLength, withDirection)) {
+        if (buffer)
+            IOFree(buffer, withLength);
+        me->release();
+        return NULL;
+    }
+    return me;
+}
+
+void IOBufferMemoryDescriptor::
+free()
+{
+    if (address)
+        IOFree(address, length);
+    IOMemoryDescriptor::free();
+}
+
+/* IOUSBHostDevice */
+
+OSDefineMetaClassAndStructors(IOUSBHostDevice, IOService)
+
+IOUSBHostDevice *IOUSBHostDevice::
+withDescriptor(const StandardUSB::DeviceDescriptor *descriptor)
+{
+    IOUSBHostDevice *me = new IOUSBHostDevice;
+    
+    if (!me->init()) {
+        me->release();
+        return NULL;
+    }
+    me->deviceDescriptor = *descriptor;
+    return me;
+}
+
+/* IOUSBHostInterface */
+
+OSDefineMetaClassAndStructors(IOUSBHostInterface, IOService)
+
+IOUSBHostInterface *IOUSBHostInterface::
+withDescriptor(const StandardUSB::InterfaceDescriptor *descriptor)
+{
+    IOUSBHostInterface *me = new IOUSBHostInterface;
+    
+    if (!me->init()) {
+        me->release();
+        return NULL;
+    }
+    me->interfaceDescriptor = *descriptor;
+    return me;
+}
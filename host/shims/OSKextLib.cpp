@@ -0,0 +1,179 @@
+//
+//  OSKextLib.cpp
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <IOKit/IOLib.h>
+#include <libkern/OSKextLib.h>
+#include <pthread.h>
+
+#include "IBTHost.h"
+
+/* Stands in for the kext daemon: resources are files of one directory,
+ * read on a thread of their own and handed to the callback after the
+ * configured delay, so the requester sees the same asynchronous answer
+ * as in the kernel. Without a directory every request fails, as it does
+ * before userspace is up.
+ */
+#define RESOURCE_REQUESTS   16
+
+struct ResourceRequest {
+    OSKextRequestTag tag;
+    char path[1024];
+    OSKextRequestResourceCallback callback;
+    void *context;
+};
+
+static pthread_mutex_t resourceMutex = PTHREAD_MUTEX_INITIALIZER;
+static ResourceRequest *resourceRequests[RESOURCE_REQUESTS];
+static OSKextRequestTag resourceTag;
+static char resourceDir[1024];
+static uint32_t resourceDelay;
+
+void
+IBTHostSetResourceDir(const char *dir, uint32_t delayMs)
+{
+    pthread_mutex_lock(&resourceMutex);
+    snprintf(resourceDir, sizeof(resourceDir), "%s", dir ? dir : "");
+    resourceDelay = delayMs;
+    pthread_mutex_unlock(&resourceMutex);
+}
+
+static void *
+readFile(const char *path, uint32_t *length)
+{
+    FILE *file = fopen(path, "rb");
+    void *data = NULL;
+    long size;
+    
+    *length = 0;
+    if (!file)
+        return NULL;
+    if (!fseek(file, 0, SEEK_END) && (size = ftell(file)) > 0 && size <= UINT32_MAX &&
+        !fseek(file, 0, SEEK_SET) && (data = IOMalloc(size))) {
+        if (fread(data, 1, size, file) == (size_t)size) {
+            *length = (uint32_t)size;
+        } else {
+            IOFree(data, size);
+            data = NULL;
+        }
+    }
+    fclose(file);
+    return data;
+}
+
+/* Called with resourceMutex held */
+static ResourceRequest *
+takeRequest(OSKextRequestTag tag)
+{
+    ResourceRequest *request;
+    
+    for (int i = 0; i < RESOURCE_REQUESTS; i++) {
+        request = resourceRequests[i];
+        if (request && request->tag == tag) {
+            resourceRequests[i] = NULL;
+            return request;
+        }
+    }
+    return NULL;
+}
+
+static void *
+serveRequest(void *arg)
+{
+    ResourceRequest *request = (ResourceRequest *)arg;
+    uint32_t length;
+    void *data;
+    
+    if (resourceDelay) {
+        struct timespec ts = { (time_t)(resourceDelay / 1000), (long)(resourceDelay % 1000) * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+    data = readFile(request->path, &length);
+    pthread_mutex_lock(&resourceMutex);
+    /* Cancelled in the meantime, the request is ours to free */
+    if (takeRequest(request->tag) != request) {
+        pthread_mutex_unlock(&resourceMutex);
+        if (data)
+            IOFree(data, length);
+        IOFree(request, sizeof(*request));
+        return NULL;
+    }
+    pthread_mutex_unlock(&resourceMutex);
+    
+    request->callback(request->tag, data ? kOSReturnSuccess : kOSKextReturnNotFound,
+                      data, length, request->context);
+    if (data)
+        IOFree(data, length);
+    IOFree(request, sizeof(*request));
+    return NULL;
+}
+
+OSReturn
+OSKextRequestResource(const char *kextIdentifier, const char *resourceName,
+                      OSKextRequestResourceCallback callback, void *context,
+                      OSKextRequestTag *requestTagOut)
+{
+    ResourceRequest *request;
+    pthread_t thread;
+    int slot = -1;
+    
+    if (!resourceName || !callback || strchr(resourceName, '/'))
+        return kOSKextReturnInvalidArgument;
+    request = (ResourceRequest *)IOMallocZero(sizeof(*request));
+    if (!request)
+        return kOSReturnError;
+    
+    pthread_mutex_lock(&resourceMutex);
+    for (int i = 0; i < RESOURCE_REQUESTS && slot < 0; i++) {
+        if (!resourceRequests[i])
+            slot = i;
+    }
+    if (!resourceDir[0] || slot < 0) {
+        pthread_mutex_unlock(&resourceMutex);
+        IOFree(request, sizeof(*request));
+        return kOSKextReturnNotFound;
+    }
+    snprintf(request->path, sizeof(request->path), "%s/%s", resourceDir, resourceName);
+    request->tag = ++resourceTag;
+    request->callback = callback;
+    request->context = context;
+    resourceRequests[slot] = request;
+    if (requestTagOut)
+        *requestTagOut = request->tag;
+    if (pthread_create(&thread, NULL, serveRequest, request)) {
+        resourceRequests[slot] = NULL;
+        pthread_mutex_unlock(&resourceMutex);
+        IOFree(request, sizeof(*request));
+        return kOSReturnError;
+    }
+    pthread_detach(thread);
+    pthread_mutex_unlock(&resourceMutex);
+    return kOSReturnSuccess;
+}
+
+/* Succeeds only while the callback has not started, like the kernel's */
+OSReturn
+OSKextCancelRequest(OSKextRequestTag requestTag, void **contextOut)
+{
+    ResourceRequest *request;
+    
+    pthread_mutex_lock(&resourceMutex);
+    request = takeRequest(requestTag);
+    pthread_mutex_unlock(&resourceMutex);
+    if (!request)
+        return kOSKextReturnNotFound;
+    if (contextOut)
+        *contextOut = request->context;
+    /* The serving thread finds it gone and frees it */
+    return kOSReturnSuccess;
+}
+
+const char *
+OSKextGetCurrentIdentifier(void)
+{
+    return "com.zxystd.IntelBluetoothFirmware";
+}
@@ -0,0 +1,571 @@
+//
+//  OSObject.cpp
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <IOKit/IOLib.h>
+#include <libkern/c++/OSObject.h>
+#include <libkern/c++/OSData.h>
+#include <libkern/c++/OSString.h>
+#include <libkern/c++/OSSymbol.h>
+#include <libkern/c++/OSNumber.h>
+#include <libkern/c++/OSBoolean.h>
+#include <libkern/c++/OSArray.h>
+#include <libkern/c++/OSDictionary.h>
+
+void *OSObject::
+operator new(size_t size)
+{
+    void *mem = IOMallocZero(size);
+    
+    if (!mem)
+        abort();
+    return mem;
+}
+
+void OSObject::
+operator delete(void *mem, size_t size)
+{
+    IOFree(mem, size);
+}
+
+OSObject::
+OSObject() : retainCount(1)
+{
+}
+
+OSObject::
+~OSObject()
+{
+}
+
+bool OSObject::
+init()
+{
+    return true;
+}
+
+void OSObject::
+free()
+{
+    delete this;
+}
+
+void OSObject::
+retain() const
+{
+    OSIncrementAtomic(&retainCount);
+}
+
+void OSObject::
+release() const
+{
+    if (OSDecrementAtomic(&retainCount) == 1)
+        const_cast<OSObject *>(this)->free();
+}
+
+int OSObject::
+getRetainCount() const
+{
+    return retainCount;
+}
+
+bool OSObject::
+isEqualTo(const OSObject *anObject) const
+{
+    return this == anObject;
+}
+
+/* OSData */
+
+OSDefineMetaClassAndStructors(OSData, OSObject)
+
+OSData *OSData::
+withCapacity(unsigned int capacity)
+{
+    OSData *me = new OSData;
+    
+    if (!me->initWithCapacity(capacity))
+        OSSafeReleaseNULL(me);
+    return me;
+}
+
+OSData *OSData::
+withBytes(const void *bytes, unsigned int numBytes)
+{
+    OSData *me = new OSData;
+    
+    if (!me->initWithBytes(bytes, numBytes))
+        OSSafeReleaseNULL(me);
+    return me;
+}
+
+OSData *OSData::
+withBytesNoCopy(void *bytes, unsigned int numBytes)
+{
+    OSData *me = new OSData;
+    
+    if (!me->initWithBytesNoCopy(bytes, numBytes))
+        OSSafeReleaseNULL(me);
+    return me;
+}
+
+OSData *OSData::
+withData(const OSData *other)
+{
+    return withBytes(other->getBytesNoCopy(), other->getLength());
+}
+
+bool OSData::
+initWithCapacity(unsigned int newCapacity)
+{
+    if (!OSObject::init())
+        return false;
+    owned = true;
+    return ensureCapacity(newCapacity);
+}
+
+bool OSData::
+initWithBytes(const void *bytes, unsigned int numBytes)
+{
+    return initWithCapacity(numBytes) && appendBytes(bytes, numBytes);
+}
+
+bool OSData::
+initWithBytesNoCopy(void *bytes, unsigned int numBytes)
+{
+    if (!OSObject::init())
+        return false;
+    data = (unsigned char *)bytes;
+    length = capacity = numBytes;
+    owned = false;
+    return true;
+}
+
+void OSData::
+free()
+{
+    if (owned)
+        IOFree(data, capacity);
+    OSObject::free();
+}
+
+bool OSData::
+ensureCapacity(unsigned int newCapacity)
+{
+    unsigned char *grown;
+    
+    if (newCapacity <= capacity)
+        return true;
+    if (!owned)
+        return false;
+    grown = (unsigned char *)realloc(data, newCapacity);
+    if (!grown)
+        return false;
+    data = grown;
+    capacity = newCapacity;
+    return true;
+}
+
+const void *OSData::
+getBytesNoCopy(unsigned int start, unsigned int numBytes) const
+{
+    if (start >= length || numBytes > length - start)
+        return NULL;
+    return data + start;
+}
+
+bool OSData::
+appendBytes(const void *bytes, unsigned int numBytes)
+{
+    if (!numBytes)
+        return true;
+    if (numBytes > UINT32_MAX - length)
+        return false;
+    if (length + numBytes > capacity &&
+        !ensureCapacity(max(length + numBytes, capacity * 2)))
+        return false;
+    if (bytes)
+        memcpy(data + length, bytes, numBytes);
+    else
+        memset(data + length, 0, numBytes);
+    length += numBytes;
+    return true;
+}
+
+bool OSData::
+appendBytes(const OSData *other)
+{
+    return appendBytes(other->getBytesNoCopy(), other->getLength());
+}
+
+bool OSData::
+appendByte(unsigned char byte, unsigned int numBytes)
+{
+    unsigned int start = length;
+    
+    if (!appendBytes(NULL, numBytes))
+        return false;
+    memset(data + start, byte, numBytes);
+    return true;
+}
+
+bool OSData::
+isEqualTo(const void *bytes, unsigned int numBytes) const
+{
+    return numBytes == length && (!length || !memcmp(data, bytes, length));
+}
+
+bool OSData::
+isEqualTo(const OSObject *anObject) const
+{
+    const OSData *other = OSDynamicCast(OSData, anObject);
+    
+    return other && isEqualTo(other->getBytesNoCopy(), other->getLength());
+}
+
+/* OSString and OSSymbol */
+
+OSDefineMetaClassAndStructors(OSString, OSObject)
+
+OSString *OSString::
+withCString(const char *cString)
+{
+    OSString *me = new OSString;
+    
+    if (!me->initWithCString(cString))
+        OSSafeReleaseNULL(me);
+    return me;
+}
+
+bool OSString::
+initWithCString(const char *cString)
+{
+    if (!cString || !OSObject::init())
+        return false;
+    length = (unsigned int)strlen(cString) + 1;
+    string = (char *)IOMalloc(length);
+    if (!string)
+        return false;
+    memcpy(string, cString, length);
+    return true;
+}
+
+void OSString::
+free()
+{
+    if (string)
+        IOFree(string, length);
+    OSObject::free();
+}
+
+bool OSString::
+isEqualTo(const char *cString) const
+{
+    return cString && !strcmp(string, cString);
+}
+
+bool OSString::
+isEqualTo(const OSObject *anObject) const
+{
+    const OSString *other = OSDynamicCast(OSString, anObject);
+    
+    return other && isEqualTo(other->getCStringNoCopy());
+}
+
+OSDefineMetaClassAndStructors(OSSymbol, OSString)
+
+const OSSymbol *OSSymbol::
+withCString(const char *cString)
+{
+    OSSymbol *me = new OSSymbol;
+    
+    if (!me->initWithCString(cString))
+        OSSafeReleaseNULL(me);
+    return me;
+}
+
+/* OSNumber and OSBoolean */
+
+OSDefineMetaClassAndStructors(OSNumber, OSObject)
+
+OSNumber *OSNumber::
+withNumber(unsigned long long value, unsigned int numberOfBits)
+{
+    OSNumber *me = new OSNumber;
+    
+    if (!me->init(value, numberOfBits))
+        OSSafeReleaseNULL(me);
+    return me;
+}
+
+bool OSNumber::
+init(unsigned long long newValue, unsigned int numberOfBits)
+{
+    if (!OSObject::init() || !numberOfBits || numberOfBits > 64)
+        return false;
+    size = numberOfBits;
+    value = numberOfBits < 64 ? newValue & ((1ULL << numberOfBits) - 1) : newValue;
+    return true;
+}
+
+bool OSNumber::
+isEqualTo(const OSObject *anObject) const
+{
+    const OSNumber *other = OSDynamicCast(OSNumber, anObject);
+    
+    return other && other->value == value;
+}
+
+OSDefineMetaClassAndStructors(OSBoolean, OSObject)
+
+bool OSBoolean::
+init(bool newValue)
+{
+    value = newValue;
+    return OSObject::init();
+}
+
+static OSBoolean *
+booleanInstance(bool value)
+{
+    OSBoolean *me = new OSBoolean;
+    
+    me->init(value);
+    return me;
+}
+
+OSBoolean *kOSBooleanTrue = booleanInstance(true);
+OSBoolean *kOSBooleanFalse = booleanInstance(false);
+
+OSBoolean *OSBoolean::
+withBoolean(bool value)
+{
+    return value ? kOSBooleanTrue : kOSBooleanFalse;
+}
+
+/* OSArray */
+
+OSDefineMetaClassAndAbstractStructors(OSCollection, OSObject)
+
+OSDefineMetaClassAndStructors(OSArray, OSCollection)
+
+OSArray *OSArray::
+withCapacity(unsigned int capacity)
+{
+    OSArray *me = new OSArray;
+    
+    if (!me->initWithCapacity(capacity))
+        OSSafeReleaseNULL(me);
+    return me;
+}
+
+bool OSArray::
+initWithCapacity(unsigned int newCapacity)
+{
+    return OSObject::init() && ensureCapacity(newCapacity) >= newCapacity;
+}
+
+void OSArray::
+free()
+{
+    flushCollection();
+    IOFree(array, capacity * sizeof(*array));
+    OSObject::free();
+}
+
+unsigned int OSArray::
+ensureCapacity(unsigned int newCapacity)
+{
+    const OSObject **grown;
+    
+    if (newCapacity <= capacity)
+        return capacity;
+    grown = (const OSObject **)realloc(array, newCapacity * sizeof(*array));
+    if (!grown)
+        return capacity;
+    array = grown;
+    capacity = newCapacity;
+    return capacity;
+}
+
+void OSArray::
+flushCollection()
+{
+    for (unsigned int i = 0; i < count; i++)
+        array[i]->release();
+    count = 0;
+}
+
+bool OSArray::
+setObject(const OSObject *anObject)
+{
+    return setObject(count, anObject);
+}
+
+bool OSArray::
+setObject(unsigned int index, const OSObject *anObject)
+{
+    if (!anObject || index > count)
+        return false;
+    if (count == capacity && ensureCapacity(max(capacity * 2, 4)) == count)
+        return false;
+    memmove(&array[index + 1], &array[index], (count - index) * sizeof(*array));
+    array[index] = anObject;
+    anObject->retain();
+    count++;
+    return true;
+}
+
+OSObject *OSArray::
+getObject(unsigned int index) const
+{
+    return index < count ? const_cast<OSObject *>(array[index]) : NULL;
+}
+
+OSObject *OSArray::
+getLastObject() const
+{
+    return count ? getObject(count - 1) : NULL;
+}
+
+void OSArray::
+removeObject(unsigned int index)
+{
+    if (index >= count)
+        return;
+    array[index]->release();
+    count--;
+    memmove(&array[index], &array[index + 1], (count - index) * sizeof(*array));
+}
+
+/* OSDictionary */
+
+OSDefineMetaClassAndStructors(OSDictionary, OSCollection)
+
+OSDictionary *OSDictionary::
+withCapacity(unsigned int capacity)
+{
+    OSDictionary *me = new OSDictionary;
+    
+    if (!me->initWithCapacity(capacity))
+        OSSafeReleaseNULL(me);
+    return me;
+}
+
+bool OSDictionary::
+initWithCapacity(unsigned int newCapacity)
+{
+    return OSObject::init() && ensureCapacity(newCapacity) >= newCapacity;
+}
+
+void OSDictionary::
+free()
+{
+    flushCollection();
+    IOFree(entries, capacity * sizeof(*entries));
+    OSObject::free();
+}
+
+unsigned int OSDictionary::
+ensureCapacity(unsigned int newCapacity)
+{
+    Entry *grown;
+    
+    if (newCapacity <= capacity)
+        return capacity;
+    grown = (Entry *)realloc(entries, newCapacity * sizeof(*entries));
+    if (!grown)
+        return capacity;
+    entries = grown;
+    capacity = newCapacity;
+    return capacity;
+}
+
+void OSDictionary::
+flushCollection()
+{
+    for (unsigned int i = 0; i < count; i++) {
+        entries[i].key->release();
+        entries[i].value->release();
+    }
+    count = 0;
+}
+
+bool OSDictionary::
+setObject(const char *aKey, const OSObject *anObject)
+{
+    const OSSymbol *key;
+    
+    if (!aKey || !anObject)
+        return false;
+    for (unsigned int i = 0; i < count; i++) {
+        if (entries[i].key->isEqualTo(aKey)) {
+            anObject->retain();
+            entries[i].value->release();
+            entries[i].value = anObject;
+            return true;
+        }
+    }
+    if (count == capacity && ensureCapacity(max(capacity * 2, 4)) == count)
+        return false;
+    key = OSSymbol::withCString(aKey);
+    if (!key)
+        return false;
+    anObject->retain();
+    entries[count].key = key;
+    entries[count].value = anObject;
+    count++;
+    return true;
+}
+
+bool OSDictionary::
+setObject(const OSString *aKey, const OSObject *anObject)
+{
+    return aKey && setObject(aKey->getCStringNoCopy(), anObject);
+}
+
+OSObject *OSDictionary::
+getObject(const char *aKey) const
+{
+    for (unsigned int i = 0; i < count; i++) {
+        if (entries[i].key->isEqualTo(aKey))
+            return const_cast<OSObject *>(entries[i].value);
+    }
+    return NULL;
+}
+
+OSObject *OSDictionary::
+getObject(const OSString *aKey) const
+{
+    return aKey ? getObject(aKey->getCStringNoCopy()) : NULL;
+}
+
+void OSDictionary::
+removeObject(const char *aKey)
+{
+    for (unsigned int i = 0; i < count; i++) {
+        if (entries[i].key->isEqualTo(aKey)) {
+            entries[i].key->release();
+            entries[i].value->release();
+            count--;
+            memmove(&entries[i], &entries[i + 1], (count - i) * sizeof(*entries));
+            return;
+        }
+    }
+}
+
+const OSSymbol *OSDictionary::
+getKey(unsigned int index) const
+{
+    return index < count ? entries[index].key : NULL;
+}
+
+OSObject *OSDictionary::
+getValue(unsigned int index) const
+{
+    return index < count ? const_cast<OSObject *>(entries[index].value) : NULL;
+}
@@ -0,0 +1,45 @@
+//
+//  IBTHost.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef IBTHost_h
+#define IBTHost_h
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Knobs of the host shims that the kernel has no equivalent for. */
+
+/* Where IOLog goes, NULL drops it. stderr by default. */
+void IBTHostSetLog(FILE *log);
+
+/* With the virtual clock on, mach_absolute_time() only moves when
+ * IOSleep() or IBTHostAdvanceClock() advance it, or by the real time a
+ * thread spent waiting on an IOLock. Host CPU time does not count, so a
+ * simulated bring-up times the same on every run and seconds of latency
+ * take no time to model.
+ */
+void IBTHostSetVirtualClock(bool enabled);
+
+bool IBTHostVirtualClock(void);
+
+void IBTHostAdvanceClock(uint64_t ns);
+
+/* IOMalloc() and IOMallocZero() calls so far, the objects included */
+uint64_t IBTHostAllocations(void);
+
+/* Runs the thread calls entered so far, and those they enter, on the
+ * calling thread. Returns how many ran.
+ */
+unsigned int IBTHostRunThreadCalls(void);
+
+/* OSKextRequestResource() serves the files of dir, each answer delayMs
+ * after the request. NULL fails every request, the default.
+ */
+void IBTHostSetResourceDir(const char *dir, uint32_t delayMs);
+
+#endif /* IBTHost_h */
@@ -0,0 +1,26 @@
+//
+//  IOBufferMemoryDescriptor.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _IOBUFFERMEMORYDESCRIPTOR_H
+#define _IOBUFFERMEMORYDESCRIPTOR_H
+
+#include <IOKit/IOMemoryDescriptor.h>
+
+/* A descriptor that owns its memory */
+class IOBufferMemoryDescriptor : public IOMemoryDescriptor {
+    OSDeclareDefaultStructors(IOBufferMemoryDescriptor)
+    
+public:
+    static IOBufferMemoryDescriptor *withBytes(const void *bytes, IOByteCount withLength, IODirection withDirection);
+    
+    virtual void free() override;
+    
+    void *getBytesNoCopy() { return address; }
+};
+
+#endif /* _IOBUFFERMEMORYDESCRIPTOR_H */
@@ -0,0 +1,31 @@
+//
+//  IOLib.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef __IOKIT_IOLIB_H
+#define __IOKIT_IOLIB_H
+
+#include <stdarg.h>
+#include <IOKit/IOTypes.h>
+#include <IOKit/IOLocks.h>
+#include <kern/clock.h>
+#include <libkern/libkern.h>
+#include <libkern/OSAtomic.h>
+#include <libkern/OSByteOrder.h>
+
+void IOLog(const char *format, ...) __attribute__((format(printf, 1, 2)));
+void IOLogv(const char *format, va_list ap) __attribute__((format(printf, 1, 0)));
+
+void *IOMalloc(size_t size);
+void *IOMallocZero(size_t size);
+void IOFree(void *address, size_t size);
+
+/* Sleeps on the host clock, see IBTHost.h for the virtual one */
+void IOSleep(unsigned milliseconds);
+void IODelay(unsigned microseconds);
+
+#endif /* __IOKIT_IOLIB_H */
@@ -0,0 +1,46 @@
+//
+//  IOLocks.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef __IOKIT_IOLOCKS_H
+#define __IOKIT_IOLOCKS_H
+
+#include <IOKit/IOTypes.h>
+
+#define THREAD_UNINT            0
+#define THREAD_INTERRUPTIBLE    1
+
+#define THREAD_AWAKENED         0
+#define THREAD_TIMED_OUT        1
+#define THREAD_INTERRUPTED      2
+
+typedef int wait_result_t;
+
+/* A mutex with one condition variable. Events are not tracked, a
+ * wakeup wakes every sleeper of the lock and they recheck their
+ * condition, as all callers in the tree do.
+ */
+typedef struct IOLock IOLock;
+
+IOLock *IOLockAlloc(void);
+void IOLockFree(IOLock *lock);
+void IOLockLock(IOLock *lock);
+void IOLockUnlock(IOLock *lock);
+bool IOLockTryLock(IOLock *lock);
+int IOLockSleep(IOLock *lock, void *event, uint32_t interType);
+int IOLockSleepDeadline(IOLock *lock, void *event, AbsoluteTime deadline, uint32_t interType);
+void IOLockWakeup(IOLock *lock, void *event, bool oneThread);
+
+/* A plain mutex, the host does not spin */
+typedef struct IOSimpleLock IOSimpleLock;
+
+IOSimpleLock *IOSimpleLockAlloc(void);
+void IOSimpleLockFree(IOSimpleLock *lock);
+void IOSimpleLockLock(IOSimpleLock *lock);
+void IOSimpleLockUnlock(IOSimpleLock *lock);
+
+#endif /* __IOKIT_IOLOCKS_H */
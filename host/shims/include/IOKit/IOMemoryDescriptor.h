@@ -0,0 +1,46 @@
+//
+//  IOMemoryDescriptor.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _IOMEMORYDESCRIPTOR_H
+#define _IOMEMORYDESCRIPTOR_H
+
+#include <IOKit/IOTypes.h>
+#include <libkern/c++/OSObject.h>
+
+enum IODirection {
+    kIODirectionNone    = 0x0,
+    kIODirectionIn      = 0x1,
+    kIODirectionOut     = 0x2,
+    kIODirectionInOut   = kIODirectionIn | kIODirectionOut,
+};
+
+/* One virtually contiguous range of the caller's memory. readBytes()
+ * and writeBytes() are a bounded memcpy(), without the mapping and
+ * locking the kernel's do.
+ */
+class IOMemoryDescriptor : public OSObject {
+    OSDeclareDefaultStructors(IOMemoryDescriptor)
+    
+public:
+    static IOMemoryDescriptor *withAddress(void *address, IOByteCount withLength, IODirection withDirection);
+    
+    virtual bool initWithAddress(void *address, IOByteCount withLength, IODirection withDirection);
+    
+    IOByteCount getLength() const { return length; }
+    IODirection getDirection() const { return direction; }
+    
+    IOByteCount readBytes(IOByteCount offset, void *bytes, IOByteCount withLength);
+    IOByteCount writeBytes(IOByteCount offset, const void *bytes, IOByteCount withLength);
+    
+protected:
+    void *address;
+    IOByteCount length;
+    IODirection direction;
+};
+
+#endif /* _IOMEMORYDESCRIPTOR_H */
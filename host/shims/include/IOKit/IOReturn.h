@@ -0,0 +1,30 @@
+//
+//  IOReturn.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef __IOKIT_IORETURN_H
+#define __IOKIT_IORETURN_H
+
+typedef int IOReturn;
+
+/* Same values as the kernel, so logs read the same on both sides */
+#define kIOReturnSuccess        0
+#define kIOReturnError          ((IOReturn)0xe00002bc)
+#define kIOReturnNoMemory       ((IOReturn)0xe00002bd)
+#define kIOReturnNoResources    ((IOReturn)0xe00002be)
+#define kIOReturnBadArgument    ((IOReturn)0xe00002c2)
+#define kIOReturnInvalid        ((IOReturn)0xe00002c2)
+#define kIOReturnUnsupported    ((IOReturn)0xe00002c7)
+#define kIOReturnIOError        ((IOReturn)0xe00002ca)
+#define kIOReturnBusy           ((IOReturn)0xe00002d5)
+#define kIOReturnTimeout        ((IOReturn)0xe00002d6)
+#define kIOReturnNotReady       ((IOReturn)0xe00002d8)
+#define kIOReturnAborted        ((IOReturn)0xe00002eb)
+#define kIOReturnNotResponding  ((IOReturn)0xe00002ed)
+#define kIOReturnNotFound       ((IOReturn)0xe00002f0)
+
+#endif /* __IOKIT_IORETURN_H */
@@ -0,0 +1,45 @@
+//
+//  IOService.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _IOKIT_IOSERVICE_H
+#define _IOKIT_IOSERVICE_H
+
+#include <IOKit/IOLib.h>
+/* The kernel's brings all of libkern's containers along */
+#include <libkern/c++/OSArray.h>
+#include <libkern/c++/OSBoolean.h>
+#include <libkern/c++/OSData.h>
+#include <libkern/c++/OSDictionary.h>
+#include <libkern/c++/OSNumber.h>
+#include <libkern/c++/OSString.h>
+
+/* A registry entry is its property table and nothing else, there is no
+ * registry to attach it to.
+ */
+class IORegistryEntry : public OSObject {
+    OSDeclareDefaultStructors(IORegistryEntry)
+    
+public:
+    virtual bool init() override;
+    virtual void free() override;
+    
+    /* Serialized by the entry's lock, as in the kernel */
+    bool setProperty(const char *aKey, OSObject *anObject);
+    OSObject *copyProperty(const char *aKey) const;
+    void removeProperty(const char *aKey);
+    
+private:
+    OSDictionary *properties;
+    IOLock *propertyLock;
+};
+
+class IOService : public IORegistryEntry {
+    OSDeclareDefaultStructors(IOService)
+};
+
+#endif /* _IOKIT_IOSERVICE_H */
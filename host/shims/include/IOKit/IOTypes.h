@@ -0,0 +1,19 @@
+//
+//  IOTypes.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef __IOKIT_IOTYPES_H
+#define __IOKIT_IOTYPES_H
+
+#include <libkern/OSTypes.h>
+#include <IOKit/IOReturn.h>
+
+typedef uint32_t    IOOptionBits;
+typedef uint64_t    IOByteCount;
+typedef uint64_t    AbsoluteTime;
+
+#endif /* __IOKIT_IOTYPES_H */
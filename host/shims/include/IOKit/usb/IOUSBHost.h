@@ -0,0 +1,17 @@
+//
+//  IOUSBHost.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef IOUSBHostFamily_IOUSBHost_h
+#define IOUSBHostFamily_IOUSBHost_h
+
+#include <IOKit/usb/StandardUSB.h>
+#include <IOKit/usb/IOUSBHostDevice.h>
+#include <IOKit/usb/IOUSBHostInterface.h>
+#include <IOKit/usb/IOUSBHostPipe.h>
+
+#endif /* IOUSBHostFamily_IOUSBHost_h */
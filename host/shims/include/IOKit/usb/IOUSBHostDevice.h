@@ -0,0 +1,31 @@
+//
+//  IOUSBHostDevice.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef IOUSBHostFamily_IOUSBHostDevice_h
+#define IOUSBHostFamily_IOUSBHostDevice_h
+
+#include <IOKit/IOService.h>
+#include <IOKit/usb/StandardUSB.h>
+
+class AppleUSBHostController;
+class IOUSBHostInterface;
+
+class IOUSBHostDevice : public IOService {
+    OSDeclareDefaultStructors(IOUSBHostDevice)
+    
+public:
+    /* Host only, a device is whatever its descriptor says */
+    static IOUSBHostDevice *withDescriptor(const StandardUSB::DeviceDescriptor *descriptor);
+    
+    const StandardUSB::DeviceDescriptor *getDeviceDescriptor() const { return &deviceDescriptor; }
+    
+private:
+    StandardUSB::DeviceDescriptor deviceDescriptor;
+};
+
+#endif /* IOUSBHostFamily_IOUSBHostDevice_h */
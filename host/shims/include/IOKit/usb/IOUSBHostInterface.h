@@ -0,0 +1,28 @@
+//
+//  IOUSBHostInterface.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef IOUSBHostFamily_IOUSBHostInterface_h
+#define IOUSBHostFamily_IOUSBHostInterface_h
+
+#include <IOKit/IOService.h>
+#include <IOKit/usb/StandardUSB.h>
+
+class IOUSBHostInterface : public IOService {
+    OSDeclareDefaultStructors(IOUSBHostInterface)
+    
+public:
+    /* Host only, an interface is whatever its descriptor says */
+    static IOUSBHostInterface *withDescriptor(const StandardUSB::InterfaceDescriptor *descriptor);
+    
+    const StandardUSB::InterfaceDescriptor *getInterfaceDescriptor() const { return &interfaceDescriptor; }
+    
+private:
+    StandardUSB::InterfaceDescriptor interfaceDescriptor;
+};
+
+#endif /* IOUSBHostFamily_IOUSBHostInterface_h */
@@ -0,0 +1,34 @@
+//
+//  IOUSBHostPipe.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef IOUSBHostFamily_IOUSBHostPipe_h
+#define IOUSBHostFamily_IOUSBHostPipe_h
+
+#include <IOKit/IOBufferMemoryDescriptor.h>
+#include <IOKit/usb/IOUSBHostDevice.h>
+
+typedef void (*IOUSBHostCompletionAction)(void *owner, void *parameter, IOReturn status, uint32_t bytesTransferred);
+
+struct IOUSBHostCompletion {
+    void *owner;
+    IOUSBHostCompletionAction action;
+    void *parameter;
+};
+
+/* What a device request carries, as far as a route looks at it */
+class IOUSBHostIORequest {
+public:
+    IOBufferMemoryDescriptor *getDataBuffer() const { return dataBuffer; }
+    
+    IOBufferMemoryDescriptor *dataBuffer;
+};
+
+/* Only ever a pointer on the host, the plugin routes its methods */
+class IOUSBHostPipe;
+
+#endif /* IOUSBHostFamily_IOUSBHostPipe_h */
@@ -0,0 +1,80 @@
+//
+//  StandardUSB.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef IOUSBHostFamily_StandardUSB_h
+#define IOUSBHostFamily_StandardUSB_h
+
+#include <libkern/OSTypes.h>
+
+enum {
+    kIOUSBEndpointTypeControl       = 0,
+    kIOUSBEndpointTypeIsochronous   = 1,
+    kIOUSBEndpointTypeBulk          = 2,
+    kIOUSBEndpointTypeInterrupt     = 3,
+};
+
+struct __attribute__((packed)) IOUSBDescriptorHeader {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+};
+
+namespace StandardUSB {
+    struct __attribute__((packed)) DeviceDescriptor {
+        uint8_t bLength;
+        uint8_t bDescriptorType;
+        uint16_t bcdUSB;
+        uint8_t bDeviceClass;
+        uint8_t bDeviceSubClass;
+        uint8_t bDeviceProtocol;
+        uint8_t bMaxPacketSize0;
+        uint16_t idVendor;
+        uint16_t idProduct;
+        uint16_t bcdDevice;
+        uint8_t iManufacturer;
+        uint8_t iProduct;
+        uint8_t iSerialNumber;
+        uint8_t bNumConfigurations;
+    };
+    
+    struct __attribute__((packed)) InterfaceDescriptor {
+        uint8_t bLength;
+        uint8_t bDescriptorType;
+        uint8_t bInterfaceNumber;
+        uint8_t bAlternateSetting;
+        uint8_t bNumEndpoints;
+        uint8_t bInterfaceClass;
+        uint8_t bInterfaceSubClass;
+        uint8_t bInterfaceProtocol;
+        uint8_t iInterface;
+    };
+    
+    struct __attribute__((packed)) EndpointDescriptor {
+        uint8_t bLength;
+        uint8_t bDescriptorType;
+        uint8_t bEndpointAddress;
+        uint8_t bmAttributes;
+        uint16_t wMaxPacketSize;
+        uint8_t bInterval;
+    };
+    
+    struct __attribute__((packed)) SuperSpeedEndpointCompanionDescriptor {
+        uint8_t bLength;
+        uint8_t bDescriptorType;
+        uint8_t bMaxBurst;
+        uint8_t bmAttributes;
+        uint16_t wBytesPerInterval;
+    };
+    
+    static inline uint8_t
+    getEndpointType(const EndpointDescriptor *descriptor)
+    {
+        return descriptor->bmAttributes & 0x3;
+    }
+}
+
+#endif /* IOUSBHostFamily_StandardUSB_h */
@@ -0,0 +1,33 @@
+//
+//  clock.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _KERN_CLOCK_H_
+#define _KERN_CLOCK_H_
+
+#include <stdint.h>
+
+#define kSecondScale        1000000000
+#define kMillisecondScale   1000000
+#define kMicrosecondScale   1000
+#define kNanosecondScale    1
+
+typedef unsigned long   clock_sec_t;
+typedef uint32_t        clock_usec_t;
+
+/* Absolute time is in nanoseconds on the host, so the conversions are
+ * identities. It includes the offset of IBTHostAdvanceClock().
+ */
+uint64_t mach_absolute_time(void);
+void clock_get_uptime(uint64_t *result);
+void absolutetime_to_nanoseconds(uint64_t abstime, uint64_t *result);
+void nanoseconds_to_absolutetime(uint64_t nanoseconds, uint64_t *result);
+void clock_interval_to_absolutetime_interval(uint32_t interval, uint32_t scale_factor, uint64_t *result);
+void clock_interval_to_deadline(uint32_t interval, uint32_t scale_factor, uint64_t *result);
+void clock_get_calendar_microtime(clock_sec_t *secs, clock_usec_t *microsecs);
+
+#endif /* _KERN_CLOCK_H_ */
@@ -0,0 +1,31 @@
+//
+//  thread_call.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _KERN_THREAD_CALL_H_
+#define _KERN_THREAD_CALL_H_
+
+#include <stdint.h>
+
+typedef struct thread_call *thread_call_t;
+typedef void *thread_call_param_t;
+typedef void (*thread_call_func_t)(thread_call_param_t param0, thread_call_param_t param1);
+
+/* Entered calls only run from IBTHostRunThreadCalls(), on the thread
+ * that calls it, so the caller of thread_call_enter() never waits on
+ * one and a tool decides when the deferred work happens. Deadlines are
+ * not kept. Like the kernel's, enter and cancel return whether the call
+ * was pending.
+ */
+thread_call_t thread_call_allocate(thread_call_func_t func, thread_call_param_t param0);
+bool thread_call_free(thread_call_t call);
+bool thread_call_enter(thread_call_t call);
+bool thread_call_enter_delayed(thread_call_t call, uint64_t deadline);
+bool thread_call_cancel(thread_call_t call);
+bool thread_call_cancel_wait(thread_call_t call);
+
+#endif /* _KERN_THREAD_CALL_H_ */
@@ -0,0 +1,56 @@
+//
+//  OSAtomic.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _OS_OSATOMIC_H
+#define _OS_OSATOMIC_H
+
+#include <libkern/OSTypes.h>
+
+/* Like the kernel's, the arithmetic ones return the old value */
+static inline SInt32
+OSAddAtomic(SInt32 amount, volatile SInt32 *address)
+{
+    return __atomic_fetch_add(address, amount, __ATOMIC_SEQ_CST);
+}
+
+static inline SInt64
+OSAddAtomic64(SInt64 amount, volatile SInt64 *address)
+{
+    return __atomic_fetch_add(address, amount, __ATOMIC_SEQ_CST);
+}
+
+#define OSIncrementAtomic(address)      OSAddAtomic(1, (volatile SInt32 *)(address))
+#define OSDecrementAtomic(address)      OSAddAtomic(-1, (volatile SInt32 *)(address))
+#define OSIncrementAtomic64(address)    OSAddAtomic64(1, (volatile SInt64 *)(address))
+#define OSDecrementAtomic64(address)    OSAddAtomic64(-1, (volatile SInt64 *)(address))
+
+static inline bool
+OSCompareAndSwap(UInt32 oldValue, UInt32 newValue, volatile UInt32 *address)
+{
+    return __atomic_compare_exchange_n(address, &oldValue, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline bool
+OSCompareAndSwap64(UInt64 oldValue, UInt64 newValue, volatile UInt64 *address)
+{
+    return __atomic_compare_exchange_n(address, &oldValue, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline bool
+OSCompareAndSwapPtr(void *oldValue, void *newValue, void * volatile *address)
+{
+    return __atomic_compare_exchange_n(address, &oldValue, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline void
+OSMemoryBarrier(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif /* _OS_OSATOMIC_H */
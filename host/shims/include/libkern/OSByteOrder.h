@@ -0,0 +1,40 @@
+//
+//  OSByteOrder.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _OS_OSBYTEORDER_H
+#define _OS_OSBYTEORDER_H
+
+#include <stdint.h>
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "the host shims assume a little endian host, like every Mac the kext runs on"
+#endif
+
+#define OSSwapInt16(x)                  __builtin_bswap16((uint16_t)(x))
+#define OSSwapInt32(x)                  __builtin_bswap32((uint32_t)(x))
+#define OSSwapInt64(x)                  __builtin_bswap64((uint64_t)(x))
+
+#define OSSwapHostToLittleInt16(x)      ((uint16_t)(x))
+#define OSSwapHostToLittleInt32(x)      ((uint32_t)(x))
+#define OSSwapHostToLittleInt64(x)      ((uint64_t)(x))
+#define OSSwapLittleToHostInt16(x)      ((uint16_t)(x))
+#define OSSwapLittleToHostInt32(x)      ((uint32_t)(x))
+#define OSSwapLittleToHostInt64(x)      ((uint64_t)(x))
+#define OSSwapHostToLittleConstInt16(x) ((uint16_t)(x))
+#define OSSwapHostToLittleConstInt32(x) ((uint32_t)(x))
+#define OSSwapLittleToHostConstInt16(x) ((uint16_t)(x))
+#define OSSwapLittleToHostConstInt32(x) ((uint32_t)(x))
+
+#define OSSwapHostToBigInt16(x)         OSSwapInt16(x)
+#define OSSwapHostToBigInt32(x)         OSSwapInt32(x)
+#define OSSwapHostToBigInt64(x)         OSSwapInt64(x)
+#define OSSwapBigToHostInt16(x)         OSSwapInt16(x)
+#define OSSwapBigToHostInt32(x)         OSSwapInt32(x)
+#define OSSwapBigToHostInt64(x)         OSSwapInt64(x)
+
+#endif /* _OS_OSBYTEORDER_H */
@@ -0,0 +1,34 @@
+//
+//  OSKextLib.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _LIBKERN_OSKEXTLIB_H
+#define _LIBKERN_OSKEXTLIB_H
+
+#include <libkern/OSTypes.h>
+
+typedef int         OSReturn;
+typedef uint32_t    OSKextRequestTag;
+
+#define kOSReturnSuccess            0
+#define kOSReturnError              ((OSReturn)0xdc000001)
+#define kOSKextReturnNotFound       ((OSReturn)0xdc008011)
+#define kOSKextReturnInvalidArgument ((OSReturn)0xdc008002)
+
+typedef void (*OSKextRequestResourceCallback)(OSKextRequestTag requestTag, OSReturn result,
+                                              const void *resourceData, uint32_t resourceDataLength,
+                                              void *context);
+
+OSReturn OSKextRequestResource(const char *kextIdentifier, const char *resourceName,
+                               OSKextRequestResourceCallback callback, void *context,
+                               OSKextRequestTag *requestTagOut);
+
+OSReturn OSKextCancelRequest(OSKextRequestTag requestTag, void **contextOut);
+
+const char *OSKextGetCurrentIdentifier(void);
+
+#endif /* _LIBKERN_OSKEXTLIB_H */
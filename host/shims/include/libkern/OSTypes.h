@@ -0,0 +1,25 @@
+//
+//  OSTypes.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _OS_OSTYPES_H
+#define _OS_OSTYPES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t     UInt8;
+typedef uint16_t    UInt16;
+typedef uint32_t    UInt32;
+typedef uint64_t    UInt64;
+typedef int8_t      SInt8;
+typedef int16_t     SInt16;
+typedef int32_t     SInt32;
+typedef int64_t     SInt64;
+typedef unsigned int uint;
+
+#endif /* _OS_OSTYPES_H */
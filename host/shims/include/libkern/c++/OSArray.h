@@ -0,0 +1,41 @@
+//
+//  OSArray.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _OS_OSARRAY_H
+#define _OS_OSARRAY_H
+
+#include <libkern/c++/OSCollection.h>
+
+class OSArray : public OSCollection {
+    OSDeclareDefaultStructors(OSArray)
+    
+public:
+    static OSArray *withCapacity(unsigned int capacity);
+    
+    virtual bool initWithCapacity(unsigned int capacity);
+    virtual void free() override;
+    
+    virtual unsigned int getCount() const override { return count; }
+    virtual unsigned int getCapacity() const override { return capacity; }
+    virtual unsigned int ensureCapacity(unsigned int newCapacity) override;
+    virtual void flushCollection() override;
+    
+    /* Retains anObject, like the kernel's */
+    bool setObject(const OSObject *anObject);
+    bool setObject(unsigned int index, const OSObject *anObject);
+    OSObject *getObject(unsigned int index) const;
+    OSObject *getLastObject() const;
+    void removeObject(unsigned int index);
+    
+private:
+    const OSObject **array;
+    unsigned int count;
+    unsigned int capacity;
+};
+
+#endif /* _OS_OSARRAY_H */
@@ -0,0 +1,38 @@
+//
+//  OSBoolean.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _OS_OSBOOLEAN_H
+#define _OS_OSBOOLEAN_H
+
+#include <libkern/c++/OSObject.h>
+
+class OSBoolean : public OSObject {
+    OSDeclareDefaultStructors(OSBoolean)
+    
+public:
+    static OSBoolean *withBoolean(bool value);
+    
+    virtual bool init(bool value);
+    
+    bool isTrue() const { return value; }
+    bool isFalse() const { return !value; }
+    bool getValue() const { return value; }
+    /* The two instances live forever */
+    virtual void retain() const override {}
+    virtual void release() const override {}
+    
+private:
+    using OSObject::init;
+    
+    bool value;
+};
+
+extern OSBoolean *kOSBooleanTrue;
+extern OSBoolean *kOSBooleanFalse;
+
+#endif /* _OS_OSBOOLEAN_H */
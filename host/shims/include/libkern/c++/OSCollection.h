@@ -0,0 +1,24 @@
+//
+//  OSCollection.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _OS_OSCOLLECTION_H
+#define _OS_OSCOLLECTION_H
+
+#include <libkern/c++/OSObject.h>
+
+class OSCollection : public OSObject {
+    OSDeclareAbstractStructors(OSCollection)
+    
+public:
+    virtual unsigned int getCount() const = 0;
+    virtual unsigned int getCapacity() const = 0;
+    virtual unsigned int ensureCapacity(unsigned int newCapacity) = 0;
+    virtual void flushCollection() = 0;
+};
+
+#endif /* _OS_OSCOLLECTION_H */
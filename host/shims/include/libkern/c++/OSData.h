@@ -0,0 +1,49 @@
+//
+//  OSData.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _OS_OSDATA_H
+#define _OS_OSDATA_H
+
+#include <libkern/c++/OSObject.h>
+
+class OSData : public OSObject {
+    OSDeclareDefaultStructors(OSData)
+    
+public:
+    static OSData *withCapacity(unsigned int capacity);
+    static OSData *withBytes(const void *bytes, unsigned int numBytes);
+    /* Refers to bytes, which must outlive the object */
+    static OSData *withBytesNoCopy(void *bytes, unsigned int numBytes);
+    static OSData *withData(const OSData *other);
+    
+    virtual bool initWithCapacity(unsigned int capacity);
+    virtual bool initWithBytes(const void *bytes, unsigned int numBytes);
+    virtual bool initWithBytesNoCopy(void *bytes, unsigned int numBytes);
+    virtual void free() override;
+    
+    unsigned int getLength() const { return length; }
+    unsigned int getCapacity() const { return capacity; }
+    const void *getBytesNoCopy() const { return length ? data : NULL; }
+    const void *getBytesNoCopy(unsigned int start, unsigned int numBytes) const;
+    
+    bool appendBytes(const void *bytes, unsigned int numBytes);
+    bool appendBytes(const OSData *other);
+    bool appendByte(unsigned char byte, unsigned int numBytes);
+    bool isEqualTo(const void *bytes, unsigned int numBytes) const;
+    virtual bool isEqualTo(const OSObject *anObject) const override;
+    
+private:
+    bool ensureCapacity(unsigned int newCapacity);
+    
+    unsigned char *data;
+    unsigned int length;
+    unsigned int capacity;
+    bool owned;
+};
+
+#endif /* _OS_OSDATA_H */
@@ -0,0 +1,54 @@
+//
+//  OSDictionary.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _OS_OSDICTIONARY_H
+#define _OS_OSDICTIONARY_H
+
+#include <libkern/c++/OSCollection.h>
+
+class OSString;
+class OSSymbol;
+
+/* Keeps insertion order, which is what the host tools print in */
+class OSDictionary : public OSCollection {
+    OSDeclareDefaultStructors(OSDictionary)
+    
+public:
+    static OSDictionary *withCapacity(unsigned int capacity);
+    
+    virtual bool initWithCapacity(unsigned int capacity);
+    virtual void free() override;
+    
+    virtual unsigned int getCount() const override { return count; }
+    virtual unsigned int getCapacity() const override { return capacity; }
+    virtual unsigned int ensureCapacity(unsigned int newCapacity) override;
+    virtual void flushCollection() override;
+    
+    /* Retains anObject and replaces an earlier one of the same key */
+    bool setObject(const char *aKey, const OSObject *anObject);
+    bool setObject(const OSString *aKey, const OSObject *anObject);
+    OSObject *getObject(const char *aKey) const;
+    OSObject *getObject(const OSString *aKey) const;
+    void removeObject(const char *aKey);
+    
+    /* Key and value of the index'th entry, for iteration */
+    const OSSymbol *getKey(unsigned int index) const;
+    OSObject *getValue(unsigned int index) const;
+    
+private:
+    struct Entry {
+        const OSSymbol *key;
+        const OSObject *value;
+    };
+    
+    Entry *entries;
+    unsigned int count;
+    unsigned int capacity;
+};
+
+#endif /* _OS_OSDICTIONARY_H */
@@ -0,0 +1,36 @@
+//
+//  OSNumber.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _OS_OSNUMBER_H
+#define _OS_OSNUMBER_H
+
+#include <libkern/c++/OSObject.h>
+
+class OSNumber : public OSObject {
+    OSDeclareDefaultStructors(OSNumber)
+    
+public:
+    static OSNumber *withNumber(unsigned long long value, unsigned int numberOfBits);
+    
+    virtual bool init(unsigned long long value, unsigned int numberOfBits);
+    
+    unsigned int numberOfBits() const { return size; }
+    unsigned char unsigned8BitValue() const { return (unsigned char)value; }
+    unsigned short unsigned16BitValue() const { return (unsigned short)value; }
+    unsigned int unsigned32BitValue() const { return (unsigned int)value; }
+    unsigned long long unsigned64BitValue() const { return value; }
+    virtual bool isEqualTo(const OSObject *anObject) const override;
+    
+private:
+    using OSObject::init;
+    
+    unsigned long long value;
+    unsigned int size;
+};
+
+#endif /* _OS_OSNUMBER_H */
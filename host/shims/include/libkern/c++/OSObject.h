@@ -0,0 +1,78 @@
+//
+//  OSObject.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _LIBKERN_OSOBJECT_H
+#define _LIBKERN_OSOBJECT_H
+
+#include <stddef.h>
+#include <libkern/OSTypes.h>
+/* The kernel's headers bring the string functions along, so do these */
+#include <libkern/libkern.h>
+
+/* Reference counted like the kernel's: objects start with one reference
+ * and free() runs when the last one is released. There is no metaclass
+ * registry, OSDynamicCast is a dynamic_cast.
+ */
+class OSObject {
+public:
+    /* Memory comes back zeroed, members not set by init() rely on it */
+    static void *operator new(size_t size);
+    static void operator delete(void *mem, size_t size);
+    
+    OSObject();
+    virtual ~OSObject();
+    
+    virtual bool init();
+    virtual void free();
+    virtual void retain() const;
+    virtual void release() const;
+    virtual int getRetainCount() const;
+    virtual bool isEqualTo(const OSObject *anObject) const;
+    
+private:
+    mutable volatile SInt32 retainCount;
+    
+    OSObject(const OSObject &);
+    OSObject &operator=(const OSObject &);
+};
+
+typedef OSObject OSMetaClassBase;
+
+template <typename T>
+static inline T *
+OSDynamicCastImpl(const OSObject *object)
+{
+    return dynamic_cast<T *>(const_cast<OSObject *>(object));
+}
+
+#define OSDynamicCast(type, inst)   OSDynamicCastImpl<type>(inst)
+#define OSRequiredCast(type, inst)  static_cast<type *>(inst)
+
+#define OSSafeReleaseNULL(inst)     do { if (inst) { (inst)->release(); (inst) = NULL; } } while (0)
+
+#define OSDeclareCommonStructors(className) \
+    private: \
+        className(const className &); \
+        className &operator=(const className &); \
+    public: \
+        className(); \
+    protected: \
+        virtual ~className(); \
+    private:
+
+#define OSDeclareDefaultStructors(className)    OSDeclareCommonStructors(className)
+#define OSDeclareAbstractStructors(className)   OSDeclareCommonStructors(className)
+
+#define OSDefineMetaClassAndStructors(className, superclassName) \
+    className::className() : superclassName() {} \
+    className::~className() {}
+
+#define OSDefineMetaClassAndAbstractStructors(className, superclassName) \
+    OSDefineMetaClassAndStructors(className, superclassName)
+
+#endif /* _LIBKERN_OSOBJECT_H */
@@ -0,0 +1,33 @@
+//
+//  OSString.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _OS_OSSTRING_H
+#define _OS_OSSTRING_H
+
+#include <libkern/c++/OSObject.h>
+
+class OSString : public OSObject {
+    OSDeclareDefaultStructors(OSString)
+    
+public:
+    static OSString *withCString(const char *cString);
+    
+    virtual bool initWithCString(const char *cString);
+    virtual void free() override;
+    
+    const char *getCStringNoCopy() const { return string; }
+    unsigned int getLength() const { return length; }
+    bool isEqualTo(const char *cString) const;
+    virtual bool isEqualTo(const OSObject *anObject) const override;
+    
+private:
+    char *string;
+    unsigned int length;
+};
+
+#endif /* _OS_OSSTRING_H */
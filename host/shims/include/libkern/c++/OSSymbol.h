@@ -0,0 +1,22 @@
+//
+//  OSSymbol.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _OS_OSSYMBOL_H
+#define _OS_OSSYMBOL_H
+
+#include <libkern/c++/OSString.h>
+
+/* Not uniqued, symbols compare by content like strings */
+class OSSymbol : public OSString {
+    OSDeclareDefaultStructors(OSSymbol)
+    
+public:
+    static const OSSymbol *withCString(const char *cString);
+};
+
+#endif /* _OS_OSSYMBOL_H */
@@ -0,0 +1,31 @@
+//
+//  libkern.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _LIBKERN_LIBKERN_H_
+#define _LIBKERN_LIBKERN_H_
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libkern/OSTypes.h>
+
+/* The kernel's are functions on unsigned int, not macros */
+static inline unsigned int
+min(unsigned int a, unsigned int b)
+{
+    return a < b ? a : b;
+}
+
+static inline unsigned int
+max(unsigned int a, unsigned int b)
+{
+    return a > b ? a : b;
+}
+
+#endif /* _LIBKERN_LIBKERN_H_ */
@@ -0,0 +1,15 @@
+//
+//  zlib.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _LIBKERN_ZLIB_H
+#define _LIBKERN_ZLIB_H
+
+/* The kernel carries its own copy, the host links the system one */
+#include <zlib.h>
+
+#endif /* _LIBKERN_ZLIB_H */
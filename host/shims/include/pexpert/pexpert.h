@@ -0,0 +1,19 @@
+//
+//  pexpert.h
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef _PEXPERT_PEXPERT_H_
+#define _PEXPERT_PEXPERT_H_
+
+/* The host has no boot-args, every one reads as not set */
+static inline bool
+PE_parse_boot_argn(const char *arg_string, void *arg_ptr, int max_arg)
+{
+    return false;
+}
+
+#endif /* _PEXPERT_PEXPERT_H_ */
@@ -0,0 +1,114 @@
+//
+//  thread_call.cpp
+//  IntelBluetoothFirmware host shims
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <IOKit/IOLib.h>
+#include <kern/thread_call.h>
+#include <pthread.h>
+
+#include "IBTHost.h"
+
+struct thread_call {
+    thread_call_func_t func;
+    thread_call_param_t param0;
+    bool pending;
+    thread_call_t next;
+};
+
+static pthread_mutex_t callMutex = PTHREAD_MUTEX_INITIALIZER;
+static thread_call_t calls;
+
+thread_call_t
+thread_call_allocate(thread_call_func_t func, thread_call_param_t param0)
+{
+    thread_call_t call = (thread_call_t)IOMallocZero(sizeof(*call));
+    
+    if (!call)
+        return NULL;
+    call->func = func;
+    call->param0 = param0;
+    pthread_mutex_lock(&callMutex);
+    call->next = calls;
+    calls = call;
+    pthread_mutex_unlock(&callMutex);
+    return call;
+}
+
+bool
+thread_call_free(thread_call_t call)
+{
+    pthread_mutex_lock(&callMutex);
+    for (thread_call_t *link = &calls; *link; link = &(*link)->next) {
+        if (*link == call) {
+            *link = call->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&callMutex);
+    IOFree(call, sizeof(*call));
+    return true;
+}
+
+static bool
+setPending(thread_call_t call, bool pending)
+{
+    bool was;
+    
+    pthread_mutex_lock(&callMutex);
+    was = call->pending;
+    call->pending = pending;
+    pthread_mutex_unlock(&callMutex);
+    return was;
+}
+
+bool
+thread_call_enter(thread_call_t call)
+{
+    return setPending(call, true);
+}
+
+bool
+thread_call_enter_delayed(thread_call_t call, uint64_t deadline)
+{
+    return setPending(call, true);
+}
+
+bool
+thread_call_cancel(thread_call_t call)
+{
+    return setPending(call, false);
+}
+
+/* Nothing runs a call behind the caller's back, so there is nothing to
+ * wait for.
+ */
+bool
+thread_call_cancel_wait(thread_call_t call)
+{
+    return setPending(call, false);
+}
+
+unsigned int
+IBTHostRunThreadCalls(void)
+{
+    unsigned int ran = 0;
+    
+    for (;;) {
+        thread_call_t call;
+        
+        pthread_mutex_lock(&callMutex);
+        for (call = calls; call && !call->pending; call = call->next)
+            ;
+        if (call)
+            call->pending = false;
+        pthread_mutex_unlock(&callMutex);
+        if (!call)
+            return ran;
+        call->func(call->param0, NULL);
+        ran++;
+    }
+}
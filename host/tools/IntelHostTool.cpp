@@ -0,0 +1,193 @@
+//
+//  IntelHostTool.cpp
+//  IntelBluetoothFirmware host tools
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "IntelHostTool.hpp"
+#include "IntelBluetoothOpsGen1.hpp"
+#include "IntelBluetoothOpsGen2.hpp"
+#include "IntelBluetoothOpsGen3.hpp"
+
+#include <IOKit/IOLib.h>
+#include <libkern/c++/OSArray.h>
+#include <libkern/c++/OSBoolean.h>
+#include <libkern/c++/OSDictionary.h>
+#include <libkern/c++/OSNumber.h>
+#include <libkern/c++/OSString.h>
+#include <libkern/c++/OSSymbol.h>
+
+BtIntel *
+intelHostCreateOps(uint8_t generation)
+{
+    switch (generation) {
+        case 1:
+            return new IntelBluetoothOpsGen1;
+        case 2:
+            return new IntelBluetoothOpsGen2;
+        case 3:
+            return new IntelBluetoothOpsGen3;
+        default:
+            return NULL;
+    }
+}
+
+uint16_t
+intelHostProductID(uint8_t generation)
+{
+    for (size_t i = 0; i < sizeof(intelProducts) / sizeof(intelProducts[0]); i++) {
+        if (intelProducts[i].generation == generation)
+            return intelProducts[i].productID;
+    }
+    /* Anything not in the table is gen2 */
+    return 0x0025;
+}
+
+uint8_t
+intelHostGeneration(const char *name)
+{
+    unsigned int top, bottom;
+    size_t len = strlen(name);
+    int end = 0;
+
+    if (len > 5 && !strcmp(name + len - 5, ".bseq"))
+        return 1;
+    if (len < 4 || strcmp(name + len - 4, ".sfi"))
+        return 0;
+    if (sscanf(name, "ibt-%4x-%4x.sfi%n", &top, &bottom, &end) == 2 &&
+        (size_t)end == len && len == strlen("ibt-0000-0000.sfi"))
+        return 3;
+    return 2;
+}
+
+OSData *
+intelHostReadFile(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    OSData *data;
+    uint8_t buf[4096];
+    size_t got;
+
+    if (!file)
+        return NULL;
+    data = OSData::withCapacity(sizeof(buf));
+    while (data && (got = fread(buf, 1, sizeof(buf), file)) > 0) {
+        if (!data->appendBytes(buf, (unsigned int)got))
+            OSSafeReleaseNULL(data);
+    }
+    if (data && ferror(file))
+        OSSafeReleaseNULL(data);
+    fclose(file);
+    return data;
+}
+
+bool
+intelHostWriteFile(const char *path, OSData *data)
+{
+    FILE *file = fopen(path, "wb");
+    bool ret;
+
+    if (!file)
+        return false;
+    ret = fwrite(data->getBytesNoCopy(), 1, data->getLength(), file) == data->getLength();
+    return fclose(file) == 0 && ret;
+}
+
+static bool
+numberArray(const OSArray *array)
+{
+    for (unsigned int i = 0; i < array->getCount(); i++) {
+        if (!OSDynamicCast(OSNumber, array->getObject(i)))
+            return false;
+    }
+    return true;
+}
+
+void
+intelHostPrint(FILE *out, const char *key, const OSObject *value, int depth)
+{
+    const OSDictionary *dict;
+    const OSArray *array;
+    const OSNumber *num;
+    const OSString *str;
+    const OSBoolean *boolean;
+    const OSData *data;
+
+    fprintf(out, "%*s", depth * 2, "");
+    if (key)
+        fprintf(out, "%s = ", key);
+    if ((dict = OSDynamicCast(OSDictionary, value))) {
+        fprintf(out, "{\n");
+        for (unsigned int i = 0; i < dict->getCount(); i++)
+            intelHostPrint(out, dict->getKey(i)->getCStringNoCopy(), dict->getValue(i), depth + 1);
+        fprintf(out, "%*s}\n", depth * 2, "");
+    } else if ((array = OSDynamicCast(OSArray, value)) && numberArray(array)) {
+        fprintf(out, "(");
+        for (unsigned int i = 0; i < array->getCount(); i++)
+            fprintf(out, "%s%llu", i ? "," : "",
+                    OSDynamicCast(OSNumber, array->getObject(i))->unsigned64BitValue());
+        fprintf(out, ")\n");
+    } else if (array) {
+        fprintf(out, "(\n");
+        for (unsigned int i = 0; i < array->getCount(); i++)
+            intelHostPrint(out, NULL, array->getObject(i), depth + 1);
+        fprintf(out, "%*s)\n", depth * 2, "");
+    } else if ((num = OSDynamicCast(OSNumber, value))) {
+        fprintf(out, "%llu\n", num->unsigned64BitValue());
+    } else if ((str = OSDynamicCast(OSString, value))) {
+        fprintf(out, "\"%s\"\n", str->getCStringNoCopy());
+    } else if ((boolean = OSDynamicCast(OSBoolean, value))) {
+        fprintf(out, "%s\n", boolean->getValue() ? "Yes" : "No");
+    } else if ((data = OSDynamicCast(OSData, value))) {
+        fprintf(out, "<%u bytes>\n", data->getLength());
+    } else {
+        fprintf(out, "?\n");
+    }
+}
+
+void
+intelHostPrintPhases(FILE *out, IntelTimeline *timeline)
+{
+    OSArray *phases = timeline->copyArray();
+    bool *printed;
+
+    if (!phases)
+        return;
+    printed = (bool *)IOMallocZero(phases->getCount() + 1);
+    for (unsigned int n = 0; printed && n < phases->getCount(); n++) {
+        OSDictionary *longest = NULL;
+        unsigned int index = 0;
+        uint64_t us = 0;
+
+        for (unsigned int i = 0; i < phases->getCount(); i++) {
+            OSDictionary *dict = OSDynamicCast(OSDictionary, phases->getObject(i));
+            OSNumber *duration = dict ? OSDynamicCast(OSNumber, dict->getObject("duration_us")) : NULL;
+
+            if (printed[i] || !duration)
+                continue;
+            if (!longest || duration->unsigned64BitValue() > us) {
+                longest = dict;
+                index = i;
+                us = duration->unsigned64BitValue();
+            }
+        }
+        if (!longest)
+            break;
+        printed[index] = true;
+        OSString *name = OSDynamicCast(OSString, longest->getObject("phase"));
+        OSNumber *count = OSDynamicCast(OSNumber, longest->getObject("count"));
+        OSNumber *bytes = OSDynamicCast(OSNumber, longest->getObject("bytes"));
+        fprintf(out, "  %-14s %10.3f ms  x%llu", name ? name->getCStringNoCopy() : "?", us / 1000.0,
+                count ? count->unsigned64BitValue() : 0);
+        if (bytes)
+            fprintf(out, "  %llu bytes", bytes->unsigned64BitValue());
+        if (longest->getObject("failed"))
+            fprintf(out, "  failed");
+        fprintf(out, "\n");
+    }
+    if (printed)
+        IOFree(printed, phases->getCount() + 1);
+    phases->release();
+}
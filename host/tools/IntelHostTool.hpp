@@ -0,0 +1,46 @@
+//
+//  IntelHostTool.hpp
+//  IntelBluetoothFirmware host tools
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef IntelHostTool_hpp
+#define IntelHostTool_hpp
+
+#include <stdio.h>
+#include <libkern/c++/OSData.h>
+
+#include "BtIntel.h"
+
+/* What the host tools share: picking the Ops class, running a setup()
+ * the way the kext's start() does and printing what it left behind.
+ */
+
+/* 1, 2 or 3 as in intelProducts, NULL for anything else */
+BtIntel *intelHostCreateOps(uint8_t generation);
+
+/* A product ID of that generation, for intelLatencyForSku() */
+uint16_t intelHostProductID(uint8_t generation);
+
+/* The generation of the part a firmware file is for, from its name:
+ * .bseq is gen1, ibt-<4 hex>-<4 hex>.sfi gen3, any other .sfi gen2.
+ * 0 when the name is none of these.
+ */
+uint8_t intelHostGeneration(const char *name);
+
+/* Reads a whole file, NULL if it cannot be read */
+OSData *intelHostReadFile(const char *path);
+
+bool intelHostWriteFile(const char *path, OSData *data);
+
+/* Prints a property the way ioreg -l shows it, dictionaries one key per
+ * line and arrays of numbers on one line.
+ */
+void intelHostPrint(FILE *out, const char *key, const OSObject *value, int depth);
+
+/* Time spent per IntelTimeline phase, longest first */
+void intelHostPrintPhases(FILE *out, IntelTimeline *timeline);
+
+#endif /* IntelHostTool_hpp */
@@ -0,0 +1,166 @@
+//
+//  IntelHostTransport.cpp
+//  IntelBluetoothFirmware host tools
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "IntelHostTransport.hpp"
+#include "BtIntelSnoop.h"
+
+#include <IOKit/IOLib.h>
+#include <libkern/OSByteOrder.h>
+
+#include "IBTHost.h"
+
+#define super HCITransport
+OSDefineMetaClassAndAbstractStructors(IntelHostTransport, HCITransport)
+
+bool IntelHostTransport::
+init()
+{
+    BtsnoopHdr hdr = {
+        .magic = { 'b', 't', 's', 'n', 'o', 'o', 'p', 0 },
+        .version = OSSwapHostToBigInt32(BTSNOOP_VERSION),
+        .datalink = OSSwapHostToBigInt32(BTSNOOP_DATALINK_H4),
+    };
+
+    if (!super::init())
+        return false;
+    mTrace.reset();
+    mCapture = OSData::withCapacity(64 * 1024);
+    return mCapture && mCapture->appendBytes(&hdr, sizeof(hdr));
+}
+
+void IntelHostTransport::
+free()
+{
+    OSSafeReleaseNULL(mCapture);
+    super::free();
+}
+
+void IntelHostTransport::
+push(IntelHostQueue *queue, uint64_t ready, const uint8_t *event, uint32_t length)
+{
+    uint32_t i;
+
+    if (queue->count == IBT_HOST_QUEUE) {
+        IBTTrace(&mTrace, IBT_TRACE_ERROR, "host queue full, dropping event 0x%02llx\n", event[0]);
+        return;
+    }
+    /* Ordered by ready time, events ready at the same time stay in order */
+    for (i = queue->count; i > 0 && queue->events[i - 1].ready > ready; i--)
+        queue->events[i] = queue->events[i - 1];
+    queue->events[i].ready = ready;
+    queue->events[i].length = min(length, IBT_HOST_EVENT_SIZE);
+    memcpy(queue->events[i].data, event, queue->events[i].length);
+    queue->count++;
+}
+
+bool IntelHostTransport::
+clampTimeout(uint32_t *timeout)
+{
+    if (!m_pDeadline)
+        return true;
+    *timeout = m_pDeadline->clamp(*timeout);
+    return *timeout != 0;
+}
+
+IOReturn IntelHostTransport::
+read(IntelHostQueue *queue, void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout)
+{
+    uint64_t now, limit;
+    IntelHostEvent *event = &queue->events[0];
+
+    if (!clampTimeout(&timeout))
+        return kIOReturnTimeout;
+    now = mach_absolute_time();
+    limit = now + (uint64_t)timeout * kMillisecondScale;
+    if (!queue->count || event->ready > limit) {
+        IBTHostAdvanceClock(limit - now);
+        IBTTrace(&mTrace, IBT_TRACE_ERROR, "host read on pipe %llu timed out after %llums\n",
+                 queue == &mBulk, timeout);
+        return kIOReturnTimeout;
+    }
+    if (event->ready > now)
+        IBTHostAdvanceClock(event->ready - now);
+    capture(IBT_SNOOP_EVENT, event->data, event->length);
+    if (buf)
+        memcpy(buf, event->data, min(event->length, buf_size));
+    if (size)
+        *size = min(event->length, buf_size);
+    queue->count--;
+    memmove(&queue->events[0], &queue->events[1], sizeof(queue->events[0]) * queue->count);
+    return kIOReturnSuccess;
+}
+
+IOReturn IntelHostTransport::
+sendHCIRequest(HciCommandHdr *cmd, uint32_t timeout)
+{
+    if (!clampTimeout(&timeout))
+        return kIOReturnTimeout;
+    /* Stamped before the transfer, as USBDeviceController does */
+    capture(IBT_SNOOP_COMMAND, cmd, HCI_COMMAND_HDR_SIZE + cmd->len);
+    IBTHostAdvanceClock(transferTime(false));
+    command((const uint8_t *)cmd, HCI_COMMAND_HDR_SIZE + cmd->len, false);
+    return kIOReturnSuccess;
+}
+
+IOReturn IntelHostTransport::
+interruptPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout)
+{
+    return read(&mInterrupt, buf, buf_size, size, timeout);
+}
+
+IOReturn IntelHostTransport::
+bulkWrite(const void *data, uint32_t length, uint32_t timeout)
+{
+    if (!clampTimeout(&timeout))
+        return kIOReturnTimeout;
+    capture(IBT_SNOOP_COMMAND, data, length);
+    IBTHostAdvanceClock(transferTime(true));
+    command((const uint8_t *)data, length, true);
+    return kIOReturnSuccess;
+}
+
+IOReturn IntelHostTransport::
+bulkPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout)
+{
+    return read(&mBulk, buf, buf_size, size, timeout);
+}
+
+const char *IntelHostTransport::
+stringFromReturn(IOReturn code)
+{
+    switch (code) {
+        case kIOReturnSuccess:
+            return "success";
+        case kIOReturnTimeout:
+            return "timeout";
+        default:
+            return "error";
+    }
+}
+
+void IntelHostTransport::
+capture(uint8_t type, const void *packet, uint32_t length)
+{
+    BtsnoopPkt pkt;
+
+    pkt.origLen = OSSwapHostToBigInt32(length + 1);
+    pkt.inclLen = pkt.origLen;
+    pkt.flags = OSSwapHostToBigInt32(BTSNOOP_FLAG_CMD_EVT |
+                                     (type == IBT_SNOOP_EVENT ? BTSNOOP_FLAG_RECEIVED : 0));
+    pkt.drops = 0;
+    pkt.ts = OSSwapHostToBigInt64(BTSNOOP_EPOCH_DELTA + mach_absolute_time() / 1000);
+    mCapture->appendBytes(&pkt, sizeof(pkt));
+    mCapture->appendBytes(&type, 1);
+    mCapture->appendBytes(packet, length);
+}
+
+OSData *IntelHostTransport::
+copySnoop()
+{
+    return OSData::withBytes(mCapture->getBytesNoCopy(), mCapture->getLength());
+}
@@ -0,0 +1,96 @@
+//
+//  IntelHostTransport.hpp
+//  IntelBluetoothFirmware host tools
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef IntelHostTransport_hpp
+#define IntelHostTransport_hpp
+
+#include <libkern/c++/OSData.h>
+
+#include "BtIntel.h"
+#include "HCITransport.hpp"
+
+/* Events in flight per channel */
+#define IBT_HOST_QUEUE          16
+#define IBT_HOST_EVENT_SIZE     (2 + 255)
+
+struct IntelHostEvent {
+    uint64_t ready;
+    uint32_t length;
+    uint8_t data[IBT_HOST_EVENT_SIZE];
+};
+
+struct IntelHostQueue {
+    IntelHostEvent events[IBT_HOST_QUEUE];
+    uint32_t count;
+};
+
+/* The half of a controller the host tools have in common: the events it
+ * has in store on each channel, when they are ready, and a btsnoop of
+ * everything that went over the transport. A subclass decides in
+ * command() what a command is answered with and queues it with push().
+ *
+ * Time is mach_absolute_time() on the virtual clock of the host shims
+ * (IBTHostSetVirtualClock()): a read advances it to when the event is
+ * ready, or by its whole timeout if nothing is.
+ */
+class IntelHostTransport : public HCITransport {
+    OSDeclareAbstractStructors(IntelHostTransport)
+
+public:
+
+    virtual bool init() override;
+
+    virtual void free() override;
+
+    IOReturn sendHCIRequest(HciCommandHdr *cmd, uint32_t timeout) override;
+
+    IOReturn interruptPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout) override;
+
+    IOReturn bulkWrite(const void *data, uint32_t length, uint32_t timeout) override;
+
+    IOReturn bulkPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout) override;
+
+    const char* stringFromReturn(IOReturn code) override;
+
+    IntelTraceRing *getTrace() override { return &mTrace; }
+
+    void setDeadline(IntelDeadline *deadline) override { m_pDeadline = deadline; }
+
+    /* Every packet whole, unlike the kext's capture (IntelSnoopRing),
+     * so that ibt_replay can answer from it.
+     */
+    OSData *copySnoop() override;
+
+protected:
+
+    /* A command as it went out, bulk when it went out with bulkWrite() */
+    virtual void command(const uint8_t *packet, uint32_t length, bool bulk) = 0;
+
+    /* What a transfer of the host takes before the controller has it, in ns */
+    virtual uint64_t transferTime(bool bulk) { return 0; }
+
+    void push(IntelHostQueue *queue, uint64_t ready, const uint8_t *event, uint32_t length);
+
+    IntelHostQueue mInterrupt;
+    IntelHostQueue mBulk;
+    IntelTraceRing mTrace;
+
+private:
+
+    IOReturn read(IntelHostQueue *queue, void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout);
+
+    void capture(uint8_t type, const void *packet, uint32_t length);
+
+    bool clampTimeout(uint32_t *timeout);
+
+private:
+    OSData *mCapture;
+    IntelDeadline *m_pDeadline;
+};
+
+#endif /* IntelHostTransport_hpp */
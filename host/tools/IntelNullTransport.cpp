@@ -0,0 +1,82 @@
+//
+//  IntelNullTransport.cpp
+//  IntelBluetoothFirmware host tools
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "IntelNullTransport.hpp"
+
+#include <libkern/OSByteOrder.h>
+
+#define super HCITransport
+OSDefineMetaClassAndStructors(IntelNullTransport, HCITransport)
+
+#define IBT_NULL_CREDITS    8
+
+bool IntelNullTransport::
+init()
+{
+    if (!super::init())
+        return false;
+    mTrace.reset();
+    commands = 0;
+    bytes = 0;
+    head = tail = 0;
+    return true;
+}
+
+IOReturn IntelNullTransport::
+sendHCIRequest(HciCommandHdr *cmd, uint32_t timeout)
+{
+    if (tail - head == IBT_NULL_QUEUE)
+        return kIOReturnNoResources;
+    opcodes[tail++ % IBT_NULL_QUEUE] = OSSwapLittleToHostInt16(cmd->opcode);
+    commands++;
+    bytes += HCI_COMMAND_HDR_SIZE + cmd->len;
+    return kIOReturnSuccess;
+}
+
+IOReturn IntelNullTransport::
+bulkWrite(const void *data, uint32_t length, uint32_t timeout)
+{
+    if (length < HCI_COMMAND_HDR_SIZE)
+        return kIOReturnBadArgument;
+    return sendHCIRequest((HciCommandHdr *)data, timeout);
+}
+
+IOReturn IntelNullTransport::
+reply(void *buf, uint32_t buf_size, uint32_t *size)
+{
+    uint8_t event[6] = { HCI_EV_CMD_COMPLETE, 4, IBT_NULL_CREDITS, 0, 0, 0 };
+    uint32_t len = sizeof(event);
+
+    if (head == tail) {
+        /* Vendor event with no parameters */
+        event[0] = 0xff;
+        event[1] = 0;
+        len = 2;
+    } else {
+        uint16_t opcode = opcodes[head++ % IBT_NULL_QUEUE];
+        event[3] = opcode & 0xff;
+        event[4] = opcode >> 8;
+    }
+    if (buf)
+        memcpy(buf, event, min(len, buf_size));
+    if (size)
+        *size = min(len, buf_size);
+    return kIOReturnSuccess;
+}
+
+IOReturn IntelNullTransport::
+interruptPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout)
+{
+    return reply(buf, buf_size, size);
+}
+
+IOReturn IntelNullTransport::
+bulkPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout)
+{
+    return reply(buf, buf_size, size);
+}
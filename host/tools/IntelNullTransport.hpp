@@ -0,0 +1,56 @@
+//
+//  IntelNullTransport.hpp
+//  IntelBluetoothFirmware host tools
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef IntelNullTransport_hpp
+#define IntelNullTransport_hpp
+
+#include "BtIntel.h"
+#include "HCITransport.hpp"
+
+/* Opcodes waiting for their Command Complete */
+#define IBT_NULL_QUEUE      16
+
+/* Accepts every command and answers it with a successful Command
+ * Complete, at once and without keeping anything, so that what ibt_bench
+ * times is the CPU side of the Ops alone. Reads with nothing pending
+ * return an empty vendor event, which is what patch records waiting for
+ * one expect.
+ */
+class IntelNullTransport : public HCITransport {
+    OSDeclareDefaultStructors(IntelNullTransport)
+
+public:
+
+    virtual bool init() override;
+
+    IOReturn sendHCIRequest(HciCommandHdr *cmd, uint32_t timeout) override;
+
+    IOReturn interruptPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout) override;
+
+    IOReturn bulkWrite(const void *data, uint32_t length, uint32_t timeout) override;
+
+    IOReturn bulkPipeRead(void *buf, uint32_t buf_size, uint32_t *size, uint32_t timeout) override;
+
+    const char* stringFromReturn(IOReturn code) override { return "null transport"; }
+
+    IntelTraceRing *getTrace() override { return &mTrace; }
+
+    /* Commands and their bytes, secure send fragments included */
+    uint32_t commands;
+    uint64_t bytes;
+
+private:
+    IOReturn reply(void *buf, uint32_t buf_size, uint32_t *size);
+
+    uint16_t opcodes[IBT_NULL_QUEUE];
+    uint32_t head;
+    uint32_t tail;
+    IntelTraceRing mTrace;
+};
+
+#endif /* IntelNullTransport_hpp */
@@ -0,0 +1,375 @@
+//
+//  IntelReplayTransport.cpp
+//  IntelBluetoothFirmware host tools
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "IntelReplayTransport.hpp"
+#include "BtIntelSnoop.h"
+
+#include <stdlib.h>
+#include <IOKit/IOLib.h>
+#include <libkern/OSByteOrder.h>
+
+#include "IBTHost.h"
+
+#define super IntelHostTransport
+OSDefineMetaClassAndStructors(IntelReplayTransport, IntelHostTransport)
+
+#define HCI_OP_INTEL_SECURE_SEND    0xfc09
+#define HCI_OP_INTEL_READ_BOOT      0xfc0d
+
+bool IntelReplayTransport::
+initWithCapture(OSData *capture, const IntelReplayConfig *config)
+{
+    if (!super::init())
+        return false;
+    mConfig = *config;
+    mReplay = capture;
+    mReplay->retain();
+    return parse();
+}
+
+void IntelReplayTransport::
+free()
+{
+    if (m_pPackets)
+        IOFree(m_pPackets, sizeof(IntelReplayPacket) * mPacketCount);
+    if (m_pExchanges)
+        IOFree(m_pExchanges, sizeof(IntelReplayExchange) * mExchangeCount);
+    OSSafeReleaseNULL(mReplay);
+    super::free();
+}
+
+const uint8_t *IntelReplayTransport::
+bytes(const IntelReplayPacket *packet)
+{
+    return (const uint8_t *)mReplay->getBytesNoCopy() + packet->offset;
+}
+
+/* Of a command, or of the command an event answers, 0 for neither */
+uint16_t IntelReplayTransport::
+opcode(const IntelReplayPacket *packet)
+{
+    const uint8_t *data = bytes(packet);
+
+    if (packet->type == IBT_SNOOP_COMMAND && packet->captured >= 2)
+        return data[0] | data[1] << 8;
+    if (packet->type != IBT_SNOOP_EVENT)
+        return 0;
+    if (data[0] == HCI_EV_CMD_COMPLETE && packet->captured >= 5)
+        return data[3] | data[4] << 8;
+    if (data[0] == HCI_EV_CMD_STATUS && packet->captured >= 6)
+        return data[4] | data[5] << 8;
+    return 0;
+}
+
+/* Splits the capture into packets, then into exchanges. Anything that is
+ * not a command or an event is left out.
+ */
+bool IntelReplayTransport::
+parse()
+{
+    const uint8_t *data = (const uint8_t *)mReplay->getBytesNoCopy();
+    uint32_t len = mReplay->getLength();
+    const BtsnoopHdr *hdr = (const BtsnoopHdr *)data;
+    uint32_t count = 0, drops, lastDrops;
+    uint64_t first = 0;
+
+    if (len < sizeof(*hdr) || memcmp(hdr->magic, "btsnoop", 8) ||
+        OSSwapBigToHostInt32(hdr->version) != BTSNOOP_VERSION ||
+        OSSwapBigToHostInt32(hdr->datalink) != BTSNOOP_DATALINK_H4) {
+        IOLog("%s: not an H4 btsnoop capture\n", __FUNCTION__);
+        return false;
+    }
+    for (int pass = 0; pass < 2; pass++) {
+        uint32_t pos = sizeof(*hdr);
+
+        count = 0;
+        lastDrops = 0;
+        while (len - pos >= sizeof(BtsnoopPkt)) {
+            const BtsnoopPkt *pkt = (const BtsnoopPkt *)(data + pos);
+            uint32_t incl = OSSwapBigToHostInt32(pkt->inclLen);
+            uint32_t orig = OSSwapBigToHostInt32(pkt->origLen);
+            uint64_t ts = OSSwapBigToHostInt64(pkt->ts);
+
+            pos += sizeof(*pkt);
+            if (len - pos < incl) {
+                IOLog("%s: capture cut short in packet %u\n", __FUNCTION__, count);
+                break;
+            }
+            drops = OSSwapBigToHostInt32(pkt->drops);
+            if (!incl || (data[pos] != IBT_SNOOP_COMMAND && data[pos] != IBT_SNOOP_EVENT) ||
+                (data[pos] == IBT_SNOOP_EVENT && incl < 3)) {
+                pos += incl;
+                lastDrops = drops;
+                continue;
+            }
+            if (pass) {
+                IntelReplayPacket *packet = &m_pPackets[count];
+
+                if (!count)
+                    first = ts;
+                packet->time = (ts - first) * 1000;
+                packet->offset = pos + 1;
+                packet->captured = incl - 1;
+                packet->length = max(orig, incl) - 1;
+                packet->folded = drops > lastDrops ? drops - lastDrops : 0;
+                packet->type = data[pos];
+            }
+            lastDrops = drops;
+            pos += incl;
+            count++;
+        }
+        if (!pass) {
+            if (!count) {
+                IOLog("%s: no HCI traffic in the capture\n", __FUNCTION__);
+                return false;
+            }
+            m_pPackets = (IntelReplayPacket *)IOMallocZero(sizeof(IntelReplayPacket) * count);
+            if (!m_pPackets)
+                return false;
+            mPacketCount = count;
+        }
+    }
+
+    count = 0;
+    for (uint32_t i = 0; i < mPacketCount; i++)
+        count += m_pPackets[i].type == IBT_SNOOP_COMMAND;
+    m_pExchanges = (IntelReplayExchange *)IOMallocZero(sizeof(IntelReplayExchange) * (count ? count : 1));
+    if (!m_pExchanges)
+        return false;
+    mExchangeCount = count ? count : 1;
+    count = 0;
+    for (uint32_t i = 0; i < mPacketCount; i++) {
+        const IntelReplayPacket *packet = &m_pPackets[i];
+        IntelReplayExchange *exchange;
+        uint32_t end;
+
+        if (packet->type != IBT_SNOOP_COMMAND)
+            continue;
+        for (end = i + 1; end < mPacketCount && m_pPackets[end].type != IBT_SNOOP_COMMAND; end++)
+            ;
+        exchange = &m_pExchanges[count++];
+        exchange->command = i;
+        exchange->events = i + 1;
+        exchange->end = end;
+        exchange->fragments = 1;
+        /* The kext folds the fragments of a run and their answers into
+         * the first fragment, see IntelSnoopRing::fold().
+         */
+        if (opcode(packet) == HCI_OP_INTEL_SECURE_SEND && packet->folded >= 2) {
+            /* The run lasts until what came after its answers */
+            uint32_t next = i + 2;
+            uint64_t until;
+
+            while (next < end && opcode(&m_pPackets[next]) == HCI_OP_INTEL_SECURE_SEND)
+                next++;
+            until = next < mPacketCount ? m_pPackets[next].time : m_pPackets[mPacketCount - 1].time;
+            exchange->fragments = 1 + packet->folded / 2;
+            exchange->fragmentNs = (until - packet->time) / exchange->fragments;
+        }
+    }
+    mExchangeCount = count;
+    settle();
+    return true;
+}
+
+static int
+compareNs(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* Sets answerNs, pulling the answers read late in to the median of
+ * their opcode.
+ */
+void IntelReplayTransport::
+settle()
+{
+    uint64_t *delays = (uint64_t *)IOMallocZero(sizeof(uint64_t) * (mExchangeCount + 1));
+
+    for (uint32_t i = 0; i < mExchangeCount; i++) {
+        IntelReplayExchange *exchange = &m_pExchanges[i];
+
+        if (exchange->events < exchange->end)
+            exchange->answerNs = m_pPackets[exchange->events].time - m_pPackets[exchange->command].time;
+    }
+    for (uint32_t i = 0; delays && i < mExchangeCount; i++) {
+        uint16_t op = opcode(&m_pPackets[m_pExchanges[i].command]);
+        uint32_t count = 0;
+        uint64_t median;
+
+        /* Once per opcode, from its first exchange */
+        bool seen = false;
+        for (uint32_t j = 0; j < i && !seen; j++)
+            seen = opcode(&m_pPackets[m_pExchanges[j].command]) == op;
+        if (seen)
+            continue;
+        for (uint32_t j = i; j < mExchangeCount; j++) {
+            const IntelReplayExchange *exchange = &m_pExchanges[j];
+
+            if (opcode(&m_pPackets[exchange->command]) == op && exchange->fragments == 1 &&
+                exchange->events < exchange->end && opcode(&m_pPackets[exchange->events]) == op)
+                delays[count++] = exchange->answerNs;
+        }
+        if (count < 2)
+            continue;
+        qsort(delays, count, sizeof(delays[0]), compareNs);
+        median = delays[count / 2];
+        for (uint32_t j = i; j < mExchangeCount; j++) {
+            IntelReplayExchange *exchange = &m_pExchanges[j];
+
+            if (opcode(&m_pPackets[exchange->command]) == op && exchange->fragments == 1 &&
+                exchange->answerNs > median * IBT_REPLAY_LATE && exchange->events < exchange->end &&
+                opcode(&m_pPackets[exchange->events]) == op) {
+                exchange->answerNs = median;
+                mLate++;
+            }
+        }
+    }
+    if (delays)
+        IOFree(delays, sizeof(uint64_t) * (mExchangeCount + 1));
+}
+
+uint8_t IntelReplayTransport::
+getGeneration()
+{
+    bool secureSend = false;
+
+    for (uint32_t i = 0; i < mExchangeCount; i++) {
+        const IntelReplayPacket *packet = &m_pPackets[m_pExchanges[i].command];
+        const uint8_t *data = bytes(packet);
+
+        switch (opcode(packet)) {
+            case HCI_OP_INTEL_VERSION:
+                if (!secureSend && packet->captured >= 4 && data[2] == 1 && data[3] == 0xff)
+                    return 3;
+                break;
+            case HCI_OP_INTEL_SECURE_SEND:
+            case HCI_OP_INTEL_READ_BOOT:
+                secureSend = true;
+                break;
+        }
+    }
+    return secureSend ? 2 : 1;
+}
+
+uint64_t IntelReplayTransport::
+getSpan()
+{
+    return mPacketCount ? m_pPackets[mPacketCount - 1].time : 0;
+}
+
+/* The whole recorded command where the capture has it, its start where
+ * it does not. A folded run only has its first fragment, any fragment
+ * of the same type matches it.
+ */
+bool IntelReplayTransport::
+matches(const IntelReplayExchange *exchange, const uint8_t *packet, uint32_t length)
+{
+    const IntelReplayPacket *recorded = &m_pPackets[exchange->command];
+    const uint8_t *data = bytes(recorded);
+
+    if (length < 2 || opcode(recorded) != (packet[0] | packet[1] << 8))
+        return false;
+    if (exchange->fragments > 1)
+        return length > 3 && recorded->captured > 3 && packet[3] == data[3];
+    return length == recorded->length && !memcmp(data, packet, min(recorded->captured, length));
+}
+
+/* Queues what was recorded after the command, starting at start. The
+ * answer comes as long after it as it took then, times the scale of the
+ * command; what follows the answer, as long after the answer. Of a
+ * folded run, every fragment gets the first answer and the last one
+ * what followed the run.
+ */
+void IntelReplayTransport::
+answer(const IntelReplayExchange *exchange, uint64_t start, bool bulk, bool last)
+{
+    const IntelReplayPacket *command = &m_pPackets[exchange->command];
+    uint16_t op = opcode(command);
+    double scale = op == HCI_OP_INTEL_SECURE_SEND ? mConfig.bulkScale : mConfig.ctrlScale;
+    uint64_t prev = command->time, ready = start;
+    uint8_t event[IBT_HOST_EVENT_SIZE];
+
+    mCtrlFree = start;
+    for (uint32_t i = exchange->events; i < exchange->end; i++) {
+        const IntelReplayPacket *packet = &m_pPackets[i];
+        bool answers = opcode(packet) == op;
+        IntelHostQueue *queue = &mInterrupt;
+        uint32_t length = min(packet->length, (uint32_t)sizeof(event));
+
+        if (exchange->fragments > 1 && i == exchange->events) {
+            ready += (uint64_t)(exchange->fragmentNs * scale);
+            prev = command->time + exchange->fragmentNs * exchange->fragments;
+        } else if (i == exchange->events) {
+            ready += (uint64_t)(exchange->answerNs * (answers ? scale : mConfig.ctrlScale));
+            prev = packet->time;
+        } else {
+            if (exchange->fragments > 1 && !last)
+                break;
+            ready += (uint64_t)((packet->time - min(prev, packet->time)) *
+                                (answers ? scale : mConfig.ctrlScale));
+            prev = packet->time;
+        }
+        /* The controller takes the next command once it answered this */
+        if (i == exchange->events)
+            mCtrlFree = ready;
+        /* Answers go back the way the bootloader sends them */
+        if (answers && bulk && (op == HCI_OP_INTEL_SECURE_SEND || mConfig.bulkRoute))
+            queue = &mBulk;
+        if (packet->captured < length) {
+            memset(event, 0, sizeof(event));
+            mTruncated++;
+        }
+        memcpy(event, bytes(packet), min(packet->captured, length));
+        push(queue, ready, event, length);
+    }
+}
+
+void IntelReplayTransport::
+command(const uint8_t *packet, uint32_t length, bool bulk)
+{
+    uint64_t start = mach_absolute_time();
+    uint32_t i, limit;
+
+    if (mCtrlFree > start)
+        start = mCtrlFree;
+    if (mRunLeft) {
+        const IntelReplayExchange *run = &m_pExchanges[mRun - 1];
+
+        if (matches(run, packet, length)) {
+            mRunLeft--;
+            mMatched++;
+            answer(run, start, bulk, !mRunLeft);
+            return;
+        }
+        mRunLeft = 0;
+    }
+    limit = min(mNext + IBT_REPLAY_WINDOW, mExchangeCount);
+    for (i = mNext; i < limit; i++) {
+        if (matches(&m_pExchanges[i], packet, length))
+            break;
+    }
+    if (i == limit) {
+        mDiverged++;
+        IBTTrace(&mTrace, IBT_TRACE_ERROR, "replay has no command 0x%04llx after exchange %llu\n",
+                 length >= 2 ? packet[0] | packet[1] << 8 : 0, mNext);
+        IOLog("%s: no recorded command 0x%04x after exchange %u\n", __FUNCTION__,
+              length >= 2 ? packet[0] | packet[1] << 8 : 0, mNext);
+        return;
+    }
+    mSkipped += i - mNext;
+    mNext = i + 1;
+    mMatched++;
+    if (m_pExchanges[i].fragments > 1) {
+        mRun = i + 1;
+        mRunLeft = m_pExchanges[i].fragments - 1;
+    }
+    answer(&m_pExchanges[i], start, bulk, !mRunLeft);
+}
@@ -0,0 +1,144 @@
+//
+//  IntelReplayTransport.hpp
+//  IntelBluetoothFirmware host tools
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef IntelReplayTransport_hpp
+#define IntelReplayTransport_hpp
+
+#include "IntelHostTransport.hpp"
+
+/* Recorded commands looked at ahead of the next one in capture order */
+#define IBT_REPLAY_WINDOW       64
+/* An answer that took this many times the median of its opcode was
+ * read late, after a timeout of the Ops, rather than served late.
+ */
+#define IBT_REPLAY_LATE         4
+
+struct IntelReplayConfig {
+    /* Applied to the recorded service times, bulkScale to secure send
+     * and ctrlScale to everything else, the notifications included.
+     */
+    double ctrlScale;
+    double bulkScale;
+    /* As IntelSimConfig::bulkRoute, the capture does not say */
+    bool bulkRoute;
+};
+
+/* One packet of the capture, time in ns from the first one */
+struct IntelReplayPacket {
+    uint64_t time;
+    uint32_t offset;
+    uint32_t captured;
+    uint32_t length;
+    /* Packets IntelSnoopRing folded into this one */
+    uint32_t folded;
+    uint8_t type;
+};
+
+/* A recorded command and the events that came in up to the next one,
+ * the first of them answerNs after the command. A secure send run the
+ * kext folded stands for fragments commands, each answered fragmentNs
+ * after it went out.
+ */
+struct IntelReplayExchange {
+    uint32_t command;
+    uint32_t events;
+    uint32_t end;
+    uint64_t answerNs;
+    uint32_t fragments;
+    uint64_t fragmentNs;
+};
+
+/* The controller of a btsnoop capture, as written by the kext's
+ * hci_snoop property or by ibt_sim -o. Every command the Ops send is
+ * looked up among the recorded ones that follow the last match, and
+ * answered with what was recorded after it, as long after as it took
+ * then times the configured scale. Commands the capture has no match
+ * for are never answered. The capture has when the host read an event,
+ * not when it came in: an answer read long after the others of its
+ * opcode is taken to have come in as fast as they did.
+ *
+ * Only the controller's time comes from the capture. The host's is the
+ * one of the code under test, its sleeps and timeouts on the virtual
+ * clock; its CPU time does not count.
+ */
+class IntelReplayTransport : public IntelHostTransport {
+    OSDeclareDefaultStructors(IntelReplayTransport)
+
+public:
+
+    virtual bool initWithCapture(OSData *capture, const IntelReplayConfig *config);
+
+    virtual void free() override;
+
+    /* Of the Ops that made the capture: 3 when Read Version went out
+     * for the TLV version, 2 when there was a secure send, 1 otherwise.
+     */
+    uint8_t getGeneration();
+
+    /* From the first packet to the last */
+    uint64_t getSpan();
+
+    uint32_t getRecorded() { return mExchangeCount; }
+
+    uint32_t getMatched() { return mMatched; }
+
+    /* Recorded commands the Ops went past without sending */
+    uint32_t getSkipped() { return mSkipped; }
+
+    /* Commands of the Ops that have no match */
+    uint32_t getDiverged() { return mDiverged; }
+
+    /* Answers the capture only has the start of, padded with zeros */
+    uint32_t getTruncated() { return mTruncated; }
+
+    /* Answers that were read late, replayed at the median of their opcode */
+    uint32_t getLate() { return mLate; }
+
+protected:
+
+    void command(const uint8_t *packet, uint32_t length, bool bulk) override;
+
+private:
+
+    bool parse();
+
+    void settle();
+
+    const uint8_t *bytes(const IntelReplayPacket *packet);
+
+    uint16_t opcode(const IntelReplayPacket *packet);
+
+    bool matches(const IntelReplayExchange *exchange, const uint8_t *packet, uint32_t length);
+
+    void answer(const IntelReplayExchange *exchange, uint64_t start, bool bulk, bool last);
+
+private:
+    IntelReplayConfig mConfig;
+    OSData *mReplay;
+
+    IntelReplayPacket *m_pPackets;
+    uint32_t mPacketCount;
+    IntelReplayExchange *m_pExchanges;
+    uint32_t mExchangeCount;
+
+    /* First exchange not gone past, and the fragments still to come of
+     * the folded run at mRun - 1.
+     */
+    uint32_t mNext;
+    uint32_t mRun;
+    uint32_t mRunLeft;
+
+    uint64_t mCtrlFree;
+    uint32_t mMatched;
+    uint32_t mSkipped;
+    uint32_t mDiverged;
+    uint32_t mTruncated;
+    uint32_t mLate;
+};
+
+#endif /* IntelReplayTransport_hpp */
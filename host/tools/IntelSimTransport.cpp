@@ -0,0 +1,595 @@
+//
+//  IntelSimTransport.cpp
+//  IntelBluetoothFirmware host tools
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "IntelSimTransport.hpp"
+#include "IntelBluetoothOpsGen3.hpp"
+
+#include <IOKit/IOLib.h>
+#include <libkern/OSByteOrder.h>
+
+#include "IBTHost.h"
+
+#define super IntelHostTransport
+OSDefineMetaClassAndStructors(IntelSimTransport, IntelHostTransport)
+
+#define HCI_OP_INTEL_SECURE_SEND    0xfc09
+#define HCI_OP_INTEL_WRITE_DDC      0xfc8b
+#define HCI_OP_INTEL_DEBUG_FEATURES 0xfca6
+
+#define SIM_STATUS_SUCCESS          0x00
+#define SIM_STATUS_UNKNOWN_COMMAND  0x01
+#define SIM_STATUS_DISALLOWED       0x0c
+
+/* Secure send fragment types, in the order the bootloader takes them */
+#define SIM_FRAG_INIT               0x00
+#define SIM_FRAG_DATA               0x01
+#define SIM_FRAG_SIGN               0x02
+#define SIM_FRAG_PKEY               0x03
+#define SIM_FRAG_NONE               0xff
+
+/* BDADDR_INTEL, which is a C compound literal */
+static const bdaddr_t intelBdaddr = {{ 0x00, 0x8b, 0x9e, 0x19, 0x03, 0x00 }};
+
+static const IntelSimLatency defaultLatency[] = {
+    { HCI_OP_RESET,                     2000 },
+    { HCI_OP_INTEL_VERSION,             600 },
+    { HCI_OP_READ_INTEL_BOOT_PARAMS,    600 },
+    { HCI_OP_INTEL_SECURE_SEND,         900 },
+    { HCI_OP_INTEL_RESET_BOOT,          500 },
+    { HCI_OP_INTEL_ENTER_MFG,           800 },
+    { HCI_OP_INTEL_WRITE_DDC,           700 },
+    { HCI_OP_INTEL_EVENT_MASK,          600 },
+    { HCI_OP_INTEL_DEBUG_FEATURES,      600 },
+};
+
+void
+intelSimDefaults(IntelSimConfig *config)
+{
+    memset(config, 0, sizeof(*config));
+    for (size_t i = 0; i < sizeof(defaultLatency) / sizeof(defaultLatency[0]); i++)
+        config->latency[config->latencyCount++] = defaultLatency[i];
+    config->defaultUs = 500;
+    config->controlUs = 50;
+    config->bulkUs = 50;
+    config->verifyUs = 150000;
+    config->bootUs = 80000;
+    config->variant = 0x17;
+}
+
+bool
+intelSimSetLatency(IntelSimConfig *config, uint16_t opcode, uint32_t us)
+{
+    for (uint32_t i = 0; i < config->latencyCount; i++) {
+        if (config->latency[i].opcode == opcode) {
+            config->latency[i].us = us;
+            return true;
+        }
+    }
+    if (config->latencyCount == IBT_SIM_LATENCIES)
+        return false;
+    config->latency[config->latencyCount].opcode = opcode;
+    config->latency[config->latencyCount].us = us;
+    config->latencyCount++;
+    return true;
+}
+
+bool IntelSimTransport::
+initWithFirmware(const char *name, OSData *fw, const IntelSimConfig *config)
+{
+    if (!super::init())
+        return false;
+    mConfig = *config;
+    mRandom = config->seed * 2654435761U + 1;
+    mFragment = SIM_FRAG_NONE;
+    mFirmware = fw;
+    mFirmware->retain();
+    if (!identify(name)) {
+        IOLog("%s: not an Intel firmware name: %s\n", __FUNCTION__, name);
+        return false;
+    }
+    if (mGeneration == 1)
+        return parseScript();
+    return parsePayload();
+}
+
+void IntelSimTransport::
+free()
+{
+    if (m_pScript)
+        IOFree(m_pScript, sizeof(IntelSimScript) * mScriptCount);
+    OSSafeReleaseNULL(mFirmware);
+    super::free();
+}
+
+/* Works out the version and boot params the Ops turn into name */
+bool IntelSimTransport::
+identify(const char *name)
+{
+    unsigned int f[8];
+    int end = 0;
+    size_t len = strlen(name);
+
+    memset(&mVersion, 0, sizeof(mVersion));
+    mVersion.hw_platform = 0x37;
+    if (sscanf(name, "ibt-hw-%x.%x.%x-fw-%x.%x.%x.%x.%x.bseq%n",
+               &f[0], &f[1], &f[2], &f[3], &f[4], &f[5], &f[6], &f[7], &end) == 8 && (size_t)end == len) {
+        mGeneration = 1;
+        mVersion.hw_platform = f[0];
+        mVersion.hw_variant = f[1];
+        mVersion.hw_revision = f[2];
+        mVersion.fw_variant = f[3];
+        mVersion.fw_revision = f[4];
+        mVersion.fw_build_num = f[5];
+        mVersion.fw_build_ww = f[6];
+        mVersion.fw_build_yy = f[7];
+        return true;
+    }
+    /* The default patch of a platform and variant, a version that has
+     * no file of its own falls back to it.
+     */
+    if (sscanf(name, "ibt-hw-%x.%x.bseq%n", &f[0], &f[1], &end) == 2 && (size_t)end == len) {
+        mGeneration = 1;
+        mVersion.hw_platform = f[0];
+        mVersion.hw_variant = f[1];
+        return true;
+    }
+    if (sscanf(name, "ibt-%4x-%4x.sfi%n", &f[0], &f[1], &end) == 2 &&
+        (size_t)end == len && len == strlen("ibt-0000-0000.sfi")) {
+        /* Undoes INTEL_CNVX_TOP_PACK_SWAB() */
+        f[0] = OSSwapInt16((uint16_t)f[0]);
+        f[1] = OSSwapInt16((uint16_t)f[1]);
+        mGeneration = 3;
+        mCnviTop = (f[0] >> 4) | (f[0] & 0xf) << 24;
+        mCnvrTop = (f[1] >> 4) | (f[1] & 0xf) << 24;
+        mVersion.hw_variant = mConfig.variant;
+        m_pVariant = intelVariantTraits(mConfig.variant);
+        return true;
+    }
+    if (sscanf(name, "ibt-%u-%u-%u.sfi%n", &f[0], &f[1], &f[2], &end) == 3 && (size_t)end == len) {
+        mGeneration = 2;
+        mVersion.hw_variant = f[0];
+        mVersion.hw_revision = f[1];
+        mVersion.fw_revision = f[2];
+        m_pVariant = intelVariantTraits(f[0]);
+        return true;
+    }
+    if (sscanf(name, "ibt-%u-%u.sfi%n", &f[0], &f[1], &end) == 2 && (size_t)end == len) {
+        mGeneration = 2;
+        mVersion.hw_variant = f[0];
+        mDevRevid = f[1];
+        m_pVariant = intelVariantTraits(f[0]);
+        return true;
+    }
+    return false;
+}
+
+/* Same framing as compile_bseq() of scripts/zlib_compress_fw.py */
+bool IntelSimTransport::
+parseScript()
+{
+    const uint8_t *data = (const uint8_t *)mFirmware->getBytesNoCopy();
+    uint32_t len = mFirmware->getLength(), pos, count = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        pos = 0;
+        count = 0;
+        while (pos < len) {
+            uint32_t command = pos, events;
+
+            if (len - pos <= 3 || data[pos] != 0x01 || len - pos - 4 < data[pos + 3]) {
+                IOLog("%s: invalid command at %u\n", __FUNCTION__, pos);
+                return false;
+            }
+            pos += 4 + data[pos + 3];
+            events = pos;
+            while (len - pos > 2 && data[pos] == 0x02 && len - pos - 3 >= data[pos + 2])
+                pos += 3 + data[pos + 2];
+            if (pos == events) {
+                IOLog("%s: no event for the command at %u\n", __FUNCTION__, command);
+                return false;
+            }
+            if (pass) {
+                m_pScript[count].command = command + 1;
+                m_pScript[count].events = events;
+                m_pScript[count].end = pos;
+            }
+            count++;
+        }
+        if (!pass) {
+            m_pScript = (IntelSimScript *)IOMallocZero(sizeof(IntelSimScript) * (count ? count : 1));
+            if (!m_pScript)
+                return false;
+            mScriptCount = count ? count : 1;
+        }
+    }
+    mScriptCount = count;
+    return true;
+}
+
+/* The payload starts after the RSA header, and after the ECDSA one on
+ * the parts that have it. Its Intel_Write_Boot_Params names the build
+ * and the boot address.
+ */
+bool IntelSimTransport::
+parsePayload()
+{
+    const uint8_t *data = (const uint8_t *)mFirmware->getBytesNoCopy();
+    uint32_t len = mFirmware->getLength(), pos;
+
+    if (len < RSA_HEADER_LEN + HCI_COMMAND_HDR_SIZE) {
+        IOLog("%s: firmware too short (%u)\n", __FUNCTION__, len);
+        return false;
+    }
+    mPayloadOffset = RSA_HEADER_LEN;
+    if (mGeneration == 3 && data[ECDSA_OFFSET] == 0x06)
+        mPayloadOffset += ECDSA_HEADER_LEN;
+    for (pos = mPayloadOffset; len - pos >= HCI_COMMAND_HDR_SIZE; pos += HCI_COMMAND_HDR_SIZE + data[pos + 2]) {
+        if ((data[pos] | data[pos + 1] << 8) != CMD_WRITE_BOOT_PARAMS ||
+            data[pos + 2] < sizeof(struct cmd_write_boot_params) ||
+            len - pos - HCI_COMMAND_HDR_SIZE < sizeof(struct cmd_write_boot_params))
+            continue;
+        const struct cmd_write_boot_params *params =
+            (const struct cmd_write_boot_params *)(data + pos + HCI_COMMAND_HDR_SIZE);
+        mBootAddr = OSSwapLittleToHostInt32(params->boot_addr);
+        mBuild[0] = params->fw_build_num;
+        mBuild[1] = params->fw_build_ww;
+        mBuild[2] = params->fw_build_yy;
+        return true;
+    }
+    IOLog("%s: no Intel_Write_Boot_Params in the payload\n", __FUNCTION__);
+    return false;
+}
+
+uint32_t IntelSimTransport::
+random()
+{
+    /* xorshift32, the same sequence for the same seed */
+    mRandom ^= mRandom << 13;
+    mRandom ^= mRandom >> 17;
+    mRandom ^= mRandom << 5;
+    return mRandom;
+}
+
+uint64_t IntelSimTransport::
+transferTime(bool bulk)
+{
+    return (uint64_t)(bulk ? mConfig.bulkUs : mConfig.controlUs) * 1000;
+}
+
+/* The controller takes one command at a time. Returns when the one that
+ * just arrived is done with.
+ */
+uint64_t IntelSimTransport::
+serve(uint16_t opcode)
+{
+    uint64_t now = mach_absolute_time();
+    uint32_t us = mConfig.defaultUs;
+
+    for (uint32_t i = 0; i < mConfig.latencyCount; i++) {
+        if (mConfig.latency[i].opcode == opcode)
+            us = mConfig.latency[i].us;
+    }
+    if (mConfig.jitterUs)
+        us += random() % (mConfig.jitterUs + 1);
+    /* max() of libkern is 32 bits wide */
+    if (mCtrlFree < now)
+        mCtrlFree = now;
+    mCtrlFree += (uint64_t)us * 1000;
+    return mCtrlFree;
+}
+
+void IntelSimTransport::
+complete(IntelHostQueue *queue, uint64_t ready, uint16_t opcode, const void *params, uint32_t length)
+{
+    uint8_t event[IBT_HOST_EVENT_SIZE];
+
+    length = min(length, sizeof(event) - 5);
+    event[0] = HCI_EV_CMD_COMPLETE;
+    event[1] = 3 + length;
+    event[2] = 1;
+    event[3] = opcode & 0xff;
+    event[4] = opcode >> 8;
+    memcpy(event + 5, params, length);
+    push(queue, ready, event, 5 + length);
+}
+
+void IntelSimTransport::
+vendor(uint64_t ready, uint8_t sub, const void *params, uint32_t length)
+{
+    uint8_t event[IBT_HOST_EVENT_SIZE];
+
+    length = min(length, sizeof(event) - 3);
+    event[0] = 0xff;
+    event[1] = 1 + length;
+    event[2] = sub;
+    memcpy(event + 3, params, length);
+    push(&mInterrupt, ready, event, 3 + length);
+}
+
+uint32_t IntelSimTransport::
+legacyVersion(uint8_t *out)
+{
+    IntelVersion ver = mVersion;
+
+    if (mGeneration == 1) {
+        ver.fw_patch_num = mPatched ? 0x01 : 0x00;
+    } else {
+        ver.fw_variant = mOperational ? 0x23 : 0x06;
+        /* The bootloader reports its own build, never the file's */
+        if (mOperational) {
+            ver.fw_build_num = mBuild[0];
+            ver.fw_build_ww = mBuild[1];
+            ver.fw_build_yy = mBuild[2];
+        } else {
+            ver.fw_build_num = mBuild[0] + 1;
+        }
+    }
+    memcpy(out, &ver, sizeof(ver));
+    return sizeof(ver);
+}
+
+static uint32_t
+putTLV(uint8_t *out, uint8_t type, uint32_t value, uint8_t len)
+{
+    out[0] = type;
+    out[1] = len;
+    for (uint8_t i = 0; i < len; i++)
+        out[2 + i] = (uint8_t)(value >> (8 * i));
+    return 2 + len;
+}
+
+/* The answer of TyP and later, and of the JfP to CcP firmware, to Read
+ * Version with parameter 0xff. The bootloader reports the minimum build
+ * it accepts instead of a build, which is never the file's.
+ */
+uint32_t IntelSimTransport::
+tlvVersion(uint8_t *out)
+{
+    uint32_t cnviBt = (uint32_t)mVersion.hw_variant << 16 | (uint32_t)mVersion.hw_platform << 8;
+    uint32_t len = 0;
+
+    out[len++] = SIM_STATUS_SUCCESS;
+    len += putTLV(out + len, INTEL_TLV_CNVI_TOP, mCnviTop, 4);
+    len += putTLV(out + len, INTEL_TLV_CNVR_TOP, mCnvrTop, 4);
+    len += putTLV(out + len, INTEL_TLV_CNVI_BT, cnviBt, 4);
+    len += putTLV(out + len, INTEL_TLV_CNVR_BT, cnviBt, 4);
+    len += putTLV(out + len, INTEL_TLV_DEV_REV_ID, mDevRevid, 2);
+    len += putTLV(out + len, INTEL_TLV_IMAGE_TYPE, mOperational ? 0x03 : 0x01, 1);
+    len += putTLV(out + len, INTEL_TLV_TIME_STAMP, mOperational ? (mBuild[1] | mBuild[2] << 8) : 0, 2);
+    len += putTLV(out + len, INTEL_TLV_BUILD_TYPE, 0x01, 1);
+    len += putTLV(out + len, INTEL_TLV_BUILD_NUM, mOperational ? mBuild[0] : 0, 4);
+    len += putTLV(out + len, INTEL_TLV_SECURE_BOOT, 0x01, 1);
+    len += putTLV(out + len, INTEL_TLV_OTP_LOCK, 0, 1);
+    len += putTLV(out + len, INTEL_TLV_API_LOCK, 0, 1);
+    len += putTLV(out + len, INTEL_TLV_DEBUG_LOCK, 0, 1);
+    if (!mOperational) {
+        len += putTLV(out + len, INTEL_TLV_MIN_FW, 0, 3);
+        len += putTLV(out + len, INTEL_TLV_LIMITED_CCE, 0, 1);
+        len += putTLV(out + len, INTEL_TLV_SBE_TYPE, mConfig.sbeType, 1);
+    }
+    return len;
+}
+
+void IntelSimTransport::
+reject(const char *reason)
+{
+    if (!mRejection)
+        IBTTrace(&mTrace, IBT_TRACE_ERROR, "sim: download rejected\n");
+    if (!mRejection)
+        mRejection = reason;
+}
+
+/* Every fragment is compared with the part of the file it has to be, so
+ * a bring-up only completes when the Ops sent the image byte for byte.
+ */
+uint8_t IntelSimTransport::
+secureSend(const uint8_t *params, uint32_t length, uint64_t done)
+{
+    /* Indexed by the fragment type taken last */
+    static const uint8_t next[4] = { SIM_FRAG_PKEY, SIM_FRAG_DATA, SIM_FRAG_DATA, SIM_FRAG_SIGN };
+    const uint8_t *fw = (const uint8_t *)mFirmware->getBytesNoCopy();
+    bool ecdsa = mGeneration == 3 && mConfig.sbeType == 0x01;
+    uint32_t base[4], size[4];
+    uint8_t type;
+
+    if (mOperational || length < 2 || params[0] > SIM_FRAG_PKEY)
+        return SIM_STATUS_DISALLOWED;
+    type = params[0];
+    base[SIM_FRAG_INIT] = ecdsa ? ECDSA_OFFSET : 0;
+    size[SIM_FRAG_INIT] = 128;
+    base[SIM_FRAG_PKEY] = ecdsa ? ECDSA_OFFSET + 128 : 128;
+    size[SIM_FRAG_PKEY] = ecdsa ? 96 : 256;
+    base[SIM_FRAG_SIGN] = ecdsa ? ECDSA_OFFSET + 224 : 388;
+    size[SIM_FRAG_SIGN] = ecdsa ? 96 : 256;
+    base[SIM_FRAG_DATA] = mPayloadOffset;
+    size[SIM_FRAG_DATA] = mFirmware->getLength() - mPayloadOffset;
+
+    /* An Init fragment starts over */
+    if (type == SIM_FRAG_INIT && mFragment != SIM_FRAG_INIT) {
+        memset(mReceived, 0, sizeof(mReceived));
+        mDownloaded = false;
+        mRejection = NULL;
+    } else if (type != mFragment && (mFragment == SIM_FRAG_NONE || type != next[mFragment])) {
+        reject("fragment out of order");
+        return SIM_STATUS_DISALLOWED;
+    } else if (type != mFragment && mReceived[mFragment] != size[mFragment]) {
+        reject("short header fragment");
+        return SIM_STATUS_DISALLOWED;
+    }
+    mFragment = type;
+    length--;
+    params++;
+    if (length > size[type] - mReceived[type] ||
+        memcmp(params, fw + base[type] + mReceived[type], length)) {
+        reject(type == SIM_FRAG_DATA ? "payload does not match the file" : "header does not match the file");
+        return SIM_STATUS_DISALLOWED;
+    }
+    mReceived[type] += length;
+    if (type == SIM_FRAG_DATA && mReceived[type] == size[type] && !mRejection) {
+        uint8_t result[4] = { 0x00, HCI_OP_INTEL_SECURE_SEND & 0xff, HCI_OP_INTEL_SECURE_SEND >> 8, 0x00 };
+
+        mDownloaded = true;
+        vendor(done + (uint64_t)mConfig.verifyUs * 1000, 0x06, result, sizeof(result));
+    }
+    return SIM_STATUS_SUCCESS;
+}
+
+/* Never answered with a Command Complete: a hard reset drops back to the
+ * bootloader, a soft one from the bootloader boots the downloaded image
+ * if the address is the one the image asked for.
+ */
+void IntelSimTransport::
+intelReset(const uint8_t *params, uint32_t length, uint64_t done)
+{
+    IntelReset reset;
+
+    if (length < sizeof(reset))
+        return;
+    memcpy(&reset, params, sizeof(reset));
+    if (reset.reset_type == 0x01 || mGeneration == 1) {
+        mOperational = mGeneration == 1;
+        mMfg = false;
+        mDownloaded = false;
+        mFragment = SIM_FRAG_NONE;
+        return;
+    }
+    if (mOperational)
+        return;
+    if (!mDownloaded) {
+        reject("boot without a complete download");
+        return;
+    }
+    /* SfP and WsP are booted with 0, the Ops never look their address up
+     * (versionCheck), and start from the one of the image.
+     */
+    uint32_t bootParam = OSSwapLittleToHostInt32(reset.boot_param);
+    if (!bootParam && m_pVariant && !m_pVariant->versionCheck)
+        bootParam = mBootAddr;
+    if (reset.boot_option == 0x01 && bootParam != mBootAddr) {
+        reject("boot address is not the image's");
+        return;
+    }
+    uint8_t bootup[6] = { 0x00, 0x01, 0x00, reset.reset_type, 0x00, 0x00 };
+    mOperational = true;
+    mFragment = SIM_FRAG_NONE;
+    vendor(done + (uint64_t)mConfig.bootUs * 1000, 0x02, bootup, sizeof(bootup));
+}
+
+void IntelSimTransport::
+command(const uint8_t *packet, uint32_t length, bool bulk)
+{
+    uint8_t reply[IBT_HOST_EVENT_SIZE];
+    uint32_t len = 1;
+    IntelHostQueue *queue = &mInterrupt;
+    uint16_t opcode;
+    const uint8_t *params;
+    uint64_t done;
+
+    if (length < HCI_COMMAND_HDR_SIZE)
+        return;
+    opcode = packet[0] | packet[1] << 8;
+    params = packet + HCI_COMMAND_HDR_SIZE;
+    length = min(length - HCI_COMMAND_HDR_SIZE, (uint32_t)packet[2]);
+    mCommands++;
+    /* Bulk is ACL data to operational firmware. The bootloader answers
+     * secure send on bulk, anything else on the event channel unless it
+     * was configured to route it.
+     */
+    if (bulk) {
+        if (mOperational)
+            return;
+        if (opcode == HCI_OP_INTEL_SECURE_SEND || mConfig.bulkRoute)
+            queue = &mBulk;
+    }
+    done = serve(opcode);
+    reply[0] = SIM_STATUS_SUCCESS;
+
+    if (opcode == HCI_OP_INTEL_RESET_BOOT) {
+        intelReset(params, length, done);
+        return;
+    }
+    if (mGeneration == 1 && mMfg && mScriptPos < mScriptCount &&
+        opcode != HCI_OP_INTEL_ENTER_MFG) {
+        const uint8_t *data = (const uint8_t *)mFirmware->getBytesNoCopy();
+        const IntelSimScript *step = &m_pScript[mScriptPos];
+
+        if (opcode == (data[step->command] | data[step->command + 1] << 8) &&
+            length == data[step->command + 2] && !memcmp(params, data + step->command + 3, length)) {
+            mScriptPos++;
+            if (mConfig.loss && random() < mConfig.loss * 4294967296.0) {
+                mLost++;
+                return;
+            }
+            for (uint32_t pos = step->events; pos < step->end; pos += 3 + data[pos + 2])
+                push(queue, done, data + pos + 1, 2 + data[pos + 2]);
+            return;
+        }
+    }
+    switch (opcode) {
+        case HCI_OP_RESET:
+        case HCI_OP_INTEL_EVENT_MASK:
+            break;
+        case HCI_OP_INTEL_VERSION:
+            if (length && params[0] == 0xff &&
+                (mGeneration == 3 || (mOperational && m_pVariant && m_pVariant->tlvVersion)))
+                len = tlvVersion(reply);
+            else
+                len = legacyVersion(reply);
+            break;
+        case HCI_OP_READ_INTEL_BOOT_PARAMS:
+            if (mOperational || mGeneration == 1) {
+                reply[0] = SIM_STATUS_UNKNOWN_COMMAND;
+                break;
+            } else {
+                IntelBootParams boot;
+
+                memset(&boot, 0, sizeof(boot));
+                boot.dev_revid = OSSwapHostToLittleInt16(mDevRevid);
+                boot.secure_boot = 0x01;
+                boot.otp_bdaddr = intelBdaddr;
+                memcpy(reply, &boot, sizeof(boot));
+                len = sizeof(boot);
+            }
+            break;
+        case HCI_OP_INTEL_DEBUG_FEATURES:
+            if (!mOperational || mGeneration == 1) {
+                reply[0] = SIM_STATUS_UNKNOWN_COMMAND;
+                break;
+            }
+            /* Status, page number, max page, then the page */
+            memset(reply, 0, 3 + sizeof(IntelDebugFeatures));
+            reply[1] = 0x01;
+            reply[2] = 0x01;
+            reply[3] = 0x3f;
+            len = 3 + sizeof(IntelDebugFeatures);
+            break;
+        case HCI_OP_INTEL_ENTER_MFG:
+            if (length >= 2 && params[0] == 0x00 && params[1] == 0x02 && mScriptPos == mScriptCount)
+                mPatched = mScriptCount > 0;
+            if (length >= 1) {
+                mMfg = params[0] == 0x01;
+                mScriptPos = 0;
+            }
+            break;
+        case HCI_OP_INTEL_SECURE_SEND:
+            reply[0] = secureSend(params, length, done);
+            break;
+        case HCI_OP_INTEL_WRITE_DDC:
+            if (!mOperational)
+                reply[0] = SIM_STATUS_DISALLOWED;
+            break;
+        default:
+            reply[0] = SIM_STATUS_UNKNOWN_COMMAND;
+            break;
+    }
+    if (mConfig.loss && random() < mConfig.loss * 4294967296.0) {
+        mLost++;
+        return;
+    }
+    complete(queue, done, opcode, reply, len);
+}
@@ -0,0 +1,160 @@
+//
+//  IntelSimTransport.hpp
+//  IntelBluetoothFirmware host tools
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef IntelSimTransport_hpp
+#define IntelSimTransport_hpp
+
+#include "IntelHostTransport.hpp"
+
+#define IBT_SIM_LATENCIES       16
+
+struct IntelSimLatency {
+    uint16_t opcode;
+    uint32_t us;
+};
+
+/* How the simulated controller behaves, all times in us */
+struct IntelSimConfig {
+    IntelSimLatency latency[IBT_SIM_LATENCIES];
+    uint32_t latencyCount;
+    /* Service time of opcodes not in latency */
+    uint32_t defaultUs;
+    /* Added to every service time, uniform in [0, jitterUs] */
+    uint32_t jitterUs;
+    /* Per transfer on each channel, before the controller sees it */
+    uint32_t controlUs;
+    uint32_t bulkUs;
+    /* Last data fragment to the 0xff/0x06 download notification */
+    uint32_t verifyUs;
+    /* Intel Reset to the 0xff/0x02 boot notification */
+    uint32_t bootUs;
+    /* Probability that a command is never answered */
+    double loss;
+    uint32_t seed;
+    /* Hardware variant of a TLV part, its cnvi_bt */
+    uint8_t variant;
+    /* Secure boot engine of a TLV part, 1 takes the ECDSA header */
+    uint8_t sbeType;
+    /* The bootloader answers its idempotent commands on bulk when they
+     * come in on bulk, otherwise on the event channel.
+     */
+    bool bulkRoute;
+};
+
+/* Service times measured on JfP and TyP, see btsnoop_stats.py */
+void intelSimDefaults(IntelSimConfig *config);
+
+bool intelSimSetLatency(IntelSimConfig *config, uint16_t opcode, uint32_t us);
+
+/* One command of a gen1 .bseq and the events it is answered with */
+struct IntelSimScript {
+    uint32_t command;
+    uint32_t events;
+    uint32_t end;
+};
+
+/* A controller modelled after one firmware file, behind the transport
+ * BtIntel and the Ops classes talk to. The identity it reports is the
+ * one the Ops derive that file's name from, so a bring-up loads exactly
+ * that file, through the same code as in the kext:
+ * - gen1 answers the .bseq commands with the events the file expects;
+ * - gen2 and gen3 run the secure send state machine, compare every
+ *   fragment with the file and only notify the end of the download once
+ *   all of it arrived intact;
+ * - the boot address of the Intel Reset must be the file's.
+ */
+class IntelSimTransport : public IntelHostTransport {
+    OSDeclareDefaultStructors(IntelSimTransport)
+
+public:
+
+    /* name is the firmware file the controller is modelled after, fw its
+     * contents as on disk.
+     */
+    virtual bool initWithFirmware(const char *name, OSData *fw, const IntelSimConfig *config);
+
+    virtual void free() override;
+
+    uint8_t getGeneration() { return mGeneration; }
+
+    bool isOperational() { return mOperational; }
+
+    /* Why the last download was not accepted, NULL if it was */
+    const char *getRejection() { return mRejection; }
+
+    uint32_t getCommands() { return mCommands; }
+
+    uint32_t getLost() { return mLost; }
+
+protected:
+
+    void command(const uint8_t *packet, uint32_t length, bool bulk) override;
+
+    uint64_t transferTime(bool bulk) override;
+
+private:
+
+    bool identify(const char *name);
+
+    bool parseScript();
+
+    bool parsePayload();
+
+    uint32_t random();
+
+    uint64_t serve(uint16_t opcode);
+
+    void complete(IntelHostQueue *queue, uint64_t ready, uint16_t opcode, const void *params, uint32_t length);
+
+    void vendor(uint64_t ready, uint8_t sub, const void *params, uint32_t length);
+
+    uint32_t legacyVersion(uint8_t *out);
+
+    uint32_t tlvVersion(uint8_t *out);
+
+    uint8_t secureSend(const uint8_t *params, uint32_t length, uint64_t done);
+
+    void intelReset(const uint8_t *params, uint32_t length, uint64_t done);
+
+    void reject(const char *reason);
+
+private:
+    IntelSimConfig mConfig;
+    OSData *mFirmware;
+    uint8_t mGeneration;
+    const IntelVariantTraits *m_pVariant;
+    IntelVersion mVersion;
+    uint16_t mDevRevid;
+    uint32_t mCnviTop;
+    uint32_t mCnvrTop;
+
+    /* The build the firmware file carries and where it boots from */
+    uint8_t mBuild[3];
+    uint32_t mBootAddr;
+    uint32_t mPayloadOffset;
+
+    IntelSimScript *m_pScript;
+    uint32_t mScriptCount;
+    uint32_t mScriptPos;
+
+    bool mOperational;
+    bool mMfg;
+    bool mPatched;
+    /* Secure send: fragment type expected next, bytes taken per type */
+    uint8_t mFragment;
+    uint32_t mReceived[4];
+    bool mDownloaded;
+    const char *mRejection;
+
+    uint64_t mCtrlFree;
+    uint32_t mRandom;
+    uint32_t mCommands;
+    uint32_t mLost;
+};
+
+#endif /* IntelSimTransport_hpp */
@@ -0,0 +1,269 @@
+//
+//  ibt_bench.cpp
+//  IntelBluetoothFirmware host tools
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+/* CPU side of the firmware paths over every image compiled into ibtcore,
+ * as Google Benchmark cases:
+ *   parse_version_tlv       parseVersionTLV() of a 0040-0041 response
+ *   lookup/<image>          getFWDescByName()
+ *   inflate/<image>         getFWDescByName() and firmwareConvertion()
+ *   firmware_version/<sfi>  firmwareVersion()
+ *   payload/<sfi>           downloadFirmwarePayload()
+ *   patch_table/<bseq|ddc>  patching() of gen1, intelSendPatchTable() of gen3
+ * Commands go to an IntelNullTransport, so nothing waits. allocs is the
+ * IOMalloc() calls per iteration. The usual Google Benchmark options
+ * apply, e.g.
+ *   ibt_bench --benchmark_filter=payload --benchmark_format=json
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <IOKit/IOLib.h>
+
+#include "IBTHost.h"
+#include "IntelBluetoothOpsGen1.hpp"
+#include "IntelBluetoothOpsGen3.hpp"
+#include "IntelNullTransport.hpp"
+#include "FwData.h"
+
+/* The Ops with what the benchmarks call made reachable */
+class BenchOpsGen1 : public IntelBluetoothOpsGen1 {
+    OSDeclareDefaultStructors(BenchOpsGen1)
+
+public:
+    using IntelBluetoothOpsGen1::patching;
+};
+
+OSDefineMetaClassAndStructors(BenchOpsGen1, IntelBluetoothOpsGen1)
+
+class BenchOpsGen3 : public IntelBluetoothOpsGen3 {
+    OSDeclareDefaultStructors(BenchOpsGen3)
+
+public:
+    using IntelBluetoothOpsGen3::parseVersionTLV;
+    using IntelBluetoothOpsGen3::firmwareVersion;
+    using IntelBluetoothOpsGen3::downloadFirmwarePayload;
+    using IntelBluetoothOpsGen3::patchTableHeader;
+    using IntelBluetoothOpsGen3::intelSendPatchTable;
+};
+
+OSDefineMetaClassAndStructors(BenchOpsGen3, IntelBluetoothOpsGen3)
+
+/* A TLV version response as read from a 0040-0041 part, status byte
+ * first.
+ */
+static const uint8_t benchVersionTLV[] = {
+    0x00,
+    INTEL_TLV_CNVI_TOP, 4, 0x00, 0x04, 0x00, 0x00,
+    INTEL_TLV_CNVR_TOP, 4, 0x10, 0x04, 0x00, 0x00,
+    INTEL_TLV_CNVI_BT, 4, 0x00, 0x11, 0x00, 0x00,
+    INTEL_TLV_CNVR_BT, 4, 0x00, 0x11, 0x00, 0x00,
+    INTEL_TLV_DEV_REV_ID, 2, 0x00, 0x00,
+    INTEL_TLV_IMAGE_TYPE, 1, 0x01,
+    INTEL_TLV_TIME_STAMP, 2, 0x33, 0x16,
+    INTEL_TLV_BUILD_TYPE, 1, 0x01,
+    INTEL_TLV_BUILD_NUM, 4, 0x00, 0x00, 0x01, 0x00,
+    INTEL_TLV_SECURE_BOOT, 1, 0x01,
+    INTEL_TLV_OTP_LOCK, 1, 0x00,
+    INTEL_TLV_API_LOCK, 1, 0x00,
+    INTEL_TLV_DEBUG_LOCK, 1, 0x00,
+    INTEL_TLV_MIN_FW, 3, 0x00, 0x00, 0x00,
+    INTEL_TLV_LIMITED_CCE, 1, 0x00,
+    INTEL_TLV_SBE_TYPE, 1, 0x01,
+    INTEL_TLV_OTP_BDADDR, 6, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+static IntelNullTransport *transport;
+static BenchOpsGen1 *gen1;
+static BenchOpsGen3 *gen3;
+
+static bool
+hasSuffix(const char *name, const char *suffix)
+{
+    size_t len = strlen(name), slen = strlen(suffix);
+
+    return len >= slen && !strcmp(name + len - slen, suffix);
+}
+
+static OSData *
+inflate(const char *name)
+{
+    OSData *compressed = getFWDescByName(name);
+    OSData *fw = compressed ? gen3->firmwareConvertion(compressed) : NULL;
+
+    OSSafeReleaseNULL(compressed);
+    return fw;
+}
+
+static void
+countAllocs(benchmark::State &state, uint64_t before)
+{
+    state.counters["allocs"] = benchmark::Counter((double)(IBTHostAllocations() - before),
+                                                  benchmark::Counter::kAvgIterations);
+}
+
+static void
+benchParseVersionTLV(benchmark::State &state)
+{
+    IntelVersionTLV tlv;
+    uint64_t allocs = IBTHostAllocations();
+
+    for (auto _ : state) {
+        gen3->parseVersionTLV(&tlv, benchVersionTLV, sizeof(benchVersionTLV));
+        benchmark::DoNotOptimize(tlv);
+    }
+    state.SetBytesProcessed((int64_t)state.iterations() * sizeof(benchVersionTLV));
+    countAllocs(state, allocs);
+}
+
+static void
+benchLookup(benchmark::State &state, const char *name)
+{
+    uint64_t allocs = IBTHostAllocations();
+
+    for (auto _ : state) {
+        OSData *compressed = getFWDescByName(name);
+        benchmark::DoNotOptimize(compressed);
+        OSSafeReleaseNULL(compressed);
+    }
+    countAllocs(state, allocs);
+}
+
+static void
+benchInflate(benchmark::State &state, const char *name)
+{
+    uint64_t allocs = IBTHostAllocations(), bytes = 0;
+
+    for (auto _ : state) {
+        OSData *fw = inflate(name);
+        if (!fw) {
+            state.SkipWithError("does not inflate");
+            break;
+        }
+        bytes += fw->getLength();
+        fw->release();
+    }
+    state.SetBytesProcessed((int64_t)bytes);
+    countAllocs(state, allocs);
+}
+
+static void
+benchFirmwareVersion(benchmark::State &state, const char *name)
+{
+    OSData *fw = inflate(name);
+    uint32_t bootAddr;
+    uint64_t allocs;
+
+    if (!fw || fw->getLength() <= RSA_HEADER_LEN) {
+        state.SkipWithError("not a secure send image");
+        OSSafeReleaseNULL(fw);
+        return;
+    }
+    allocs = IBTHostAllocations();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(gen3->firmwareVersion(0, 0, 0, fw, &bootAddr));
+    state.SetBytesProcessed((int64_t)state.iterations() * fw->getLength());
+    countAllocs(state, allocs);
+    fw->release();
+}
+
+static void
+benchPayload(benchmark::State &state, const char *name)
+{
+    OSData *fw = inflate(name);
+    size_t offset = RSA_HEADER_LEN;
+    uint64_t allocs;
+
+    if (!fw || fw->getLength() <= RSA_HEADER_LEN) {
+        state.SkipWithError("not a secure send image");
+        OSSafeReleaseNULL(fw);
+        return;
+    }
+    if (fw->getLength() > ECDSA_OFFSET + ECDSA_HEADER_LEN &&
+        ((const uint8_t *)fw->getBytesNoCopy())[ECDSA_OFFSET] == 0x06)
+        offset += ECDSA_HEADER_LEN;
+    allocs = IBTHostAllocations();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(gen3->downloadFirmwarePayload(fw, offset));
+    state.SetBytesProcessed((int64_t)state.iterations() * (fw->getLength() - offset));
+    countAllocs(state, allocs);
+    fw->release();
+}
+
+static void
+benchPatchTable(benchmark::State &state, const char *name)
+{
+    OSData *fw = inflate(name);
+    const IntelPatchTableHdr *hdr = fw ? gen3->patchTableHeader(fw) : NULL;
+    bool bseq = hasSuffix(name, ".bseq"), disablePatch;
+    uint64_t allocs;
+    uint32_t commands;
+
+    if (!hdr) {
+        state.SkipWithError("no patch table");
+        OSSafeReleaseNULL(fw);
+        return;
+    }
+    allocs = IBTHostAllocations();
+    commands = transport->commands;
+    for (auto _ : state) {
+        if (bseq)
+            benchmark::DoNotOptimize(gen1->patching(fw, &disablePatch));
+        else
+            benchmark::DoNotOptimize(gen3->intelSendPatchTable(hdr, true, HCI_INIT_TIMEOUT));
+    }
+    state.SetBytesProcessed((int64_t)state.iterations() * fw->getLength());
+    state.counters["commands"] = benchmark::Counter(transport->commands - commands,
+                                                    benchmark::Counter::kAvgIterations);
+    countAllocs(state, allocs);
+    fw->release();
+}
+
+int
+main(int argc, char **argv)
+{
+    IBTHostSetLog(NULL);
+    if (IBT_FW_RESOURCE_DIR[0])
+        IBTHostSetResourceDir(IBT_FW_RESOURCE_DIR, 0);
+
+    transport = new IntelNullTransport;
+    gen1 = new BenchOpsGen1;
+    gen3 = new BenchOpsGen3;
+    if (!transport->init() || !gen1->initWithTransport(transport) || !gen3->initWithTransport(transport)) {
+        fprintf(stderr, "cannot create the Ops\n");
+        return 2;
+    }
+
+    benchmark::RegisterBenchmark("parse_version_tlv", benchParseVersionTLV);
+    for (int n = 0; n < fwNumber; n++) {
+        const char *name = fwList[n].name;
+
+        if (!fwList[n].var)
+            continue;
+        benchmark::RegisterBenchmark(("lookup/" + std::string(name)).c_str(), benchLookup, name);
+        benchmark::RegisterBenchmark(("inflate/" + std::string(name)).c_str(), benchInflate, name);
+        if (hasSuffix(name, ".sfi")) {
+            benchmark::RegisterBenchmark(("firmware_version/" + std::string(name)).c_str(),
+                                         benchFirmwareVersion, name);
+            benchmark::RegisterBenchmark(("payload/" + std::string(name)).c_str(), benchPayload, name);
+        } else if (hasSuffix(name, ".bseq") || hasSuffix(name, ".ddc")) {
+            benchmark::RegisterBenchmark(("patch_table/" + std::string(name)).c_str(), benchPatchTable, name);
+        }
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 2;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    gen3->release();
+    gen1->release();
+    transport->release();
+    return 0;
+}
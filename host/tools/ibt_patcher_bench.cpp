@@ -0,0 +1,294 @@
+//
+//  ibt_patcher_bench.cpp
+//  IntelBluetoothFirmware host tools
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+/* What the completion hook of IntelBTPatcher adds to each event of a
+ * hooked Intel interrupt pipe, as Google Benchmark cases run on the
+ * plugin's own asyncIOCompletion():
+ *   event/<kind>/telemetry:N     one event of that kind
+ *   traffic/<load>/telemetry:N   one second of that load, so the time
+ *                                per iteration is the CPU time the hook
+ *                                takes per second of it
+ * with ibttelemetry off (0) and on (1), and what its newAsyncIO() adds
+ * to a transfer on any other pipe, against the original alone:
+ *   foreign/original             the original asyncIO, a no-op here
+ *   foreign/hooked:N             newAsyncIO() on pipes that are not
+ *                                hooked, with N pipes hooked
+ * allocs is the IOMalloc() calls per iteration. readBytes() of the host is a plain memcpy(), so this is
+ * the hook's own work, without the descriptor's copy of the kernel. The
+ * usual Google Benchmark options apply, e.g.
+ *   ibt_patcher_bench --benchmark_filter=traffic
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+#include <IOKit/IOLib.h>
+#include <IOKit/usb/IOUSBHost.h>
+
+#include "IBTHost.h"
+#include "IntelBTPatcher.hpp"
+
+/* The plugin with what the benchmarks call made reachable */
+class BenchPatcher : public CIntelBTPatcher {
+public:
+    using CIntelBTPatcher::AsyncOwnerData;
+    using CIntelBTPatcher::oldAsyncIO;
+    using CIntelBTPatcher::_telemetryEnabled;
+    using CIntelBTPatcher::_telemetryCall;
+    using CIntelBTPatcher::telemetryPublish;
+    using CIntelBTPatcher::hookPipe;
+    using CIntelBTPatcher::unhookPipe;
+    using CIntelBTPatcher::hookedPipe;
+    using CIntelBTPatcher::asyncIOCompletion;
+    using CIntelBTPatcher::newAsyncIO;
+};
+
+struct BenchEvent {
+    const char *name;
+    uint8_t bytes[64];
+    uint32_t length;
+};
+
+/* As read from the interrupt pipe, connection 0x0040 throughout */
+static const BenchEvent benchEvents[] = {
+    { "num_comp_pkts", { 0x13, 0x05, 0x01, 0x40, 0x00, 0x01, 0x00 }, 7 },
+    { "cmd_complete", { 0x0E, 0x04, 0x01, 0x03, 0x0C, 0x00 }, 6 },
+    { "le_adv_report", { 0x3E, 0x1B, 0x02, 0x01, 0x00, 0x01, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x0F,
+                         0x02, 0x01, 0x06, 0x0B, 0x09, 'I', 'B', 'T', ' ', 'b', 'e', 'n', 'c', 'h', '!',
+                         0xC4 }, 29 },
+    { "le_conn_complete", { 0x3E, 0x13, 0x01, 0x00, 0x40, 0x00, 0x00, 0x01, 0x11, 0x22, 0x33, 0x44, 0x55,
+                            0x66, 0x18, 0x00, 0x00, 0x00, 0xC8, 0x00, 0x00 }, 21 },
+    { "le_remote_features", { 0x3E, 0x0C, 0x04, 0x00, 0x40, 0x00, 0xFF, 0x49, 0x01, 0x00, 0x00, 0x00,
+                              0x00, 0x00 }, 14 },
+    { "disconn_complete", { 0x05, 0x04, 0x00, 0x40, 0x00, 0x13 }, 6 },
+    { "vendor_diagnostics", { 0xFF, 0x0C, 0x87, 0x80, 0x03, 0x01, 0x01, 0x01, 0x02, 0x04, 0xEF, 0xBE,
+                              0xAD, 0xDE }, 14 },
+};
+
+enum {
+    kNumCompPkts,
+    kCmdComplete,
+    kLeAdvReport,
+    kLeConnComplete,
+    kLeRemoteFeatures,
+    kDisconnComplete,
+    kVendorDiagnostics,
+    kBenchEvents
+};
+
+/* Events per second of each load */
+struct BenchLoad {
+    const char *name;
+    uint32_t counts[kBenchEvents];
+};
+
+static const BenchLoad benchLoads[] = {
+    /* Audio to a headset, a completed packet each 2-DH5 */
+    { "a2dp", { 400, 0, 0, 0, 0, 0, 0 } },
+    /* Scanning in a crowded room */
+    { "le_scan", { 0, 0, 3000, 0, 0, 0, 0 } },
+    /* Both, with an LE device connecting every 100 ms, its remote
+     * features read twice and the second answer replaced by the fake
+     * PHY update
+     */
+    { "busy", { 400, 20, 3000, 10, 20, 10, 0 } },
+};
+
+static BenchPatcher patcher;
+static IOUSBHostDevice *device;
+static uint8_t pipe[64] __attribute__((aligned(16)));
+static BenchPatcher::AsyncOwnerData *owner;
+static IOMemoryDescriptor *descriptors[kBenchEvents];
+static uint8_t buffers[kBenchEvents][64];
+
+/* Pipes of other devices, more than a cache holds the lines of */
+#define FOREIGN_PIPES 1024
+static uint8_t foreignPipes[FOREIGN_PIPES][64] __attribute__((aligned(16)));
+static uint8_t otherPipes[HOOKED_PIPES_MAX - 1][64] __attribute__((aligned(16)));
+
+static void
+benchAction(void *owner, void *parameter, IOReturn status, uint32_t bytesTransferred)
+{
+    benchmark::DoNotOptimize(bytesTransferred);
+}
+
+static void
+countAllocs(benchmark::State &state, uint64_t before)
+{
+    state.counters["allocs"] = benchmark::Counter((double)(IBTHostAllocations() - before),
+                                                  benchmark::Counter::kAvgIterations);
+}
+
+/* What newAsyncIO() leaves in the owner for a transfer, then its
+ * completion. The fake PHY update overwrites the buffer, which is put
+ * back after it for the next connection.
+ */
+static inline void
+complete(int kind)
+{
+    owner->dataBuffer = descriptors[kind];
+    BenchPatcher::asyncIOCompletion(owner, nullptr, kIOReturnSuccess, benchEvents[kind].length);
+    if (kind == kLeRemoteFeatures && buffers[kind][2] != benchEvents[kind].bytes[2])
+        memcpy(buffers[kind], benchEvents[kind].bytes, benchEvents[kind].length);
+}
+
+static void
+benchEvent(benchmark::State &state, int kind)
+{
+    uint64_t allocs = IBTHostAllocations();
+
+    BenchPatcher::_telemetryEnabled = state.range(0) != 0;
+    for (auto _ : state)
+        complete(kind);
+    BenchPatcher::_telemetryEnabled = false;
+    state.SetItemsProcessed(state.iterations());
+    countAllocs(state, allocs);
+}
+
+static IOReturn
+originalAsyncIO(void *that, IOMemoryDescriptor *dataBuffer, uint32_t bytesTransferred,
+                IOUSBHostCompletion *completion, uint32_t completionTimeoutMs)
+{
+    benchmark::DoNotOptimize(that);
+    return kIOReturnSuccess;
+}
+
+static void
+benchOriginal(benchmark::State &state)
+{
+    IOReturn (* volatile asyncIO)(void *, IOMemoryDescriptor *, uint32_t, IOUSBHostCompletion *,
+                                  uint32_t) = originalAsyncIO;
+    IOUSBHostCompletion completion = { nullptr, benchAction, nullptr };
+    uint32_t next = 0;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(asyncIO(foreignPipes[next], nullptr, 64, &completion, 0));
+        next = (next + 1) % FOREIGN_PIPES;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/* The pipe of the bench stays hooked, the others fill the table up to
+ * N. hooked is 1 if newAsyncIO() took any of the foreign pipes for a
+ * hooked one and replaced the completion.
+ */
+static void
+benchForeign(benchmark::State &state)
+{
+    IOUSBHostCompletion completion = { nullptr, benchAction, nullptr };
+    int others = (int)state.range(0) - 1;
+    uint64_t allocs;
+    uint32_t next = 0;
+
+    for (int i = 0; i < others; i++)
+        BenchPatcher::hookPipe(otherPipes[i], nullptr);
+    allocs = IBTHostAllocations();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(BenchPatcher::newAsyncIO(foreignPipes[next], nullptr, 64, &completion, 0));
+        next = (next + 1) % FOREIGN_PIPES;
+    }
+    for (int i = 0; i < others; i++)
+        BenchPatcher::unhookPipe(otherPipes[i]);
+    state.SetItemsProcessed(state.iterations());
+    state.counters["hooked"] = completion.action != benchAction;
+    countAllocs(state, allocs);
+}
+
+/* A connection runs complete, remote features twice, disconnect in
+ * order, the rest is spread evenly over the second.
+ */
+static void
+benchTraffic(benchmark::State &state, const BenchLoad *load)
+{
+    std::vector<int> second;
+    uint32_t left[kBenchEvents], total = 0;
+    uint64_t allocs;
+
+    for (int kind = 0; kind < kBenchEvents; kind++)
+        total += left[kind] = load->counts[kind];
+    while (second.size() < total) {
+        for (int kind = 0; kind < kBenchEvents; kind++) {
+            if (!left[kind] || kind == kLeRemoteFeatures || kind == kDisconnComplete)
+                continue;
+            left[kind]--;
+            second.push_back(kind);
+            if (kind == kLeConnComplete) {
+                second.push_back(kLeRemoteFeatures);
+                second.push_back(kLeRemoteFeatures);
+                second.push_back(kDisconnComplete);
+                left[kLeRemoteFeatures] -= 2;
+                left[kDisconnComplete]--;
+            }
+        }
+    }
+
+    allocs = IBTHostAllocations();
+    BenchPatcher::_telemetryEnabled = state.range(0) != 0;
+    for (auto _ : state) {
+        for (int kind : second)
+            complete(kind);
+    }
+    BenchPatcher::_telemetryEnabled = false;
+    state.SetItemsProcessed((int64_t)state.iterations() * second.size());
+    countAllocs(state, allocs);
+}
+
+int
+main(int argc, char **argv)
+{
+    StandardUSB::DeviceDescriptor intel = { 18, 1, 0x0200, 0xE0, 0x01, 0x01, 64, 0x8087, 0x0026, 0x0002,
+                                            0, 0, 0, 1 };
+
+    IBTHostSetLog(NULL);
+    patcher.init();
+    /* As ibttelemetry=1 would, the pipe is hooked with telemetry on and
+     * each benchmark turns it off or leaves it on.
+     */
+    BenchPatcher::_telemetryCall = thread_call_allocate(BenchPatcher::telemetryPublish, nullptr);
+    BenchPatcher::_telemetryEnabled = BenchPatcher::_telemetryCall != nullptr;
+    device = IOUSBHostDevice::withDescriptor(&intel);
+    for (int kind = 0; kind < kBenchEvents; kind++) {
+        memcpy(buffers[kind], benchEvents[kind].bytes, benchEvents[kind].length);
+        descriptors[kind] = IOMemoryDescriptor::withAddress(buffers[kind], sizeof(buffers[kind]), kIODirectionIn);
+    }
+    if (!device || !BenchPatcher::hookPipe(pipe, device) || !(owner = BenchPatcher::hookedPipe(pipe))) {
+        fprintf(stderr, "cannot hook the pipe\n");
+        return 2;
+    }
+    owner->action = benchAction;
+    BenchPatcher::_telemetryEnabled = false;
+    patcher.oldAsyncIO = reinterpret_cast<mach_vm_address_t>(originalAsyncIO);
+
+    for (int kind = 0; kind < kBenchEvents; kind++) {
+        /* Alone, the second one would be replaced and the rest not */
+        if (kind == kLeRemoteFeatures)
+            continue;
+        benchmark::RegisterBenchmark(("event/" + std::string(benchEvents[kind].name)).c_str(), benchEvent, kind)
+            ->ArgName("telemetry")->Arg(0)->Arg(1);
+    }
+    for (const BenchLoad &load : benchLoads) {
+        benchmark::RegisterBenchmark(("traffic/" + std::string(load.name)).c_str(), benchTraffic, &load)
+            ->ArgName("telemetry")->Arg(0)->Arg(1);
+    }
+    benchmark::RegisterBenchmark("foreign/original", benchOriginal);
+    benchmark::RegisterBenchmark("foreign", benchForeign)->ArgName("hooked")->Arg(1)->Arg(HOOKED_PIPES_MAX);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 2;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    BenchPatcher::unhookPipe(pipe);
+    for (int kind = 0; kind < kBenchEvents; kind++)
+        OSSafeReleaseNULL(descriptors[kind]);
+    device->release();
+    patcher.deinit();
+    return 0;
+}
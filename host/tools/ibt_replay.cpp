@@ -0,0 +1,258 @@
+//
+//  ibt_replay.cpp
+//  IntelBluetoothFirmware host tools
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+/* Runs the setup() of the Ops class against the controller of a recorded
+ * bring-up (IntelReplayTransport), the hci_snoop property of the kext or
+ * a capture of ibt_sim -o, e.g.
+ *   ibt_replay setup.btsnoop
+ *   ibt_replay setup.btsnoop --bulk-scale 0.8 --ctrl-scale 1.2
+ * It runs twice: once as recorded, the baseline, and once with the
+ * controller's service times scaled, then prints the time per
+ * IntelTimeline phase of both. The result only depends on the capture,
+ * the options and the code under test, so two runs on any machine give
+ * the same numbers.
+ *
+ * The generation of the Ops follows from the capture (--gen overrides
+ * it), the firmware the Ops load is the one compiled into ibtcore, as
+ * for ibt_sim. The kext keeps 32 bytes per packet by default and folds
+ * secure send runs: the replay pads what was cut short with zeros and
+ * spreads a run evenly over its fragments. Raise ibtsnaplen for gen3,
+ * whose TLV version is longer than that.
+ * The exit status is 0 when both runs loaded the firmware without a
+ * command the capture does not have.
+ */
+
+#include <stdlib.h>
+#include <IOKit/IOLib.h>
+#include <libkern/c++/OSArray.h>
+#include <libkern/c++/OSDictionary.h>
+#include <libkern/c++/OSNumber.h>
+#include <libkern/c++/OSString.h>
+
+#include "IBTHost.h"
+#include "IntelHostTool.hpp"
+#include "IntelReplayTransport.hpp"
+
+static void
+usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s <capture.btsnoop> [--ctrl-scale F] [--bulk-scale F] [--bulk-route]\n"
+            "       [--gen N] [--budget ms] [-v]\n", prog);
+    exit(2);
+}
+
+struct ReplayRun {
+    bool loaded;
+    uint64_t totalUs;
+    uint32_t matched;
+    uint32_t skipped;
+    uint32_t diverged;
+    uint32_t truncated;
+    uint32_t late;
+    OSArray *phases;
+};
+
+static uint64_t
+phaseUs(OSArray *phases, const char *name)
+{
+    for (unsigned int i = 0; phases && i < phases->getCount(); i++) {
+        OSDictionary *dict = OSDynamicCast(OSDictionary, phases->getObject(i));
+        OSString *phase = dict ? OSDynamicCast(OSString, dict->getObject("phase")) : NULL;
+        OSNumber *duration = dict ? OSDynamicCast(OSNumber, dict->getObject("duration_us")) : NULL;
+
+        if (phase && duration && phase->isEqualTo(name))
+            return duration->unsigned64BitValue();
+    }
+    return 0;
+}
+
+/* One bring-up, as start() of the kext does it */
+static bool
+run(OSData *capture, const IntelReplayConfig *config, uint8_t generation, uint32_t budget, ReplayRun *out)
+{
+    IntelReplayTransport *replay = new IntelReplayTransport;
+    BtIntel *ops = NULL;
+    char loaded[64] = "";
+    uint64_t start, ns;
+
+    memset(out, 0, sizeof(*out));
+    if (!replay->initWithCapture(capture, config))
+        goto done;
+    if (!generation)
+        generation = replay->getGeneration();
+    ops = intelHostCreateOps(generation);
+    if (!ops || !ops->initWithTransport(replay, 0, intelLatencyForSku(0x8087, intelHostProductID(generation)))) {
+        fprintf(stderr, "cannot create the gen%u Ops\n", generation);
+        goto done;
+    }
+    ops->setSetupBudget(budget);
+    start = mach_absolute_time();
+    out->loaded = ops->setup();
+    absolutetime_to_nanoseconds(mach_absolute_time() - start, &ns);
+    ops->getFirmwareName(loaded, sizeof(loaded));
+    out->totalUs = ns / 1000;
+    out->matched = replay->getMatched();
+    out->skipped = replay->getSkipped();
+    out->diverged = replay->getDiverged();
+    out->truncated = replay->getTruncated();
+    out->late = replay->getLate();
+    out->phases = ops->getTimeline()->copyArray();
+    if (!out->loaded && ops->getDeadline()->isExpired())
+        printf("setup budget expired in %s\n", IntelTimeline::phaseName(ops->getDeadline()->phase()));
+done:
+    OSSafeReleaseNULL(ops);
+    OSSafeReleaseNULL(replay);
+    return out->loaded && !out->diverged;
+}
+
+static void
+printRun(const char *name, const ReplayRun *run)
+{
+    printf("%-9s %s, %u commands matched, %u skipped, %u without a match", name,
+           run->loaded ? "loaded" : "failed", run->matched, run->skipped, run->diverged);
+    if (run->truncated)
+        printf(", %u answers cut short", run->truncated);
+    if (run->late)
+        printf(", %u read late", run->late);
+    printf("\n");
+}
+
+static double
+delta(uint64_t before, uint64_t after)
+{
+    return before ? ((double)after - (double)before) * 100.0 / before : 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    IntelReplayConfig base = { 1.0, 1.0, false }, config;
+    const char *path = NULL;
+    uint32_t budget = IBT_SETUP_BUDGET, generation = 0;
+    bool verbose = false, ok;
+    ReplayRun baseline, replayed;
+    IntelReplayTransport *probe;
+    OSData *capture;
+    bool *printed;
+    unsigned int count;
+
+    config = base;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (!strcmp(arg, "--bulk-route")) {
+            base.bulkRoute = config.bulkRoute = true;
+            continue;
+        }
+        if (!strcmp(arg, "-v")) {
+            verbose = true;
+            continue;
+        }
+        if (arg[0] != '-') {
+            if (path)
+                usage(argv[0]);
+            path = arg;
+            continue;
+        }
+        if (!value)
+            usage(argv[0]);
+        i++;
+        if (!strcmp(arg, "--ctrl-scale")) {
+            config.ctrlScale = strtod(value, NULL);
+        } else if (!strcmp(arg, "--bulk-scale")) {
+            config.bulkScale = strtod(value, NULL);
+        } else if (!strcmp(arg, "--gen")) {
+            generation = (uint32_t)strtoul(value, NULL, 0);
+            if (generation < 1 || generation > 3)
+                usage(argv[0]);
+        } else if (!strcmp(arg, "--budget")) {
+            budget = (uint32_t)strtoul(value, NULL, 0);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (!path || config.ctrlScale < 0 || config.bulkScale < 0)
+        usage(argv[0]);
+    if (!(capture = intelHostReadFile(path))) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 2;
+    }
+
+    IBTHostSetLog(verbose ? stderr : NULL);
+    IBTHostSetVirtualClock(true);
+    if (IBT_FW_RESOURCE_DIR[0])
+        IBTHostSetResourceDir(IBT_FW_RESOURCE_DIR, 0);
+    probe = new IntelReplayTransport;
+    if (!probe->initWithCapture(capture, &base)) {
+        fprintf(stderr, "%s is not a capture that can be replayed\n", path);
+        probe->release();
+        capture->release();
+        return 2;
+    }
+    if (!generation)
+        generation = probe->getGeneration();
+    printf("%s: %u command records over %.3f ms, replayed with the gen%u Ops\n", path, probe->getRecorded(),
+           probe->getSpan() / 1000000.0, generation);
+    probe->release();
+
+    ok = run(capture, &base, (uint8_t)generation, budget, &baseline);
+    ok &= run(capture, &config, (uint8_t)generation, budget, &replayed);
+    printRun("baseline", &baseline);
+    printRun("replayed", &replayed);
+
+    /* Phases of the baseline longest first, then what only the other
+     * run went through.
+     */
+    printf("%-14s %12s %12s %8s\n", "phase", "baseline(ms)", "replayed(ms)", "delta");
+    count = baseline.phases ? baseline.phases->getCount() : 0;
+    printed = (bool *)IOMallocZero(count + 1);
+    for (unsigned int n = 0; printed && n < count; n++) {
+        OSString *longest = NULL;
+        unsigned int index = 0;
+        uint64_t us = 0;
+
+        for (unsigned int i = 0; i < count; i++) {
+            OSDictionary *dict = OSDynamicCast(OSDictionary, baseline.phases->getObject(i));
+            OSString *phase = dict ? OSDynamicCast(OSString, dict->getObject("phase")) : NULL;
+
+            if (printed[i] || !phase)
+                continue;
+            if (!longest || phaseUs(baseline.phases, phase->getCStringNoCopy()) > us) {
+                longest = phase;
+                index = i;
+                us = phaseUs(baseline.phases, phase->getCStringNoCopy());
+            }
+        }
+        if (!longest)
+            break;
+        printed[index] = true;
+        uint64_t other = phaseUs(replayed.phases, longest->getCStringNoCopy());
+        printf("%-14s %12.3f %12.3f %7.1f%%\n", longest->getCStringNoCopy(), us / 1000.0, other / 1000.0,
+               delta(us, other));
+    }
+    if (printed)
+        IOFree(printed, count + 1);
+    for (unsigned int i = 0; replayed.phases && i < replayed.phases->getCount(); i++) {
+        OSDictionary *dict = OSDynamicCast(OSDictionary, replayed.phases->getObject(i));
+        OSString *phase = dict ? OSDynamicCast(OSString, dict->getObject("phase")) : NULL;
+
+        if (phase && baseline.phases && !phaseUs(baseline.phases, phase->getCStringNoCopy()) &&
+            phaseUs(replayed.phases, phase->getCStringNoCopy()))
+            printf("%-14s %12.3f %12.3f %8s\n", phase->getCStringNoCopy(), 0.0,
+                   phaseUs(replayed.phases, phase->getCStringNoCopy()) / 1000.0, "-");
+    }
+    printf("%-14s %12.3f %12.3f %7.1f%%\n", "total", baseline.totalUs / 1000.0, replayed.totalUs / 1000.0,
+           delta(baseline.totalUs, replayed.totalUs));
+
+    OSSafeReleaseNULL(baseline.phases);
+    OSSafeReleaseNULL(replayed.phases);
+    capture->release();
+    return ok ? 0 : 1;
+}
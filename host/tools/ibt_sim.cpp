@@ -0,0 +1,216 @@
+//
+//  ibt_sim.cpp
+//  IntelBluetoothFirmware host tools
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+/* Runs the setup() of the Ops class for a firmware file against a model
+ * of the controller it is for (IntelSimTransport), on the virtual clock
+ * of the host shims, e.g.
+ *   ibt_sim IntelBluetoothFirmware/fw/ibt-hw-37.8.bseq
+ *   ibt_sim IntelBluetoothFirmware/fw/ibt-17-16-1.sfi --rtt 1000 --jitter 200
+ *   ibt_sim IntelBluetoothFirmware/fw/ibt-0040-0041.sfi --ecdsa \
+ *       --loss 0.01 --seed 3 --latency 0xfc09=1500 -o sim.btsnoop
+ * The generation follows from the file name (.bseq gen1, ibt-<n>-<n>.sfi
+ * gen2, ibt-<4 hex>-<4 hex>.sfi gen3). The Ops load the firmware and DDC
+ * compiled into ibtcore, or from the resource directory of
+ * IBT_FW_EXTERNAL builds, and the controller checks what they send
+ * against the file given here.
+ *
+ * Prints the time spent per IntelTimeline phase and, with --rtt N, the
+ * Read Version round-trips of the ibtrtt boot-arg next to the bulk ones
+ * of the download. --runs N repeats the bring-up with the learned
+ * latency table kept, as a replug would. -o writes the traffic of the
+ * last run as a btsnoop capture for btsnoop_stats.py and ibt_replay.
+ * The exit status is 0 when every run loaded the file.
+ */
+
+#include <stdlib.h>
+#include <libkern/c++/OSDictionary.h>
+
+#include "IBTHost.h"
+#include "IntelHostTool.hpp"
+#include "IntelSimTransport.hpp"
+
+static void
+usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s <fw file> [--latency op=us,...] [--default-latency us] [--jitter us]\n"
+            "       [--control-us us] [--bulk-us us] [--verify-ms ms] [--boot-ms ms]\n"
+            "       [--loss P] [--seed S] [--ecdsa] [--variant 0xNN] [--bulk-route]\n"
+            "       [--budget ms] [--rtt N] [--runs N] [-o capture.btsnoop] [-v]\n", prog);
+    exit(2);
+}
+
+static bool
+parseLatency(IntelSimConfig *config, char *list)
+{
+    char *item, *save = NULL;
+    unsigned int opcode, us;
+
+    for (item = strtok_r(list, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        if (sscanf(item, "%x=%u", &opcode, &us) != 2 || opcode > 0xffff ||
+            !intelSimSetLatency(config, (uint16_t)opcode, us))
+            return false;
+    }
+    return true;
+}
+
+/* One bring-up, as start() of the kext does it */
+static bool
+run(const char *name, OSData *fw, const IntelSimConfig *config, uint32_t budget,
+    uint32_t rtt, const char *capturePath, bool last)
+{
+    IntelSimTransport *sim = new IntelSimTransport;
+    BtIntel *ops = NULL;
+    char loaded[64] = "";
+    uint64_t start, ns;
+    bool ret = false;
+
+    if (!sim->initWithFirmware(name, fw, config))
+        goto done;
+    ops = intelHostCreateOps(sim->getGeneration());
+    if (!ops || !ops->initWithTransport(sim, 0, intelLatencyForSku(0x8087, intelHostProductID(sim->getGeneration())))) {
+        fprintf(stderr, "cannot create the gen%u Ops\n", sim->getGeneration());
+        goto done;
+    }
+    ops->setSetupBudget(budget);
+    start = mach_absolute_time();
+    ret = ops->setup();
+    absolutetime_to_nanoseconds(mach_absolute_time() - start, &ns);
+    ops->getFirmwareName(loaded, sizeof(loaded));
+    /* Loaded means running the firmware of this very file */
+    if (ret && strcmp(loaded, name)) {
+        printf("%s: the Ops loaded %s instead\n", name, loaded[0] ? loaded : "nothing");
+        ret = false;
+    }
+    if (ret && sim->getGeneration() != 1 && !sim->isOperational()) {
+        printf("%s: setup() returned with the controller in the bootloader\n", name);
+        ret = false;
+    }
+    printf("%s (gen%u): %s in %.3f ms, %u commands, %u answers lost\n", name, sim->getGeneration(),
+           ret ? "loaded" : "failed", ns / 1000000.0, sim->getCommands(), sim->getLost());
+    if (!ret && ops->getDeadline()->isExpired())
+        printf("  setup budget expired in %s\n", IntelTimeline::phaseName(ops->getDeadline()->phase()));
+    if (sim->getRejection())
+        printf("  download rejected: %s\n", sim->getRejection());
+    if (!last)
+        goto done;
+    intelHostPrintPhases(stdout, ops->getTimeline());
+    if (rtt) {
+        ops->measureRoundTrip(rtt);
+        OSDictionary *dict = ops->copyRoundTrip();
+        if (dict) {
+            intelHostPrint(stdout, "fw_rtt", dict, 1);
+            dict->release();
+        }
+    }
+    if (OSDictionary *route = ops->copyRoute()) {
+        intelHostPrint(stdout, "fw_route", route, 1);
+        route->release();
+    }
+    if (capturePath) {
+        OSData *capture = sim->copySnoop();
+        if (!capture || !intelHostWriteFile(capturePath, capture))
+            fprintf(stderr, "cannot write %s\n", capturePath);
+        OSSafeReleaseNULL(capture);
+    }
+done:
+    OSSafeReleaseNULL(ops);
+    OSSafeReleaseNULL(sim);
+    return ret;
+}
+
+int
+main(int argc, char **argv)
+{
+    IntelSimConfig config;
+    const char *path = NULL, *capturePath = NULL, *name;
+    uint32_t budget = IBT_SETUP_BUDGET, rtt = 0, runs = 1;
+    bool verbose = false, ok = true;
+    OSData *fw;
+
+    intelSimDefaults(&config);
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (!strcmp(arg, "--ecdsa")) {
+            config.sbeType = 0x01;
+            continue;
+        }
+        if (!strcmp(arg, "--bulk-route")) {
+            config.bulkRoute = true;
+            continue;
+        }
+        if (!strcmp(arg, "-v")) {
+            verbose = true;
+            continue;
+        }
+        if (arg[0] != '-') {
+            if (path)
+                usage(argv[0]);
+            path = arg;
+            continue;
+        }
+        if (!value)
+            usage(argv[0]);
+        i++;
+        if (!strcmp(arg, "--latency")) {
+            char list[256];
+            snprintf(list, sizeof(list), "%s", value);
+            if (!parseLatency(&config, list))
+                usage(argv[0]);
+        } else if (!strcmp(arg, "--default-latency")) {
+            config.defaultUs = (uint32_t)strtoul(value, NULL, 0);
+        } else if (!strcmp(arg, "--jitter")) {
+            config.jitterUs = (uint32_t)strtoul(value, NULL, 0);
+        } else if (!strcmp(arg, "--control-us")) {
+            config.controlUs = (uint32_t)strtoul(value, NULL, 0);
+        } else if (!strcmp(arg, "--bulk-us")) {
+            config.bulkUs = (uint32_t)strtoul(value, NULL, 0);
+        } else if (!strcmp(arg, "--verify-ms")) {
+            config.verifyUs = (uint32_t)strtoul(value, NULL, 0) * 1000;
+        } else if (!strcmp(arg, "--boot-ms")) {
+            config.bootUs = (uint32_t)strtoul(value, NULL, 0) * 1000;
+        } else if (!strcmp(arg, "--loss")) {
+            config.loss = strtod(value, NULL);
+        } else if (!strcmp(arg, "--seed")) {
+            config.seed = (uint32_t)strtoul(value, NULL, 0);
+        } else if (!strcmp(arg, "--variant")) {
+            config.variant = (uint8_t)strtoul(value, NULL, 0);
+        } else if (!strcmp(arg, "--budget")) {
+            budget = (uint32_t)strtoul(value, NULL, 0);
+        } else if (!strcmp(arg, "--rtt")) {
+            rtt = (uint32_t)strtoul(value, NULL, 0);
+        } else if (!strcmp(arg, "--runs")) {
+            runs = (uint32_t)strtoul(value, NULL, 0);
+        } else if (!strcmp(arg, "-o")) {
+            capturePath = value;
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (!path || !runs)
+        usage(argv[0]);
+    name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    if (!(fw = intelHostReadFile(path))) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 2;
+    }
+
+    IBTHostSetLog(verbose ? stderr : NULL);
+    IBTHostSetVirtualClock(true);
+    if (IBT_FW_RESOURCE_DIR[0])
+        IBTHostSetResourceDir(IBT_FW_RESOURCE_DIR, 0);
+    for (uint32_t i = 0; i < runs; i++) {
+        IntelSimConfig each = config;
+        each.seed = config.seed + i;
+        ok &= run(name, fw, &each, budget, rtt, capturePath, i == runs - 1);
+    }
+    fw->release();
+    return ok ? 0 : 1;
+}
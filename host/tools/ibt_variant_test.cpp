@@ -0,0 +1,183 @@
+//
+//  ibt_variant_test.cpp
+//  IntelBluetoothFirmware host tools
+//
+//  Created by agent on 2026/10/19.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+/* Checks the variant and product tables of BtIntelVariant.h and the
+ * firmware names the Ops derive from them, one line per failed check.
+ * Run by ctest, the exit status is the number of failures.
+ */
+
+#include <string.h>
+#include <libkern/OSByteOrder.h>
+
+#include "IBTHost.h"
+#include "IntelBluetoothOpsGen2.hpp"
+#include "IntelBluetoothOpsGen3.hpp"
+#include "IntelNullTransport.hpp"
+
+/* The Ops with their name builders made reachable */
+class TestOpsGen2 : public IntelBluetoothOpsGen2 {
+    OSDeclareDefaultStructors(TestOpsGen2)
+
+public:
+    using IntelBluetoothOpsGen2::getFirmware;
+};
+
+OSDefineMetaClassAndStructors(TestOpsGen2, IntelBluetoothOpsGen2)
+
+class TestOpsGen3 : public IntelBluetoothOpsGen3 {
+    OSDeclareDefaultStructors(TestOpsGen3)
+
+public:
+    using IntelBluetoothOpsGen3::getFirmware;
+};
+
+OSDefineMetaClassAndStructors(TestOpsGen3, IntelBluetoothOpsGen3)
+
+static int failures;
+
+#define CHECK(cond, ...) do {                                       \
+    if (!(cond)) {                                                  \
+        fprintf(stderr, "%s:%d: ", __FILE__, __LINE__);             \
+        fprintf(stderr, __VA_ARGS__);                               \
+        fputc('\n', stderr);                                        \
+        failures++;                                                 \
+    }                                                               \
+} while (0)
+
+/* Every row is found by its own variant, nothing else is found */
+static void
+testVariantLookup()
+{
+    static const uint8_t unknown[] = { 0x00, 0x07, 0x0a, 0x0d, 0x10, 0x15, 0x16, 0x1a, 0x1d, 0x3f, 0xff };
+
+    CHECK(intelVariantsValid(), "intelVariants is not sorted or not consistent");
+    for (unsigned int i = 0; i < IBT_VARIANT_COUNT; i++) {
+        const IntelVariantTraits *traits = intelVariantTraits(intelVariants[i].variant);
+
+        CHECK(traits == &intelVariants[i], "variant 0x%02x (%s) not found", intelVariants[i].variant,
+              intelVariants[i].name);
+    }
+    for (uint8_t variant : unknown)
+        CHECK(!intelVariantTraits(variant), "unknown variant 0x%02x found", variant);
+
+    CHECK(intelVariantTraits(0x0b)->naming == kNamingDevRevid && !intelVariantTraits(0x0b)->versionCheck,
+          "SfP is named by device revision without a version check");
+    CHECK(intelVariantTraits(0x12)->generation == 2 && intelVariantTraits(0x12)->tlvVersion,
+          "ThP has a legacy bootloader with TLV firmware");
+    CHECK(intelVariantTraits(0x14)->naming == kNamingRevision && !intelVariantTraits(0x14)->ecdsa,
+          "CcP is named by revision, RSA only");
+    CHECK(intelVariantTraits(0x17)->generation == 3 && intelVariantTraits(0x17)->ecdsa,
+          "TyP has the TLV bootloader and an ECDSA header");
+    CHECK(intelVariantTraits(0x1c)->naming == kNamingCnvTop, "GaP is named by CNVi/CNVr");
+}
+
+/* Listed products keep their generation, any other product is gen2 */
+static void
+testProductLookup()
+{
+    static const uint16_t unknown[] = { 0x0000, 0x0025, 0x0026, 0x0029, 0x0031, 0x0034, 0x0037, 0x07da,
+                                        0x0a2b, 0xffff };
+
+    CHECK(intelProductsValid(), "intelProducts is not sorted");
+    for (const IntelProductTraits &product : intelProducts)
+        CHECK(intelProductGeneration(product.productID) == product.generation,
+              "product 0x%04x is not gen%u", product.productID, product.generation);
+    for (uint16_t productID : unknown)
+        CHECK(intelProductGeneration(productID) == 2, "unknown product 0x%04x is not gen2", productID);
+    CHECK(intelProductGeneration(0x07dc) == 1 && intelProductGeneration(0x0a2a) == 1 &&
+          intelProductGeneration(0x0aa7) == 1, "the gen1 products");
+    CHECK(intelProductGeneration(0x0032) == 3 && intelProductGeneration(0x0038) == 3, "the gen3 products");
+}
+
+static void
+checkGen2Name(TestOpsGen2 *ops, uint8_t variant, uint8_t hwRevision, uint8_t fwRevision, uint16_t devRevid,
+              const char *suffix, const char *expected)
+{
+    IntelVersion ver;
+    IntelBootParams params;
+    char name[64];
+    bool ret;
+
+    memset(&ver, 0, sizeof(ver));
+    memset(&params, 0, sizeof(params));
+    ver.hw_variant = variant;
+    ver.hw_revision = hwRevision;
+    ver.fw_revision = fwRevision;
+    params.dev_revid = OSSwapHostToLittleInt16(devRevid);
+    strcpy(name, "untouched");
+    ret = ops->getFirmware(&ver, &params, name, sizeof(name), suffix);
+    if (!expected) {
+        CHECK(!ret, "variant 0x%02x named %s", variant, name);
+        return;
+    }
+    CHECK(ret && !strcmp(name, expected), "variant 0x%02x named %s, expected %s", variant,
+          ret ? name : "nothing", expected);
+}
+
+static void
+checkGen3Name(TestOpsGen3 *ops, uint32_t cnviTop, uint32_t cnvrTop, const char *suffix, const char *expected)
+{
+    IntelVersionTLV tlv;
+    char name[64];
+
+    memset(&tlv, 0, sizeof(tlv));
+    tlv.cnvi_top = cnviTop;
+    tlv.cnvr_top = cnvrTop;
+    CHECK(ops->getFirmware(&tlv, name, sizeof(name), suffix) && !strcmp(name, expected),
+          "cnvi_top 0x%08x cnvr_top 0x%08x named %s, expected %s", cnviTop, cnvrTop, name, expected);
+}
+
+/* One name per naming scheme and file type, as in fw/ */
+static void
+testFirmwareNames(TestOpsGen2 *gen2, TestOpsGen3 *gen3)
+{
+    /* kNamingDevRevid */
+    checkGen2Name(gen2, 0x0b, 0x00, 0x00, 5, "sfi", "ibt-11-5.sfi");
+    checkGen2Name(gen2, 0x0c, 0x00, 0x00, 5, "ddc", "ibt-12-5.ddc");
+    /* kNamingRevision, the device revision does not count */
+    checkGen2Name(gen2, 0x11, 0x10, 0x01, 5, "sfi", "ibt-17-16-1.sfi");
+    checkGen2Name(gen2, 0x12, 0x10, 0x01, 0, "ddc", "ibt-18-16-1.ddc");
+    checkGen2Name(gen2, 0x14, 0x01, 0x03, 0, "sfi", "ibt-20-1-3.sfi");
+    /* Not a gen2 name, or no name at all */
+    checkGen2Name(gen2, 0x17, 0x10, 0x01, 0, "sfi", NULL);
+    checkGen2Name(gen2, 0x15, 0x10, 0x01, 0, "sfi", NULL);
+    checkGen2Name(gen2, 0x00, 0x00, 0x00, 0, "sfi", NULL);
+
+    /* kNamingCnvTop: type in bits 0-11, step in bits 24-27 */
+    checkGen3Name(gen3, 0x00000400, 0x00000410, "sfi", "ibt-0040-0041.sfi");
+    checkGen3Name(gen3, 0x00000400, 0x00000410, "ddc", "ibt-0040-0041.ddc");
+    checkGen3Name(gen3, 0x00000401, 0x01000504, "sfi", "ibt-1040-4150.sfi");
+    checkGen3Name(gen3, 0xf0fff401, 0xf1fff504, "ddc", "ibt-1040-4150.ddc");
+}
+
+int
+main(int argc, char **argv)
+{
+    IntelNullTransport *transport = new IntelNullTransport;
+    TestOpsGen2 *gen2 = new TestOpsGen2;
+    TestOpsGen3 *gen3 = new TestOpsGen3;
+
+    IBTHostSetLog(NULL);
+    if (!transport->init() || !gen2->initWithTransport(transport) || !gen3->initWithTransport(transport)) {
+        fprintf(stderr, "cannot create the Ops\n");
+        return 2;
+    }
+
+    testVariantLookup();
+    testProductLookup();
+    testFirmwareNames(gen2, gen3);
+
+    gen3->release();
+    gen2->release();
+    transport->release();
+    if (failures)
+        fprintf(stderr, "%d checks failed\n", failures);
+    else
+        printf("all checks passed\n");
+    return failures;
+}
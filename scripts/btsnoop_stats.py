@@ -0,0 +1,134 @@
+#!/usr/bin/python3
+# -*- coding: utf-8 -*-
+# btsnoop_stats.py
+#
+#  Created by agent on 2026/10/19.
+#  Copyright © 2026 agent. All rights reserved.
+
+# Per-opcode command latency from the HCI capture the kext publishes as
+# "hci_snoop" (btsnoop, H4 datalink), e.g.
+#   python3 btsnoop_stats.py --ioreg -o setup.btsnoop
+#   python3 btsnoop_stats.py setup.btsnoop
+# The .btsnoop file opens as is in Wireshark.
+#
+# A run of secure send fragments is captured as one command whose
+# length covers the whole run; the fragments and answers folded into it
+# are counted as drops.
+
+import plistlib
+import struct
+import subprocess
+import sys
+
+BTSNOOP_MAGIC = b"btsnoop\0"
+BTSNOOP_EPOCH_DELTA = 0x00dcddb30f2f8000
+
+H4_COMMAND = 0x01
+H4_EVENT = 0x04
+
+EVT_CMD_COMPLETE = 0x0e
+EVT_CMD_STATUS = 0x0f
+
+def find_snoop(entry):
+    if isinstance(entry, dict):
+        if "hci_snoop" in entry:
+            return entry["hci_snoop"]
+        entry = list(entry.values())
+    if isinstance(entry, list):
+        for child in entry:
+            data = find_snoop(child)
+            if data:
+                return data
+    return None
+
+def read_ioreg():
+    out = subprocess.check_output(["ioreg", "-a", "-l", "-r", "-k", "hci_snoop"])
+    data = find_snoop(plistlib.loads(out)) if out.strip() else None
+    if not data:
+        raise SystemExit("no hci_snoop property in the IORegistry")
+    return data
+
+def parse(data):
+    if data[:8] != BTSNOOP_MAGIC:
+        raise SystemExit("not a btsnoop file")
+    version, datalink = struct.unpack(">II", data[8:16])
+    if datalink != 1002:
+        raise SystemExit("unsupported datalink {}".format(datalink))
+    off = 16
+    while off + 24 <= len(data):
+        orig_len, incl_len, flags, drops, ts = struct.unpack(">IIIIQ", data[off:off + 24])
+        off += 24
+        pkt = data[off:off + incl_len]
+        off += incl_len
+        yield (ts - BTSNOOP_EPOCH_DELTA, orig_len - 1, drops, pkt)
+
+def event_opcode(pkt):
+    # pkt starts with the H4 type, then the HCI event header.
+    if len(pkt) >= 6 and pkt[1] == EVT_CMD_COMPLETE:
+        return pkt[4] | pkt[5] << 8
+    if len(pkt) >= 7 and pkt[1] == EVT_CMD_STATUS:
+        return pkt[5] | pkt[6] << 8
+    return None
+
+def percentile(values, pct):
+    return values[min(len(values) - 1, int(len(values) * pct / 100))]
+
+def stats(data):
+    pending = []
+    opcodes = {}
+    last_drops = 0
+    for ts, length, drops, pkt in parse(data):
+        folded, last_drops = drops - last_drops, drops
+        if not pkt:
+            continue
+        if pkt[0] == H4_COMMAND and len(pkt) >= 3:
+            opcode = pkt[1] | pkt[2] << 8
+            pending.append((opcode, ts))
+            stat = opcodes.setdefault(opcode, {"sent": 0, "bytes": 0, "lat": []})
+            # Every folded fragment brought its answer along.
+            stat["sent"] += 1 + folded // 2
+            stat["bytes"] += length
+        elif pkt[0] == H4_EVENT and pending:
+            # Events that carry no opcode (vendor events answering a
+            # secure send, truncated captures) complete the oldest
+            # outstanding command.
+            opcode = event_opcode(pkt)
+            match = 0
+            if opcode is not None:
+                match = next((i for i, p in enumerate(pending) if p[0] == opcode), 0)
+            opcode, sent = pending.pop(match)
+            opcodes[opcode]["lat"].append(ts - sent)
+
+    print("{:>8} {:>7} {:>9} {:>9} {:>9} {:>9} {:>9} {:>10}".format(
+        "opcode", "sent", "answered", "min(us)", "p50(us)", "p99(us)", "max(us)", "bytes"))
+    for opcode in sorted(opcodes):
+        stat = opcodes[opcode]
+        lat = sorted(stat["lat"])
+        if lat:
+            cols = [lat[0], percentile(lat, 50), percentile(lat, 99), lat[-1]]
+        else:
+            cols = ["-"] * 4
+        print("{:>8} {:>7} {:>9} {:>9} {:>9} {:>9} {:>9} {:>10}".format(
+            "0x%04x" % opcode, stat["sent"], len(lat), *cols, stat["bytes"]))
+    if pending:
+        print("{} command(s) without an event".format(len(pending)))
+
+if __name__ == '__main__':
+    args = sys.argv[1:]
+    out = None
+    if "-o" in args:
+        i = args.index("-o")
+        out = args[i + 1]
+        del args[i:i + 2]
+    if args == ["--ioreg"]:
+        data = read_ioreg()
+    elif len(args) == 1:
+        with open(args[0], "rb") as f:
+            data = f.read()
+    else:
+        print("usage: {} <file.btsnoop> | --ioreg [-o <file.btsnoop>]".format(sys.argv[0]))
+        sys.exit(1)
+    if out:
+        with open(out, "wb") as f:
+            f.write(data)
+    stats(data)
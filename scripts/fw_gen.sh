@@ -9,16 +9,24 @@ target_file="${PROJECT_DIR}/include/FwBinary.cpp"
 if [ -f "$target_file" ]; then
 exit 0
 fi
+fw_variant="all"
+fw_external=""
 while [ $# -gt 0 ];
 do
     case $1 in
     -P) fw_files=$2
     shift
     ;;
+    -V) fw_variant=$2
+    shift
+    ;;
+    -E) fw_external=$2
+    shift
+    ;;
     
     esac
     shift
 done
 
 script_file="${PROJECT_DIR}/scripts/"
-python3 -c 'import sys;sys.path.append("'$script_file'");from zlib_compress_fw import *;process_files("'${target_file}'", "'$fw_files'")'
+python3 -c 'import sys;sys.path.append("'$script_file'");from zlib_compress_fw import *;process_files("'${target_file}'", "'$fw_files'", "'"$fw_variant"'", "'"$fw_external"'")'
@@ -7,7 +7,9 @@
 
 import zlib
 import os
+import re
 import struct
+import sys
 import hashlib
 
 copyright = '''
@@ -17,6 +19,109 @@ copyright = '''
 #include "FwData.h"
 '''
 
+# Firmware families, keyed by the naming scheme the Ops classes use to
+# look them up:
+#   gen1: ibt-hw-<platform>.<variant>[...].bseq     (IntelBluetoothOpsGen1)
+#   gen2: ibt-<hw_variant>-<revid>[-<fw_rev>].sfi   (legacy bootloader)
+#   gen3: ibt-<cnvi_top>-<cnvr_top>.sfi             (TLV bootloader)
+generations = ["gen1", "gen2", "gen3"]
+
+def fw_generation(file_name):
+    if file_name.startswith("ibt-hw-"):
+        return "gen1"
+    if re.match(r"^ibt-[0-9a-f]{4}-[0-9a-f]{4}\.", file_name):
+        return "gen3"
+    return "gen2"
+
+def fw_selected(file_name, variant):
+    """A variant is a list of selectors separated by spaces or commas.
+    A selector is either "all", a generation name, or a firmware file
+    stem such as ibt-0040-0041 (one CNVi combination) or ibt-19-0.
+    """
+    for selector in re.split(r"[\s,]+", variant.strip()):
+        if not selector:
+            continue
+        if selector == "all" or selector == fw_generation(file_name):
+            return True
+        if file_name.split(".")[0] == selector or file_name.startswith(selector + "-"):
+            return True
+    return False
+
+def fw_files(dir, variant):
+    files = []
+    for root, dirs, names in os.walk(dir):
+        for name in names:
+            if fw_selected(name, variant):
+                files.append((root, name))
+    return sorted(files, key=lambda f: f[1])
+
+# Gen1 .bseq files are a stream of HCI commands (type 0x01) each
+# followed by its expected events (type 0x02). They and the .ddc files
+# are validated here and compiled into the table that
+# BtIntel::intelSendPatchTable() walks, see IntelPatchTableHdr and
+# IntelPatchRecord in BtIntel.h.
+IBT_PATCH_TABLE_MAGIC = 0x50544249
+IBT_PATCH_TABLE_VERSION = 1
+IBT_PATCH_TABLE_F_ENABLE = 0x01
+
+def compile_bseq(file_name, data):
+    commands = []
+    flags = 0
+    pos = 0
+    while pos < len(data):
+        if len(data) - pos <= 3 or data[pos] != 0x01:
+            raise ValueError("{}: invalid cmd read at {}".format(file_name, pos))
+        opcode, plen = struct.unpack_from("<HB", data, pos + 1)
+        pos += 4
+        if len(data) - pos < plen:
+            raise ValueError("{}: invalid cmd len at {}".format(file_name, pos))
+        params = data[pos:pos + plen]
+        pos += plen
+        # only the last expected event is waited for
+        evt = None
+        while len(data) - pos > 2 and data[pos] == 0x02:
+            code, elen = struct.unpack_from("BB", data, pos + 1)
+            pos += 3
+            if len(data) - pos < elen:
+                raise ValueError("{}: invalid evt len at {}".format(file_name, pos))
+            pos += elen
+            evt = code
+        if evt is None:
+            raise ValueError("{}: invalid evt read at {}".format(file_name, pos))
+        # a patch load command means the patch gets activated on exit
+        if opcode == 0xfc8e:
+            flags |= IBT_PATCH_TABLE_F_ENABLE
+        commands.append((evt, opcode, params))
+    return patch_table(flags, commands)
+
+def patch_table(flags, commands):
+    records = bytearray()
+    for evt, opcode, params in commands:
+        record = struct.pack("<BHB", evt, opcode, len(params)) + params
+        records += record + b"\0" * (-len(record) % 4)
+    return struct.pack("<IBBHI", IBT_PATCH_TABLE_MAGIC, IBT_PATCH_TABLE_VERSION,
+                       flags, len(commands), len(records)) + bytes(records)
+
+# .ddc files are a list of {length, id (2 bytes), value (length - 2)}
+# entries, each written with one Intel_Write_DDC (0xfc8b) command.
+def compile_ddc(file_name, data):
+    commands = []
+    pos = 0
+    while pos < len(data):
+        plen = data[pos] + 1
+        if plen < 3 or len(data) - pos < plen:
+            raise ValueError("{}: invalid ddc entry at {}".format(file_name, pos))
+        commands.append((0x0e, 0xfc8b, data[pos:pos + plen]))
+        pos += plen
+    return patch_table(0, commands)
+
+def fw_payload(file_name, data):
+    if file_name.endswith(".bseq"):
+        return compile_bseq(file_name, data)
+    if file_name.endswith(".ddc"):
+        return compile_ddc(file_name, data)
+    return data
+
 def compress(data):
     return zlib.compress(data)
 
@@ -34,14 +139,19 @@ def format_var_name(hash):
 def write_single_file(target_file, path, file, file_hash):
     src_file = open(path, "rb")
     src_data = src_file.read()
+    raw_len = len(src_data)
+    src_data = fw_payload(file, src_data)
     src_hash = hash(src_data)
     fw_var_name = format_file_name(file)
     data_var_name = format_var_name(src_hash)
 
+    embedded_len = 0
+
     if src_hash not in file_hash:
         file_hash.append(src_hash)
         src_data = compress(src_data)
         src_len = len(src_data)
+        embedded_len = src_len
         target_file.write("\nconst unsigned char ")
         target_file.write(data_var_name)
         target_file.write("[] = {")
@@ -79,39 +189,107 @@ def write_single_file(target_file, path, file, file_hash):
     target_file.write(data_var_name)
     target_file.write(");\n")
     src_file.close()
+    return raw_len, embedded_len
+
     
-    
-def process_files(target_file, dir):
+def write_external_file(external_dir, path, file):
+    src_file = open(path, "rb")
+    src_data = src_file.read()
+    src_file.close()
+    dst_data = compress(fw_payload(file, src_data))
+    dst_file = open(os.path.join(external_dir, file + ".zlib"), "wb")
+    dst_file.write(dst_data)
+    dst_file.close()
+    return len(src_data), len(dst_data)
+
+def process_files(target_file, dir, variant="all", external_dir=""):
+    """With external_dir set, the selected firmware is written there as
+    <name>.zlib instead of being embedded, and the kext requests it from
+    its Resources folder on demand (BtIntel::requestFirmwareResource).
+    """
     if not os.path.exists(target_file):
         if not os.path.exists(os.path.dirname(target_file)):
-            os.mkdirs(os.path.dirname(target_file))
+            os.makedirs(os.path.dirname(target_file))
+    files = fw_files(dir, variant)
+    count = len(files)
+    raw_size = 0
+    embedded_size = 0
+    external_size = 0
     target_file_handle = open(target_file, "w")
     target_file_handle.write(copyright)
-    for root, dirs, files in os.walk(dir):
-        file_hash=[]
-        for file in files:
-            path = os.path.join(root, file)
-            write_single_file(target_file_handle, path, file, file_hash)
-            
-        target_file_handle.write("\n")
-        target_file_handle.write("const struct FwDesc fwList[] = {")
-        
-        for file in files:
-            target_file_handle.write('{IBT_FW("')
-            target_file_handle.write(file)
-            target_file_handle.write('", ')
-            fw_var_name = format_file_name(file)
-            target_file_handle.write(fw_var_name)
-            target_file_handle.write(", ")
-            target_file_handle.write(fw_var_name)
-            target_file_handle.write("_size)},\n")
-            
-        target_file_handle.write("};\n")
-        target_file_handle.write("const int fwNumber = ")
-        target_file_handle.write(str(len(files)))
-        target_file_handle.write(";\n")
-            
+    file_hash = []
+    if external_dir:
+        if not os.path.exists(external_dir):
+            os.makedirs(external_dir)
+        for root, file in files:
+            raw_len, external_len = write_external_file(external_dir, os.path.join(root, file), file)
+            raw_size += raw_len
+            external_size += external_len
+        files = []
+    for root, file in files:
+        path = os.path.join(root, file)
+        raw_len, embedded_len = write_single_file(target_file_handle, path, file, file_hash)
+        raw_size += raw_len
+        embedded_size += embedded_len
+
+    target_file_handle.write("\n")
+    target_file_handle.write("const struct FwDesc fwList[] = {")
+
+    for root, file in files:
+        target_file_handle.write('{IBT_FW("')
+        target_file_handle.write(file)
+        target_file_handle.write('", ')
+        fw_var_name = format_file_name(file)
+        target_file_handle.write(fw_var_name)
+        target_file_handle.write(", ")
+        target_file_handle.write(fw_var_name)
+        target_file_handle.write("_size)},\n")
+    if not files:
+        # keep the array non-empty, fwNumber is what bounds the lookup
+        target_file_handle.write('{IBT_FW("", NULL, 0)},\n')
+
+    target_file_handle.write("};\n")
+    target_file_handle.write("const int fwNumber = ")
+    target_file_handle.write(str(len(files)))
+    target_file_handle.write(";\n")
+    target_file_handle.write('const char *fwVariant = "')
+    target_file_handle.write(variant.strip())
+    target_file_handle.write('";\n')
+    target_file_handle.write("const bool fwExternal = ")
+    target_file_handle.write("true" if external_dir else "false")
+    target_file_handle.write(";\n")
+
     target_file_handle.close()
+    print_report(variant, count, raw_size, embedded_size, external_size)
+
+def print_report(variant, count, raw_size, embedded_size, external_size=0):
+    line = "{:<24} {:>5} files {:>10} bytes raw {:>10} bytes embedded".format(
+        variant.strip(), count, raw_size, embedded_size)
+    if external_size:
+        line += " {:>10} bytes external".format(external_size)
+    print(line)
+
+def report(dir, variants=None):
+    """Print the size of every firmware variant without generating
+    anything, e.g. python3 zlib_compress_fw.py IntelBluetoothFirmware/fw
+    """
+    for variant in variants or (["all"] + generations):
+        file_hash = []
+        raw_size = 0
+        embedded_size = 0
+        files = fw_files(dir, variant)
+        for root, file in files:
+            src_data = open(os.path.join(root, file), "rb").read()
+            raw_size += len(src_data)
+            src_data = fw_payload(file, src_data)
+            src_hash = hash(src_data)
+            if src_hash not in file_hash:
+                file_hash.append(src_hash)
+                embedded_size += len(compress(src_data))
+        print_report(variant, len(files), raw_size, embedded_size)
 
 if __name__ == '__main__':
-    print(compress("test"));
+    if len(sys.argv) < 2:
+        print("usage: {} <fw_dir> [variant ...]".format(sys.argv[0]))
+        sys.exit(1)
+    report(sys.argv[1], sys.argv[2:])